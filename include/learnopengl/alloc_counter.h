@@ -0,0 +1,80 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstdlib>
+#include <new>
+
+// Counts the heap allocations each thread makes through operator new, so the application can
+// check that code which should never allocate (the per-frame draw path) really doesn't.
+// This header replaces the global operator new/delete and therefore must be included by exactly
+// one translation unit, the one holding main().
+class AllocationCounter
+{
+public:
+    // allocations made by the calling thread since it started
+    static unsigned long long Count()
+    {
+        return counter();
+    }
+
+    static unsigned long long &counter()
+    {
+        static thread_local unsigned long long allocations = 0;
+        return allocations;
+    }
+};
+
+// The replacements go through these out of line helpers: with the malloc and free calls visible
+// after inlining, GCC pairs them with the new and delete expressions of every caller and warns
+// (-Wmismatched-new-delete) about memory it can't tell is allocated with malloc.
+__attribute__((noinline)) inline void *AllocationCounterNew(std::size_t size)
+{
+    AllocationCounter::counter()++;
+    if (size == 0)
+        size = 1;
+    for (;;)
+    {
+        if (void *memory = std::malloc(size))
+            return memory;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+__attribute__((noinline)) inline void AllocationCounterDelete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void *operator new(std::size_t size)
+{
+    return AllocationCounterNew(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return AllocationCounterNew(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    AllocationCounterDelete(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    AllocationCounterDelete(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    AllocationCounterDelete(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    AllocationCounterDelete(memory);
+}
+#endif
@@ -0,0 +1,186 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// parts of a frame timed separately by the benchmark
+enum BenchmarkPhase {
+    PHASE_UPDATE = 0,  // camera, per-frame uniforms
+    PHASE_CULL_SORT,   // culling and building the render queue
+    PHASE_DRAW,        // issuing the draw calls
+    PHASE_GPU_WAIT,    // glFinish, waiting for the GPU to complete the frame
+    PHASE_COUNT
+};
+
+const char *const BENCHMARK_PHASE_NAMES[PHASE_COUNT] = {"update", "cull_sort", "draw", "gpu_wait"};
+
+// Times a fixed number of frames (after some warm-up frames that are not counted) and reports
+// the frame time distribution plus the wall and CPU time spent in every phase of the frame.
+class Benchmark
+{
+public:
+    Benchmark(int warmupFrames, int frames) : warmupFrames(warmupFrames), frames(frames)
+    {
+        frameMillis.reserve(frames);
+    }
+
+    bool Done() const { return frame >= warmupFrames + frames; }
+    int Frame() const { return frame; }
+    int TotalFrames() const { return warmupFrames + frames; }
+    // whether the current frame is one of the timed ones
+    bool Timed() const { return frame >= warmupFrames; }
+    // position of the current frame in the timed part of the run, 0 to 1 (warm-up frames use 0)
+    float Progress() const
+    {
+        int timed = frame - warmupFrames;
+        return timed <= 0 || frames <= 1 ? 0.0f : (float)timed / (float)(frames - 1);
+    }
+
+    void BeginFrame()
+    {
+        frameStart = phaseStart = std::chrono::steady_clock::now();
+        phaseCpuStart = threadCpuMillis();
+    }
+
+    // closes the phase that started at the previous mark (or the frame start)
+    void EndPhase(BenchmarkPhase phase)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double cpu = threadCpuMillis();
+        if (frame >= warmupFrames)
+        {
+            phaseMillis[phase] += std::chrono::duration<double, std::milli>(now - phaseStart).count();
+            phaseCpuMillis[phase] += cpu - phaseCpuStart;
+        }
+        phaseStart = now;
+        phaseCpuStart = cpu;
+    }
+
+    void EndFrame()
+    {
+        if (frame >= warmupFrames)
+            frameMillis.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+        frame++;
+    }
+
+    // runs the warm-up and timed frames again (e.g. with another renderer), forgetting the frame and phase
+    // times so far; the results added so far are kept
+    void Restart()
+    {
+        frame = 0;
+        frameMillis.clear();
+        std::fill(phaseMillis, phaseMillis + PHASE_COUNT, 0.0);
+        std::fill(phaseCpuMillis, phaseCpuMillis + PHASE_COUNT, 0.0);
+    }
+
+    // of the timed frames so far
+    double MeanFrameMillis() const
+    {
+        double total = 0.0;
+        for (double millis : frameMillis)
+            total += millis;
+        return total / std::max<double>(1.0, (double)frameMillis.size());
+    }
+
+    double FrameMillisPercentile(double fraction) const
+    {
+        std::vector<double> sorted = frameMillis;
+        std::sort(sorted.begin(), sorted.end());
+        return percentile(sorted, fraction);
+    }
+
+    // a measurement made besides the frames (e.g. the GPU cost of one draw), written as a top level number
+    void AddResult(const std::string &name, double value)
+    {
+        results.push_back(std::make_pair(name, value));
+    }
+
+    // writes the results as JSON; info holds extra top level string fields (renderer, camera path, ...)
+    bool WriteJson(const std::string &path, const std::vector<std::pair<std::string, std::string>> &info) const
+    {
+        std::ofstream out(path);
+        if (!out)
+            return false;
+        std::vector<double> sorted = frameMillis;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0.0;
+        for (double millis : sorted)
+            total += millis;
+        double count = std::max<double>(1.0, (double)sorted.size());
+
+        out << "{\n";
+        for (const std::pair<std::string, std::string> &field : info)
+            out << "  \"" << escape(field.first) << "\": \"" << escape(field.second) << "\",\n";
+        for (const std::pair<std::string, double> &result : results)
+            out << "  \"" << escape(result.first) << "\": " << result.second << ",\n";
+        out << "  \"warmup_frames\": " << warmupFrames << ",\n";
+        out << "  \"frames\": " << sorted.size() << ",\n";
+        out << "  \"frame_ms\": {\n";
+        out << "    \"min\": " << (sorted.empty() ? 0.0 : sorted.front()) << ",\n";
+        out << "    \"mean\": " << total / count << ",\n";
+        out << "    \"p95\": " << percentile(sorted, 0.95) << ",\n";
+        out << "    \"p99\": " << percentile(sorted, 0.99) << ",\n";
+        out << "    \"max\": " << (sorted.empty() ? 0.0 : sorted.back()) << "\n";
+        out << "  },\n";
+        out << "  \"fps\": " << (total > 0.0 ? 1000.0 * sorted.size() / total : 0.0) << ",\n";
+        out << "  \"phases\": {\n";
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+        {
+            out << "    \"" << BENCHMARK_PHASE_NAMES[phase] << "\": {\"wall_ms\": " << phaseMillis[phase] / count
+                << ", \"cpu_ms\": " << phaseCpuMillis[phase] / count << "}" << (phase + 1 < PHASE_COUNT ? "," : "") << "\n";
+        }
+        out << "  }\n";
+        out << "}\n";
+        return (bool)out;
+    }
+
+private:
+    int warmupFrames;
+    int frames;
+    int frame = 0;
+    std::vector<double> frameMillis;
+    std::vector<std::pair<std::string, double>> results;
+    double phaseMillis[PHASE_COUNT] = {};
+    double phaseCpuMillis[PHASE_COUNT] = {};
+    std::chrono::steady_clock::time_point frameStart, phaseStart;
+    double phaseCpuStart = 0.0;
+
+    // CPU time of the calling thread, so time spent blocked (e.g. in glFinish) doesn't count
+    static double threadCpuMillis()
+    {
+        timespec now;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+    }
+
+    // nearest-rank percentile of sorted values
+    static double percentile(const std::vector<double> &sorted, double fraction)
+    {
+        if (sorted.empty())
+            return 0.0;
+        size_t rank = (size_t)std::ceil(fraction * sorted.size());
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    static std::string escape(const std::string &text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if ((unsigned char)c >= 0x20)
+                escaped += c;
+        }
+        return escaped;
+    }
+};
+#endif
@@ -0,0 +1,503 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// GL names of the block compressed formats; glad only loads the 3.3 core profile, which has RGTC (BC4/BC5) but
+// not S3TC (BC1/BC3, GL_EXT_texture_compression_s3tc) or BPTC (BC7, GL_ARB_texture_compression_bptc, core in 4.2)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+#ifndef GL_COMPRESSED_RED_RGTC1
+#define GL_COMPRESSED_RED_RGTC1 0x8DBB
+#endif
+#ifndef GL_COMPRESSED_RG_RGTC2
+#define GL_COMPRESSED_RG_RGTC2 0x8DBD
+#endif
+#ifndef GL_RGBA
+#define GL_RGBA 0x1908
+#endif
+#ifndef GL_RGB
+#define GL_RGB 0x1907
+#endif
+#ifndef GL_RG
+#define GL_RG 0x8227
+#endif
+#ifndef GL_RED
+#define GL_RED 0x1903
+#endif
+
+// block compressed formats the asset cooker writes, all in 4x4 pixel blocks:
+//   BC1: rgb, two 565 endpoints and 2-bit indices, 8 bytes (opaque color)
+//   BC3: BC1 color plus a BC4 alpha block, 16 bytes (color with alpha)
+//   BC4: one channel, two 8-bit endpoints and 3-bit indices, 8 bytes (data maps)
+//   BC5: two BC4 blocks for red and green, 16 bytes (normal maps, z is rebuilt in the shader)
+//   BC7: rgba, 16 bytes, much better quality than BC1 at twice the size (color)
+enum BlockFormat {
+    BLOCK_BC1,
+    BLOCK_BC3,
+    BLOCK_BC4,
+    BLOCK_BC5,
+    BLOCK_BC7
+};
+
+// CPU encoders for the formats above. Quality over speed only as far as an offline tool can afford:
+// endpoints along the principal axis of the block, refined by least squares, and for BC7 just mode 6
+// (one subset, 7-bit rgba endpoints plus p-bits, 4-bit indices), which covers most content well.
+class BlockCompressor
+{
+public:
+    static unsigned int BlockBytes(BlockFormat format)
+    {
+        return format == BLOCK_BC1 || format == BLOCK_BC4 ? 8 : 16;
+    }
+
+    static size_t CompressedSize(BlockFormat format, int width, int height)
+    {
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+    }
+
+    static uint32_t GLInternalFormat(BlockFormat format, bool srgb)
+    {
+        switch (format)
+        {
+        case BLOCK_BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BLOCK_BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BLOCK_BC4: return GL_COMPRESSED_RED_RGTC1;
+        case BLOCK_BC5: return GL_COMPRESSED_RG_RGTC2;
+        default: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+    }
+
+    static uint32_t GLBaseFormat(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BLOCK_BC1: return GL_RGB;
+        case BLOCK_BC4: return GL_RED;
+        case BLOCK_BC5: return GL_RG;
+        default: return GL_RGBA;
+        }
+    }
+
+    // compresses an rgba8 image row by row; blocks sticking out of the image repeat its last row and column
+    static void Compress(BlockFormat format, const uint8_t *rgba, int width, int height, uint8_t *out)
+    {
+        uint8_t block[64];
+        for (int by = 0; by < height; by += 4)
+        {
+            for (int bx = 0; bx < width; bx += 4)
+            {
+                for (int y = 0; y < 4; y++)
+                {
+                    for (int x = 0; x < 4; x++)
+                    {
+                        const uint8_t *pixel = rgba + ((size_t)std::min(by + y, height - 1) * width + std::min(bx + x, width - 1)) * 4;
+                        memcpy(block + (y * 4 + x) * 4, pixel, 4);
+                    }
+                }
+                EncodeBlock(format, block, out);
+                out += BlockBytes(format);
+            }
+        }
+    }
+
+    // one 4x4 block of rgba8 pixels, row major
+    static void EncodeBlock(BlockFormat format, const uint8_t block[64], uint8_t *out)
+    {
+        uint8_t channel[16];
+        switch (format)
+        {
+        case BLOCK_BC1:
+            encodeColor(block, out);
+            break;
+        case BLOCK_BC3:
+            for (int i = 0; i < 16; i++)
+                channel[i] = block[i * 4 + 3];
+            encodeChannel(channel, out);
+            encodeColor(block, out + 8);
+            break;
+        case BLOCK_BC4:
+            for (int i = 0; i < 16; i++)
+                channel[i] = block[i * 4];
+            encodeChannel(channel, out);
+            break;
+        case BLOCK_BC5:
+            for (int c = 0; c < 2; c++)
+            {
+                for (int i = 0; i < 16; i++)
+                    channel[i] = block[i * 4 + c];
+                encodeChannel(channel, out + c * 8);
+            }
+            break;
+        case BLOCK_BC7:
+            encodeMode6(block, out);
+            break;
+        }
+    }
+
+private:
+    // principal axis of count points with the given number of channels (power iteration on the covariance)
+    static void principalAxis(const float *points, int count, int channels, float *mean, float *axis)
+    {
+        float covariance[4][4] = {};
+        for (int c = 0; c < channels; c++)
+        {
+            mean[c] = 0.0f;
+            for (int i = 0; i < count; i++)
+                mean[c] += points[i * channels + c];
+            mean[c] /= count;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            for (int a = 0; a < channels; a++)
+            {
+                for (int b = a; b < channels; b++)
+                    covariance[a][b] += (points[i * channels + a] - mean[a]) * (points[i * channels + b] - mean[b]);
+            }
+        }
+        for (int a = 0; a < channels; a++)
+        {
+            for (int b = 0; b < a; b++)
+                covariance[a][b] = covariance[b][a];
+        }
+        for (int c = 0; c < channels; c++)
+            axis[c] = 1.0f;
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            float length = 0.0f;
+            for (int a = 0; a < channels; a++)
+            {
+                for (int b = 0; b < channels; b++)
+                    next[a] += covariance[a][b] * axis[b];
+                length = std::max(length, std::fabs(next[a]));
+            }
+            if (length < 1e-12f)
+                break;
+            for (int c = 0; c < channels; c++)
+                axis[c] = next[c] / length;
+        }
+        float length = 0.0f;
+        for (int c = 0; c < channels; c++)
+            length += axis[c] * axis[c];
+        length = std::sqrt(length);
+        for (int c = 0; c < channels; c++)
+            axis[c] /= length;
+    }
+
+    // endpoints of the points' extent along their principal axis
+    static void axisEndpoints(const float *points, int count, int channels, float *low, float *high)
+    {
+        float mean[4], axis[4];
+        principalAxis(points, count, channels, mean, axis);
+        float minProjection = 0.0f, maxProjection = 0.0f;
+        for (int i = 0; i < count; i++)
+        {
+            float projection = 0.0f;
+            for (int c = 0; c < channels; c++)
+                projection += (points[i * channels + c] - mean[c]) * axis[c];
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+        for (int c = 0; c < channels; c++)
+        {
+            low[c] = mean[c] + axis[c] * minProjection;
+            high[c] = mean[c] + axis[c] * maxProjection;
+        }
+    }
+
+    // endpoints e0, e1 minimizing the squared error of points reconstructed as weight * e0 + (1 - weight) * e1
+    static bool leastSquares(const float *points, const float *weights, int count, int channels, float *e0, float *e1)
+    {
+        float a = 0.0f, b = 0.0f, c = 0.0f;
+        float x0[4] = {}, x1[4] = {};
+        for (int i = 0; i < count; i++)
+        {
+            float w = weights[i];
+            a += w * w;
+            b += w * (1.0f - w);
+            c += (1.0f - w) * (1.0f - w);
+            for (int k = 0; k < channels; k++)
+            {
+                x0[k] += w * points[i * channels + k];
+                x1[k] += (1.0f - w) * points[i * channels + k];
+            }
+        }
+        float determinant = a * c - b * b;
+        if (std::fabs(determinant) < 1e-6f)
+            return false;
+        for (int k = 0; k < channels; k++)
+        {
+            e0[k] = std::min(255.0f, std::max(0.0f, (c * x0[k] - b * x1[k]) / determinant));
+            e1[k] = std::min(255.0f, std::max(0.0f, (a * x1[k] - b * x0[k]) / determinant));
+        }
+        return true;
+    }
+
+    static int quantize(float value, int bits)
+    {
+        int levels = (1 << bits) - 1;
+        return std::min(levels, std::max(0, (int)std::lround(value * levels / 255.0f)));
+    }
+
+    static uint16_t pack565(const float *color)
+    {
+        return (uint16_t)((quantize(color[0], 5) << 11) | (quantize(color[1], 6) << 5) | quantize(color[2], 5));
+    }
+
+    static void unpack565(uint16_t packed, int *color)
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // BC1 color block in four color mode; also the color half of BC3, which is always four color
+    static void encodeColor(const uint8_t block[64], uint8_t out[8])
+    {
+        float points[16 * 3];
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < 3; c++)
+                points[i * 3 + c] = block[i * 4 + c];
+        }
+        float e0[3], e1[3];
+        axisEndpoints(points, 16, 3, e1, e0);
+
+        // index i of a four color block reconstructs weight[i] * c0 + (1 - weight[i]) * c1
+        const float weight[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        uint16_t bestC0 = 0, bestC1 = 0;
+        uint32_t bestIndices = 0;
+        int bestError = -1;
+        for (int iteration = 0; iteration < 3; iteration++)
+        {
+            uint16_t c0 = pack565(e0), c1 = pack565(e1);
+            if (c0 < c1)
+                std::swap(c0, c1);
+            int palette[4][3];
+            unpack565(c0, palette[0]);
+            unpack565(c1, palette[1]);
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            }
+            uint32_t indices = 0;
+            int error = 0;
+            float weights[16];
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0, bestDistance = -1;
+                for (int p = 0; p < (c0 == c1 ? 1 : 4); p++)
+                {
+                    int distance = 0;
+                    for (int c = 0; c < 3; c++)
+                    {
+                        int d = palette[p][c] - block[i * 4 + c];
+                        distance += d * d;
+                    }
+                    if (bestDistance < 0 || distance < bestDistance)
+                    {
+                        best = p;
+                        bestDistance = distance;
+                    }
+                }
+                indices |= (uint32_t)best << (i * 2);
+                error += bestDistance;
+                weights[i] = weight[best];
+            }
+            if (bestError < 0 || error < bestError)
+            {
+                bestC0 = c0;
+                bestC1 = c1;
+                bestIndices = indices;
+                bestError = error;
+            }
+            if (error == 0 || c0 == c1 || !leastSquares(points, weights, 16, 3, e0, e1))
+                break;
+        }
+        out[0] = (uint8_t)(bestC0 & 0xFF);
+        out[1] = (uint8_t)(bestC0 >> 8);
+        out[2] = (uint8_t)(bestC1 & 0xFF);
+        out[3] = (uint8_t)(bestC1 >> 8);
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = (uint8_t)(bestIndices >> (i * 8));
+    }
+
+    // BC4 block of one 8-bit channel, eight value mode (a0 > a1)
+    static void encodeChannel(const uint8_t values[16], uint8_t out[8])
+    {
+        int a0 = values[0], a1 = values[0];
+        for (int i = 1; i < 16; i++)
+        {
+            a0 = std::max(a0, (int)values[i]);
+            a1 = std::min(a1, (int)values[i]);
+        }
+        int palette[8] = {a0, a1};
+        for (int i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+        uint64_t indices = 0;
+        for (int i = 0; a0 != a1 && i < 16; i++)
+        {
+            int best = 0;
+            for (int p = 1; p < 8; p++)
+            {
+                if (std::abs(palette[p] - values[i]) < std::abs(palette[best] - values[i]))
+                    best = p;
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+        out[0] = (uint8_t)a0;
+        out[1] = (uint8_t)a1;
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = (uint8_t)(indices >> (i * 8));
+    }
+
+    static void putBits(uint8_t *out, int &position, uint32_t value, int bits)
+    {
+        for (int i = 0; i < bits; i++, position++)
+        {
+            if ((value >> i) & 1)
+                out[position >> 3] |= (uint8_t)(1 << (position & 7));
+        }
+    }
+
+    // BC7 mode 6: one subset, rgba endpoints of 7 bits plus a shared low bit (p-bit) each, 4-bit indices
+    static void encodeMode6(const uint8_t block[64], uint8_t out[16])
+    {
+        static const int weight[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+        float points[16 * 4];
+        for (int i = 0; i < 64; i++)
+            points[i] = block[i];
+        float e0[4], e1[4];
+        axisEndpoints(points, 16, 4, e0, e1);
+
+        int bestEndpoint[2][4] = {}, bestPBit[2] = {};
+        int bestIndices[16] = {};
+        int bestError = -1;
+        for (int iteration = 0; iteration < 3; iteration++)
+        {
+            int iterationError = -1, iterationIndices[16] = {};
+            // the p-bits decide whether the endpoints can reach even or odd values, try all four combinations
+            for (int pBits = 0; pBits < 4; pBits++)
+            {
+                int p[2] = {pBits & 1, pBits >> 1};
+                int endpoint[2][4], q[2][4];
+                for (int c = 0; c < 4; c++)
+                {
+                    const float *e[2] = {e0, e1};
+                    for (int k = 0; k < 2; k++)
+                    {
+                        q[k][c] = std::min(127, std::max(0, (int)std::lround((e[k][c] - p[k]) / 2.0f)));
+                        endpoint[k][c] = (q[k][c] << 1) | p[k];
+                    }
+                }
+                int palette[16][4];
+                for (int w = 0; w < 16; w++)
+                {
+                    for (int c = 0; c < 4; c++)
+                        palette[w][c] = ((64 - weight[w]) * endpoint[0][c] + weight[w] * endpoint[1][c] + 32) >> 6;
+                }
+                // the palette lies on a line: project onto it for the closest weight, then let
+                // the neighbouring entries compete since the rounded palette isn't exactly linear
+                int direction[4], lengthSquared = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    direction[c] = endpoint[1][c] - endpoint[0][c];
+                    lengthSquared += direction[c] * direction[c];
+                }
+                int error = 0, indices[16];
+                for (int i = 0; i < 16; i++)
+                {
+                    int projection = 0;
+                    for (int c = 0; c < 4; c++)
+                        projection += (block[i * 4 + c] - endpoint[0][c]) * direction[c];
+                    int t = lengthSquared > 0 ? std::min(64, std::max(0, (projection * 64 + lengthSquared / 2) / lengthSquared)) : 0;
+                    int guess = 0;
+                    while (guess < 15 && weight[guess + 1] - t < t - weight[guess])
+                        guess++;
+                    int best = 0, bestDistance = -1;
+                    for (int w = std::max(0, guess - 1); w <= std::min(15, guess + 1); w++)
+                    {
+                        int distance = 0;
+                        for (int c = 0; c < 4; c++)
+                        {
+                            int d = palette[w][c] - block[i * 4 + c];
+                            distance += d * d;
+                        }
+                        if (bestDistance < 0 || distance < bestDistance)
+                        {
+                            best = w;
+                            bestDistance = distance;
+                        }
+                    }
+                    indices[i] = best;
+                    error += bestDistance;
+                }
+                if (iterationError < 0 || error < iterationError)
+                {
+                    iterationError = error;
+                    memcpy(iterationIndices, indices, sizeof(indices));
+                }
+                if (bestError < 0 || error < bestError)
+                {
+                    bestError = error;
+                    memcpy(bestEndpoint, q, sizeof(q));
+                    bestPBit[0] = p[0];
+                    bestPBit[1] = p[1];
+                    memcpy(bestIndices, indices, sizeof(indices));
+                }
+            }
+            float weights[16];
+            for (int i = 0; i < 16; i++)
+                weights[i] = 1.0f - weight[iterationIndices[i]] / 64.0f;
+            if (bestError == 0 || !leastSquares(points, weights, 16, 4, e0, e1))
+                break;
+        }
+
+        // the first index is stored without its top bit, so it must be below 8: mirror the block if it isn't
+        if (bestIndices[0] >= 8)
+        {
+            for (int c = 0; c < 4; c++)
+                std::swap(bestEndpoint[0][c], bestEndpoint[1][c]);
+            std::swap(bestPBit[0], bestPBit[1]);
+            for (int i = 0; i < 16; i++)
+                bestIndices[i] = 15 - bestIndices[i];
+        }
+
+        memset(out, 0, 16);
+        int position = 0;
+        putBits(out, position, 1 << 6, 7);
+        for (int c = 0; c < 4; c++)
+        {
+            putBits(out, position, bestEndpoint[0][c], 7);
+            putBits(out, position, bestEndpoint[1][c], 7);
+        }
+        putBits(out, position, bestPBit[0], 1);
+        putBits(out, position, bestPBit[1], 1);
+        for (int i = 0; i < 16; i++)
+            putBits(out, position, bestIndices[i], i == 0 ? 3 : 4);
+    }
+};
+#endif
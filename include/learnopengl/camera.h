@@ -112,6 +112,14 @@ public:
             Zoom = 45.0f; 
     }
 
+    // points the camera in the direction given by the Euler angles (e.g. when replaying a recorded path)
+    void SetOrientation(float yaw, float pitch)
+    {
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
 private:
     // calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors()
@@ -0,0 +1,110 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <learnopengl/camera.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// camera state at one point in time
+struct CameraKey {
+    float time;
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+    float zoom;
+};
+
+// A recorded camera fly-through. Stored as text, one key per line:
+//   time posX posY posZ yaw pitch zoom
+// lines starting with '#' are comments. Playback interpolates linearly between keys.
+class CameraPath
+{
+public:
+    std::vector<CameraKey> keys;
+
+    bool Load(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+        keys.clear();
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream fields(line);
+            CameraKey key;
+            if (fields >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch >> key.zoom)
+                keys.push_back(key);
+        }
+        return !keys.empty();
+    }
+
+    bool Save(const std::string &path) const
+    {
+        std::ofstream out(path);
+        if (!out)
+            return false;
+        out << "# time posX posY posZ yaw pitch zoom\n";
+        for (const CameraKey &key : keys)
+        {
+            out << key.time << ' ' << key.position.x << ' ' << key.position.y << ' ' << key.position.z << ' '
+                << key.yaw << ' ' << key.pitch << ' ' << key.zoom << '\n';
+        }
+        return (bool)out;
+    }
+
+    float Duration() const
+    {
+        return keys.empty() ? 0.0f : keys.back().time - keys.front().time;
+    }
+
+    // appends the camera state; several updates within the same frame collapse into one key
+    void Record(float time, const Camera &camera)
+    {
+        CameraKey key;
+        key.time = time;
+        key.position = camera.Position;
+        key.yaw = camera.Yaw;
+        key.pitch = camera.Pitch;
+        key.zoom = camera.Zoom;
+        if (!keys.empty() && keys.back().time >= time)
+            keys.back() = key;
+        else
+            keys.push_back(key);
+    }
+
+    // moves the camera to where the path is at the given time since its first key
+    void Apply(float time, Camera &camera) const
+    {
+        if (keys.empty())
+            return;
+        time += keys.front().time;
+        size_t next = 0;
+        while (next < keys.size() && keys[next].time < time)
+            next++;
+        CameraKey key;
+        if (next == 0)
+            key = keys.front();
+        else if (next == keys.size())
+            key = keys.back();
+        else
+        {
+            const CameraKey &a = keys[next - 1];
+            const CameraKey &b = keys[next];
+            float t = (time - a.time) / (b.time - a.time);
+            key.position = glm::mix(a.position, b.position, t);
+            key.yaw = glm::mix(a.yaw, b.yaw, t);
+            key.pitch = glm::mix(a.pitch, b.pitch, t);
+            key.zoom = glm::mix(a.zoom, b.zoom, t);
+        }
+        camera.Position = key.position;
+        camera.Zoom = key.zoom;
+        camera.SetOrientation(key.yaw, key.pitch);
+    }
+};
+#endif
@@ -0,0 +1,135 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <cstddef>
+#include <cstring>
+
+// binding points of the uniform blocks shared by all programs
+const unsigned int CAMERA_BLOCK_BINDING = 0;
+const unsigned int LIGHTS_BLOCK_BINDING = 1;
+
+// C++ mirrors of the std140 blocks declared in the shaders. Every vec3 starts on a 16 byte
+// boundary, a following scalar may use its fourth component.
+struct CameraBlock {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPos;
+    float pad0;
+};
+
+struct DirLightBlock {
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+struct SpotLightBlock {
+    glm::vec3 position;
+    float pad0;
+    glm::vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    float constant;
+    float linear;
+    float quadratic;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    int lamp; // GLSL bool
+};
+
+// where a fragment finds the point lights of its cluster (light_clusters.h); the lights themselves
+// are in buffer textures, too many for a uniform block
+struct ClusterGridBlock {
+    glm::vec2 tileScale; // clusters per pixel along x and y
+    float sliceScale;    // depth slice = log(view depth) * sliceScale + sliceBias
+    float sliceBias;
+    glm::ivec3 size;     // clusters along x, y and depth
+    int pointLights;     // lights assigned this frame
+};
+
+struct LightsBlock {
+    DirLightBlock dirLight;
+    SpotLightBlock spotLight;
+    ClusterGridBlock clusterGrid;
+};
+
+static_assert(sizeof(CameraBlock) == 144, "Camera block must match std140");
+static_assert(offsetof(SpotLightBlock, cutOff) == 28 && offsetof(SpotLightBlock, ambient) == 48 &&
+              offsetof(SpotLightBlock, lamp) == 92 && sizeof(SpotLightBlock) == 96, "SpotLight must match std140");
+static_assert(offsetof(ClusterGridBlock, size) == 16 && sizeof(ClusterGridBlock) == 32, "ClusterGrid must match std140");
+static_assert(offsetof(LightsBlock, spotLight) == 64 && offsetof(LightsBlock, clusterGrid) == 160 &&
+              sizeof(LightsBlock) == 192, "Lights block must match std140");
+
+// Camera and light data shared by every program. Filled by the application, uploaded once per
+// frame into two uniform buffers, and read by all shaders through the Camera and Lights blocks.
+class FrameUniforms
+{
+public:
+    CameraBlock camera;
+    LightsBlock lights;
+
+    FrameUniforms()
+    {
+        // zero the padding too, the blocks are compared bytewise; the uploaded copies start out
+        // different from anything the application can write so the first Upload() sends both
+        memset(static_cast<void *>(&camera), 0, sizeof(camera));
+        memset(static_cast<void *>(&lights), 0, sizeof(lights));
+        memset(static_cast<void *>(&uploadedCamera), 0xff, sizeof(uploadedCamera));
+        memset(static_cast<void *>(&uploadedLights), 0xff, sizeof(uploadedLights));
+
+        glGenBuffers(1, &cameraUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, cameraUBO);
+
+        glGenBuffers(1, &lightsUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, lightsUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(LightsBlock), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_BINDING, lightsUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // connects the program's blocks (if it declares them) to the shared buffers
+    void Attach(const Shader &shader) const
+    {
+        shader.bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+        shader.bindUniformBlock("Lights", LIGHTS_BLOCK_BINDING);
+    }
+
+    // uploads whatever changed since the last frame
+    void Upload()
+    {
+        if (memcmp(&camera, &uploadedCamera, sizeof(camera)) != 0)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(camera), &camera);
+            uploadedCamera = camera;
+        }
+        if (memcmp(&lights, &uploadedLights, sizeof(lights)) != 0)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, lightsUBO);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(lights), &lights);
+            uploadedLights = lights;
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+private:
+    unsigned int cameraUBO, lightsUBO;
+    CameraBlock uploadedCamera;
+    LightsBlock uploadedLights;
+};
+#endif
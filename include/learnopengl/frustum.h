@@ -0,0 +1,157 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// plane as normal.x * x + normal.y * y + normal.z * z + d = 0, normal pointing into the frustum
+struct Plane {
+    glm::vec3 normal;
+    float d;
+
+    float Distance(const glm::vec3 &point) const
+    {
+        return glm::dot(normal, point) + d;
+    }
+};
+
+// the six clip planes of a view-projection matrix (Gribb & Hartmann), in world space
+class Frustum
+{
+public:
+    Plane planes[6];
+
+    Frustum() {}
+
+    explicit Frustum(const glm::mat4 &viewProjection)
+    {
+        // glm is column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        setPlane(0, rows[3] + rows[0]); // left
+        setPlane(1, rows[3] - rows[0]); // right
+        setPlane(2, rows[3] + rows[1]); // bottom
+        setPlane(3, rows[3] - rows[1]); // top
+        setPlane(4, rows[3] + rows[2]); // near
+        setPlane(5, rows[3] - rows[2]); // far
+    }
+
+    bool IntersectsSphere(const glm::vec3 &center, float radius) const
+    {
+        for (const Plane &plane : planes)
+        {
+            if (plane.Distance(center) < -radius)
+                return false;
+        }
+        return true;
+    }
+
+    // box given by its center and half size along the world axes
+    bool IntersectsBox(const glm::vec3 &center, const glm::vec3 &extent) const
+    {
+        for (const Plane &plane : planes)
+        {
+            float reach = glm::dot(extent, glm::abs(plane.normal));
+            if (plane.Distance(center) < -reach)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    void setPlane(int i, const glm::vec4 &coefficients)
+    {
+        float length = glm::length(glm::vec3(coefficients));
+        planes[i].normal = glm::vec3(coefficients) / length;
+        planes[i].d = coefficients.w / length;
+    }
+};
+
+// depth used for projecting sizes of bounds the camera is in or close to
+const float MIN_PROJECTION_DEPTH = 0.01f;
+
+// mesh instances tested by a ViewCuller during one frame
+struct CullStats {
+    unsigned int drawn = 0;
+    unsigned int frustumCulled = 0; // completely outside the view frustum
+    unsigned int smallCulled = 0;   // inside, but would cover fewer than minPixelSize pixels
+};
+
+// Decides per mesh instance whether it is worth drawing this frame. An instance is skipped when
+// its bounds are outside the view frustum, or when it is so far away that its bounding sphere
+// projects to less than minPixelSize pixels on screen.
+class ViewCuller
+{
+public:
+    bool enabled = true;
+    float minPixelSize = 0.0f;
+    // error in pixels a simplified level of detail may show (see Mesh::SelectLod); larger is coarser
+    float lodPixelError = 1.0f;
+    CullStats stats;
+
+    ViewCuller(const glm::mat4 &projection, const glm::mat4 &view, float viewportHeight)
+        : frustum(projection * view), view(view)
+    {
+        // a sphere of radius r at depth z spans r * projection[1][1] / z of half the viewport height
+        pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    }
+
+    // bounds are in model space (sphere plus axis aligned box), transform places the instance in the world.
+    // depth, if given, receives the view space depth of the sphere center (for sorting); pixelScale the
+    // number of pixels a model space unit covers at the nearest point of the sphere (for picking a level of detail).
+    bool IsVisible(const glm::vec3 &sphereCenter, float sphereRadius, const glm::vec3 &aabbMin, const glm::vec3 &aabbMax,
+                   const glm::mat4 &transform, float *depth = nullptr, float *pixelScale = nullptr)
+    {
+        glm::vec3 center = glm::vec3(transform * glm::vec4(sphereCenter, 1.0f));
+        float centerDepth = -(view * glm::vec4(center, 1.0f)).z;
+        // the sphere scales with the largest axis scale of the transform
+        float scale = std::sqrt(std::max(glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+                                std::max(glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+                                         glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])))));
+        float radius = sphereRadius * scale;
+        if (depth)
+            *depth = centerDepth;
+        if (pixelScale)
+            *pixelScale = scale * pixelsPerUnit / std::max(centerDepth - radius, MIN_PROJECTION_DEPTH);
+        if (!enabled)
+        {
+            stats.drawn++;
+            return true;
+        }
+
+        if (!frustum.IntersectsSphere(center, radius))
+        {
+            stats.frustumCulled++;
+            return false;
+        }
+
+        // the sphere is conservative, refine with the world space box around the transformed aabb
+        glm::mat3 linear = glm::mat3(transform);
+        glm::mat3 absolute = glm::mat3(glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2]));
+        glm::vec3 boxCenter = glm::vec3(transform * glm::vec4((aabbMin + aabbMax) * 0.5f, 1.0f));
+        glm::vec3 boxExtent = absolute * ((aabbMax - aabbMin) * 0.5f);
+        if (!frustum.IntersectsBox(boxCenter, boxExtent))
+        {
+            stats.frustumCulled++;
+            return false;
+        }
+
+        if (centerDepth > radius && 2.0f * radius * pixelsPerUnit / centerDepth < minPixelSize)
+        {
+            stats.smallCulled++;
+            return false;
+        }
+
+        stats.drawn++;
+        return true;
+    }
+
+private:
+    Frustum frustum;
+    glm::mat4 view;
+    float pixelsPerUnit;
+};
+#endif
@@ -0,0 +1,122 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/sampler_cache.h>
+#include <learnopengl/shader.h>
+
+#include <iostream>
+
+// texture units the lighting pass reads the G-buffer from
+const unsigned int GBUFFER_ALBEDO_UNIT = 0;
+const unsigned int GBUFFER_NORMAL_UNIT = 1;
+const unsigned int GBUFFER_DEPTH_UNIT = 2;
+const int GBUFFER_BYTES_PER_PIXEL = 12;
+
+// Render targets and passes of the deferred renderer. The geometry pass draws the lit surfaces with
+// their DEFERRED shader variants, which store what lighting needs instead of lighting (gbuffer.glsl),
+// GBUFFER_BYTES_PER_PIXEL bytes a pixel:
+//   albedo   GL_RGBA8           diffuse color, display encoded like the color textures, specular intensity in alpha
+//   normal   GL_RGB10_A2        world space normal, which lights the surface takes in alpha
+//   depth    GL_DEPTH24_STENCIL8 the format of the window's and the offscreen target's depth, so it can be blitted there
+// The lighting pass then shades every covered pixel once, with the lights of its cluster, into the target
+// the forward drawn rest of the frame (lamps, window, skybox) goes into.
+class GBuffer
+{
+public:
+    unsigned int FBO = 0;
+    int width = 0, height = 0;
+
+    // (re)creates the targets when the size changed; the bound framebuffer stays bound
+    void Resize(int width, int height)
+    {
+        if (FBO != 0 && width == this->width && height == this->height)
+            return;
+        GLint boundFBO = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &boundFBO);
+        Destroy();
+        this->width = width;
+        this->height = height;
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glGenTextures(3, textures);
+        allocate(textures[0], GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        allocate(textures[1], GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV);
+        allocate(textures[2], GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[0], 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[1], 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, textures[2], 0);
+        const GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, drawBuffers);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: G-buffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, boundFBO);
+        if (!screenVAO)
+            glGenVertexArrays(1, &screenVAO);
+    }
+
+    // must run while the context is still current
+    void Destroy()
+    {
+        if (FBO != 0)
+        {
+            glDeleteTextures(3, textures);
+            glDeleteFramebuffers(1, &FBO);
+            FBO = 0;
+        }
+        if (screenVAO)
+        {
+            glDeleteVertexArrays(1, &screenVAO);
+            screenVAO = 0;
+        }
+    }
+
+    // the geometry pass draws into the G-buffer from here on
+    void BeginGeometryPass()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // back to the target, which gets the scene's depth for the forward drawn rest of the frame, and
+    // shades the pixels the geometry pass covered. The full screen triangle lies on the far plane and
+    // only passes where the depth is nearer, so the sky isn't shaded
+    void LightingPass(unsigned int targetFBO, Shader &lighting)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFBO);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+
+        lighting.use();
+        const unsigned int units[3] = {GBUFFER_ALBEDO_UNIT, GBUFFER_NORMAL_UNIT, GBUFFER_DEPTH_UNIT};
+        for (int i = 0; i < 3; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + units[i]);
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+            SamplerCache::Bind(units[i], SAMPLER_POINT);
+        }
+        glActiveTexture(GL_TEXTURE0);
+        glDepthFunc(GL_GREATER);
+        glDepthMask(GL_FALSE);
+        glBindVertexArray(screenVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+
+private:
+    unsigned int textures[3]; // albedo, normal, depth
+    unsigned int screenVAO = 0;
+
+    void allocate(unsigned int texture, GLint internalFormat, GLenum format, GLenum type)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    }
+};
+#endif
@@ -0,0 +1,169 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <set>
+#include <string>
+
+// enums beyond the 3.3 core profile glad loads
+#ifndef GL_TEXTURE_IMMUTABLE_FORMAT
+#define GL_TEXTURE_IMMUTABLE_FORMAT 0x912F
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP TexStorage2DFunction)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (APIENTRYP BufferStorageFunction)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void (APIENTRYP GetProgramBinaryFunction)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP ProgramBinaryFunction)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriFunction)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP MaxShaderCompilerThreadsFunction)(GLuint count);
+
+// What the context offers beyond the 3.3 core profile: its version, its extensions, and the entry
+// points of newer versions the renderer uses where they exist (glad only loads 3.3 core). Load() must
+// run once on the GL thread after glad, with the same loader; before that everything reports missing.
+class GLExtensions
+{
+public:
+    static void Load(GLADloadproc load)
+    {
+        GLExtensions &gl = instance();
+        GLint count = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &gl.major);
+        glGetIntegerv(GL_MINOR_VERSION, &gl.minor);
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        gl.extensions.clear();
+        for (GLint i = 0; i < count; i++)
+            gl.extensions.insert(reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i)));
+        // immutable texture storage, core in 4.2
+        gl.texStorage2D = nullptr;
+        if (Version(4, 2) || Has("GL_ARB_texture_storage"))
+            gl.texStorage2D = (TexStorage2DFunction)load("glTexStorage2D");
+        // immutable buffer storage that can stay mapped while the GL reads it, core in 4.4
+        gl.bufferStorage = nullptr;
+        if (Version(4, 4) || Has("GL_ARB_buffer_storage"))
+            gl.bufferStorage = (BufferStorageFunction)load("glBufferStorage");
+        // linked programs saved and restored as driver specific binaries, core in 4.1. A driver may
+        // support the entry points without offering a single binary format, which is as good as not at all
+        gl.getProgramBinary = nullptr;
+        gl.programBinary = nullptr;
+        gl.programParameteri = nullptr;
+        GLint binaryFormats = 0;
+        if (Version(4, 1) || Has("GL_ARB_get_program_binary"))
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+        if (binaryFormats > 0)
+        {
+            gl.getProgramBinary = (GetProgramBinaryFunction)load("glGetProgramBinary");
+            gl.programBinary = (ProgramBinaryFunction)load("glProgramBinary");
+            gl.programParameteri = (ProgramParameteriFunction)load("glProgramParameteri");
+        }
+        // shaders compiled and linked on threads of the driver, with a status that can be polled without
+        // waiting for them; the KHR and ARB extensions share the enum
+        gl.maxShaderCompilerThreads = nullptr;
+        if (Has("GL_KHR_parallel_shader_compile"))
+            gl.maxShaderCompilerThreads = (MaxShaderCompilerThreadsFunction)load("glMaxShaderCompilerThreadsKHR");
+        else if (Has("GL_ARB_parallel_shader_compile"))
+            gl.maxShaderCompilerThreads = (MaxShaderCompilerThreadsFunction)load("glMaxShaderCompilerThreadsARB");
+    }
+
+    static bool Version(int major, int minor)
+    {
+        const GLExtensions &gl = instance();
+        return gl.major > major || (gl.major == major && gl.minor >= minor);
+    }
+
+    static bool Has(const std::string &extension)
+    {
+        return instance().extensions.count(extension) != 0;
+    }
+
+    static bool HasTextureStorage()
+    {
+        return instance().texStorage2D != nullptr;
+    }
+
+    // only valid when HasTextureStorage() is true
+    static void TexStorage2D(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height)
+    {
+        instance().texStorage2D(target, levels, internalFormat, width, height);
+    }
+
+    static bool HasBufferStorage()
+    {
+        return instance().bufferStorage != nullptr;
+    }
+
+    // only valid when HasBufferStorage() is true
+    static void BufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
+    {
+        instance().bufferStorage(target, size, data, flags);
+    }
+
+    static bool HasProgramBinary()
+    {
+        const GLExtensions &gl = instance();
+        return gl.getProgramBinary && gl.programBinary && gl.programParameteri;
+    }
+
+    // only valid when HasProgramBinary() is true
+    static void GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary)
+    {
+        instance().getProgramBinary(program, bufSize, length, binaryFormat, binary);
+    }
+
+    static void ProgramBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length)
+    {
+        instance().programBinary(program, binaryFormat, binary, length);
+    }
+
+    static void ProgramParameteri(GLuint program, GLenum pname, GLint value)
+    {
+        instance().programParameteri(program, pname, value);
+    }
+
+    static bool HasParallelShaderCompile()
+    {
+        return instance().maxShaderCompilerThreads != nullptr;
+    }
+
+    // only valid when HasParallelShaderCompile() is true; 0xFFFFFFFF lets the driver pick
+    static void MaxShaderCompilerThreads(GLuint count)
+    {
+        instance().maxShaderCompilerThreads(count);
+    }
+
+private:
+    GLint major = 0;
+    GLint minor = 0;
+    std::set<std::string> extensions;
+    TexStorage2DFunction texStorage2D = nullptr;
+    BufferStorageFunction bufferStorage = nullptr;
+    GetProgramBinaryFunction getProgramBinary = nullptr;
+    ProgramBinaryFunction programBinary = nullptr;
+    ProgramParameteriFunction programParameteri = nullptr;
+    MaxShaderCompilerThreadsFunction maxShaderCompilerThreads = nullptr;
+
+    static GLExtensions &instance()
+    {
+        static GLExtensions gl;
+        return gl;
+    }
+};
+#endif
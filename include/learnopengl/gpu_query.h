@@ -0,0 +1,64 @@
+#ifndef GPU_QUERY_H
+#define GPU_QUERY_H
+
+#include <glad/glad.h>
+
+// A GL query around a stretch of commands: the GPU time they took (GL_TIME_ELAPSED, nanoseconds) or
+// the samples they got past the depth test (GL_SAMPLES_PASSED). One query per target can be running
+// at a time; Result waits until the GPU has finished the commands, Available tells without waiting
+// whether it would have to. A query that outlives the context
+// (e.g. a local of main) has to be destroyed explicitly while the context is current.
+class GpuQuery
+{
+public:
+    explicit GpuQuery(GLenum target) : target(target)
+    {
+        glGenQueries(1, &query);
+    }
+
+    ~GpuQuery()
+    {
+        Destroy();
+    }
+
+    void Destroy()
+    {
+        if (query != 0)
+        {
+            glDeleteQueries(1, &query);
+            query = 0;
+        }
+    }
+
+    GpuQuery(const GpuQuery &) = delete;
+    GpuQuery &operator=(const GpuQuery &) = delete;
+
+    void Begin()
+    {
+        glBeginQuery(target, query);
+    }
+
+    void End()
+    {
+        glEndQuery(target);
+    }
+
+    bool Available() const
+    {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        return available == GL_TRUE;
+    }
+
+    GLuint64 Result() const
+    {
+        GLuint64 value = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &value);
+        return value;
+    }
+
+private:
+    GLenum target;
+    GLuint query = 0;
+};
+#endif
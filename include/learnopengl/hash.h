@@ -0,0 +1,42 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// 64-bit FNV-1a. Not cryptographic, but cheap and good enough to detect changed asset files.
+const uint64_t FNV1A_64_SEED = 0xcbf29ce484222325ULL;
+
+inline uint64_t HashBytes(const void *data, size_t size, uint64_t hash = FNV1A_64_SEED)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+inline uint64_t HashString(const std::string &str, uint64_t hash = FNV1A_64_SEED)
+{
+    return HashBytes(str.data(), str.size(), hash);
+}
+
+// hashes the whole content of a file, returns false if it can't be read
+inline bool HashFile(const std::string &path, uint64_t &hash)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    hash = FNV1A_64_SEED;
+    unsigned char buffer[64 * 1024];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        hash = HashBytes(buffer, read, hash);
+    fclose(file);
+    return true;
+}
+#endif
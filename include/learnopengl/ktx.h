@@ -0,0 +1,201 @@
+#ifndef KTX_H
+#define KTX_H
+
+#include <learnopengl/mapped_file.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Khronos KTX (version 1) container for the asset cooker's block compressed textures, written next to
+// the source image (<image>.ktx). Layout: identifier, KtxHeader, key/value data, then per mip level a
+// uint32 image size followed by the compressed blocks, padded to 4 bytes. Only what the cooker produces
+// is read back: compressed 2D images with a single face and array layer.
+const unsigned char KTX_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+const uint32_t KTX_ENDIANNESS = 0x04030201;
+// key of the entry that records what a cooked texture was made from
+const char KTX_COOK_INFO_KEY[] = "RGCookInfo";
+// bumped whenever the cooker's output for the same source and settings changes
+const uint32_t TEXTURE_COOK_VERSION = 2;
+
+struct KtxHeader {
+    uint32_t endianness;
+    uint32_t glType;                // 0 for compressed data
+    uint32_t glTypeSize;
+    uint32_t glFormat;              // 0 for compressed data
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+// the source image a texture was cooked from and how, checked the same way as the mesh cache's source
+struct TextureCookInfo {
+    uint32_t version;
+    uint32_t settings; // hash of the cooker options that affect the output (format, mips, kind of map)
+    uint32_t channels; // of the source image, the block format alone doesn't tell whether it had alpha
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+};
+
+struct KtxLevel {
+    uint32_t width;
+    uint32_t height;
+    const unsigned char *data;
+    uint32_t size;
+};
+
+class KtxFile
+{
+public:
+    static std::string PathFor(const std::string &sourcePath)
+    {
+        return sourcePath + ".ktx";
+    }
+
+    // maps a ktx file and checks that all its mip levels are within the file
+    bool Open(const std::string &path)
+    {
+        levels.clear();
+        hasCookInfo = false;
+        if (!file.Open(path) || file.Size() < sizeof(KTX_IDENTIFIER) + sizeof(KtxHeader) ||
+            memcmp(file.Data(), KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0)
+            return invalidate();
+        memcpy(&header, file.Data() + sizeof(KTX_IDENTIFIER), sizeof(header));
+        if (header.endianness != KTX_ENDIANNESS || header.glType != 0 || header.glFormat != 0 ||
+            header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 ||
+            header.numberOfArrayElements > 0 || header.numberOfFaces != 1 || header.numberOfMipmapLevels == 0)
+            return invalidate();
+
+        size_t offset = sizeof(KTX_IDENTIFIER) + sizeof(KtxHeader);
+        size_t keyValueEnd = offset + header.bytesOfKeyValueData;
+        if (keyValueEnd > file.Size())
+            return invalidate();
+        while (offset + 4 <= keyValueEnd)
+        {
+            uint32_t entrySize;
+            memcpy(&entrySize, file.Data() + offset, 4);
+            offset += 4;
+            if (entrySize > keyValueEnd - offset)
+                return invalidate();
+            const char *entry = reinterpret_cast<const char *>(file.Data() + offset);
+            size_t keySize = sizeof(KTX_COOK_INFO_KEY);
+            if (entrySize == keySize + sizeof(TextureCookInfo) && memcmp(entry, KTX_COOK_INFO_KEY, keySize) == 0)
+            {
+                memcpy(&cookInfo, entry + keySize, sizeof(TextureCookInfo));
+                hasCookInfo = true;
+            }
+            offset += pad4(entrySize);
+        }
+
+        offset = keyValueEnd;
+        for (uint32_t level = 0; level < header.numberOfMipmapLevels; level++)
+        {
+            KtxLevel mip;
+            mip.width = std::max(1u, header.pixelWidth >> level);
+            mip.height = std::max(1u, header.pixelHeight >> level);
+            if (offset + 4 > file.Size())
+                return invalidate();
+            memcpy(&mip.size, file.Data() + offset, 4);
+            offset += 4;
+            if (mip.size > file.Size() - offset)
+                return invalidate();
+            mip.data = file.Data() + offset;
+            levels.push_back(mip);
+            offset += pad4(mip.size);
+        }
+        return true;
+    }
+
+    uint32_t InternalFormat() const { return header.glInternalFormat; }
+    uint32_t Width() const { return header.pixelWidth; }
+    uint32_t Height() const { return header.pixelHeight; }
+    const std::vector<KtxLevel> &Levels() const { return levels; }
+
+    // the cook info entry, if the file has one
+    bool GetCookInfo(TextureCookInfo &info) const
+    {
+        if (hasCookInfo)
+            info = cookInfo;
+        return hasCookInfo;
+    }
+
+    // whether the file was cooked by this version of the cooker from the source as it is now
+    bool IsFreshFor(const std::string &sourcePath) const
+    {
+        return hasCookInfo && cookInfo.version == TEXTURE_COOK_VERSION &&
+               SourceUnchanged(sourcePath, cookInfo.sourceSize, cookInfo.sourceMtime, cookInfo.sourceHash);
+    }
+
+    // writes a compressed 2D texture with its mip chain (level 0 first). Written to a temporary file
+    // first and renamed, like the mesh cache, so a reader never sees a half written file.
+    static bool Write(const std::string &path, uint32_t internalFormat, uint32_t baseFormat, uint32_t width, uint32_t height,
+                      const std::vector<std::vector<unsigned char>> &mipLevels, const TextureCookInfo &info)
+    {
+        KtxHeader h;
+        memset(&h, 0, sizeof(h));
+        h.endianness = KTX_ENDIANNESS;
+        h.glTypeSize = 1;
+        h.glInternalFormat = internalFormat;
+        h.glBaseInternalFormat = baseFormat;
+        h.pixelWidth = width;
+        h.pixelHeight = height;
+        h.numberOfFaces = 1;
+        h.numberOfMipmapLevels = (uint32_t)mipLevels.size();
+        uint32_t entrySize = (uint32_t)(sizeof(KTX_COOK_INFO_KEY) + sizeof(TextureCookInfo));
+        h.bytesOfKeyValueData = 4 + pad4(entrySize);
+
+        std::string tmpPath = path + ".tmp";
+        FILE *out = fopen(tmpPath.c_str(), "wb");
+        if (!out)
+            return false;
+        const unsigned char padding[4] = {};
+        bool ok = fwrite(KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER), 1, out) == 1 && fwrite(&h, sizeof(h), 1, out) == 1 &&
+                  fwrite(&entrySize, 4, 1, out) == 1 && fwrite(KTX_COOK_INFO_KEY, sizeof(KTX_COOK_INFO_KEY), 1, out) == 1 &&
+                  fwrite(&info, sizeof(info), 1, out) == 1 && fwrite(padding, 1, pad4(entrySize) - entrySize, out) == pad4(entrySize) - entrySize;
+        for (size_t level = 0; ok && level < mipLevels.size(); level++)
+        {
+            uint32_t size = (uint32_t)mipLevels[level].size();
+            ok = fwrite(&size, 4, 1, out) == 1 && fwrite(mipLevels[level].data(), 1, size, out) == size &&
+                 fwrite(padding, 1, pad4(size) - size, out) == pad4(size) - size;
+        }
+        ok = fclose(out) == 0 && ok;
+        if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0)
+        {
+            remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    MappedFile file;
+    KtxHeader header;
+    std::vector<KtxLevel> levels;
+    TextureCookInfo cookInfo;
+    bool hasCookInfo = false;
+
+    bool invalidate()
+    {
+        levels.clear();
+        hasCookInfo = false;
+        file.Close();
+        return false;
+    }
+
+    static uint32_t pad4(uint32_t size)
+    {
+        return (size + 3) & ~3u;
+    }
+};
+#endif
@@ -0,0 +1,419 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frame_uniforms.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// the view frustum is split into CLUSTERS_X * CLUSTERS_Y screen tiles and CLUSTER_SLICES depth slices,
+// the slices growing exponentially with depth so clusters stay roughly cube shaped
+const int CLUSTERS_X = 16;
+const int CLUSTERS_Y = 9;
+const int CLUSTER_SLICES = 24;
+const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTER_SLICES;
+const int MAX_POINT_LIGHTS = 1024;
+// a light's range ends where it adds less than this to a color channel; the shaders fade it out
+// towards its range so the cut doesn't show
+const float LIGHT_RANGE_THRESHOLD = 5.0f / 256.0f;
+// pool workers help with the assignment once there are this many lights per worker, fewer are
+// assigned faster than a worker wakes up
+const int CLUSTER_LIGHTS_PER_HELPER = 64;
+// texture units of the buffer textures, above the ones the materials use
+const unsigned int POINT_LIGHT_UNIT = 8;
+const unsigned int CLUSTER_RANGE_UNIT = 9;
+const unsigned int CLUSTER_INDEX_UNIT = 10;
+// RGBA32F texels per light: position and range, then ambient, diffuse and specular with the
+// constant, linear and quadratic attenuation terms in w
+const int POINT_LIGHT_TEXELS = 4;
+
+struct PointLight {
+    glm::vec3 position = glm::vec3(0.0f);
+    float constant = 1.0f;
+    float linear = 0.09f;
+    float quadratic = 0.032f;
+    glm::vec3 ambient = glm::vec3(0.0f);
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    glm::vec3 specular = glm::vec3(0.0f);
+};
+
+// what the last assignment did
+struct ClusterStats {
+    unsigned int lights = 0;
+    unsigned int references = 0;  // light indices over all clusters
+    unsigned int maxPerCluster = 0;
+    unsigned int helpers = 0;     // pool workers asked to help
+    double assignMillis = 0.0;    // on the GL thread, waiting for the helpers included
+};
+
+// Clustered forward lighting: every frame each point light is listed in the clusters its range reaches,
+// and a fragment evaluates only the lights of its own cluster (lighting.glsl CalcPointLights), so the
+// cost per fragment follows the lights nearby instead of all lights in the scene.
+//
+// The assignment works on the lights' view space positions and ranges in separate arrays. Each depth
+// slice is assigned on its own: the lights whose depth range covers it are tested against the planes
+// between the screen tiles, then listed per cluster. Slices are taken from a shared counter by this
+// thread and, for enough lights, by workers of the shared pool. The lists are uploaded into buffer
+// textures: per cluster the range of its lights in the index list, the index list, and the lights.
+class LightClusters
+{
+public:
+    // the point lights that are on, filled by the application
+    std::vector<PointLight> lights;
+    ClusterStats stats;
+
+    LightClusters()
+    {
+        glGenBuffers(3, buffers);
+        glGenTextures(3, textures);
+        const GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R16UI};
+        for (int i = 0; i < 3; i++)
+        {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+        }
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    ~LightClusters()
+    {
+        waitForHelpers();
+    }
+
+    // deletes the buffer textures; must run while the context is still current
+    void Destroy()
+    {
+        waitForHelpers();
+        if (buffers[0] != 0)
+        {
+            glDeleteTextures(3, textures);
+            glDeleteBuffers(3, buffers);
+            for (int i = 0; i < 3; i++)
+                textures[i] = buffers[i] = 0;
+        }
+    }
+
+    LightClusters(const LightClusters &) = delete;
+    LightClusters &operator=(const LightClusters &) = delete;
+
+    // the distance at which the light adds LIGHT_RANGE_THRESHOLD to its brightest channel, solved from
+    // constant + linear * d + quadratic * d^2 = brightness / threshold
+    static float Range(const PointLight &light)
+    {
+        glm::vec3 color = light.ambient + light.diffuse + light.specular;
+        float limit = std::max(color.x, std::max(color.y, color.z)) / LIGHT_RANGE_THRESHOLD - light.constant;
+        if (limit <= 0.0f)
+            return 0.0f;
+        if (light.quadratic > 0.0f)
+            return (-light.linear + std::sqrt(light.linear * light.linear + 4.0f * light.quadratic * limit)) / (2.0f * light.quadratic);
+        if (light.linear > 0.0f)
+            return limit / light.linear;
+        return 1e30f;
+    }
+
+    // sets the program's buffer texture samplers; the program must be in use
+    void Attach(const Shader &shader) const
+    {
+        shader.setInt("pointLightData", POINT_LIGHT_UNIT);
+        shader.setInt("clusterRanges", CLUSTER_RANGE_UNIT);
+        shader.setInt("clusterLightIndices", CLUSTER_INDEX_UNIT);
+    }
+
+    // assigns the lights to the clusters of the camera in frameUniforms, for a width x height image,
+    // uploads the lists and fills the cluster grid of the Lights block (uploaded by FrameUniforms)
+    void Update(FrameUniforms &frameUniforms, unsigned int width, unsigned int height)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        setProjection(frameUniforms.camera.projection);
+        int count = (int)std::min<size_t>(lights.size(), MAX_POINT_LIGHTS);
+        packLights(count);
+        placeLights(frameUniforms.camera.view, count);
+
+        // slices are claimed from a counter that is reset only once the light arrays are written, a
+        // helper that starts after every slice is taken does nothing
+        int helpers = std::min<int>((int)ThreadPool::Shared().ThreadCount(), count / CLUSTER_LIGHTS_PER_HELPER);
+        assignedLights = count;
+        doneSlices = 0;
+        nextSlice = 0;
+        for (int i = 0; i < helpers; i++)
+        {
+            helpersRunning++;
+            ThreadPool::Shared().Submit([this] {
+                assignSlices();
+                helpersRunning--;
+            });
+        }
+        assignSlices();
+        while (doneSlices < CLUSTER_SLICES)
+            std::this_thread::yield();
+        upload();
+
+        ClusterGridBlock &grid = frameUniforms.lights.clusterGrid;
+        grid.tileScale = glm::vec2((float)CLUSTERS_X / (float)width, (float)CLUSTERS_Y / (float)height);
+        grid.sliceScale = sliceScale;
+        grid.sliceBias = sliceBias;
+        grid.size = glm::ivec3(CLUSTERS_X, CLUSTERS_Y, CLUSTER_SLICES);
+        grid.pointLights = count;
+
+        stats.lights = count;
+        stats.helpers = helpers;
+        stats.assignMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    // a light that reaches a depth slice, and the screen tiles it covers there
+    struct Candidate {
+        uint16_t light;
+        uint8_t x0, x1, y0, y1;
+    };
+    // the lists of one depth slice, cluster after cluster in tile order
+    struct Slice {
+        std::vector<Candidate> candidates;
+        std::vector<uint16_t> indices;
+        uint32_t offsets[CLUSTERS_X * CLUSTERS_Y + 1];
+    };
+
+    GLuint buffers[3]; // light texels, cluster ranges, light indices
+    GLuint textures[3];
+    Slice slices[CLUSTER_SLICES];
+    std::atomic<int> nextSlice{CLUSTER_SLICES};
+    std::atomic<int> doneSlices{0};
+    std::atomic<int> helpersRunning{0};
+    int assignedLights = 0;
+
+    // a worker asked to help may not have looked at the counter yet
+    void waitForHelpers()
+    {
+        while (helpersRunning > 0)
+            std::this_thread::yield();
+    }
+
+    // view frustum: the planes through the eye between the tile columns (normal x and z) and rows
+    // (normal y and z), positive on the side of the higher tiles, and the depth slicing
+    glm::mat4 projection = glm::mat4(0.0f);
+    glm::vec2 columnPlanes[CLUSTERS_X + 1];
+    glm::vec2 rowPlanes[CLUSTERS_Y + 1];
+    float nearPlane = 0.0f, farPlane = 0.0f;
+    float sliceScale = 0.0f, sliceBias = 0.0f;
+    float sliceDepths[CLUSTER_SLICES + 1];
+
+    // the lights in view space, one array per component
+    std::vector<float> viewX, viewY, viewDepth, radius;
+    std::vector<int> firstSlice, lastSlice;
+
+    std::vector<glm::vec4> lightTexels, uploadedLightTexels;
+    std::vector<glm::uvec2> clusterRanges;
+    std::vector<uint16_t> lightIndices;
+
+    void setProjection(const glm::mat4 &matrix)
+    {
+        if (matrix == projection)
+            return;
+        projection = matrix;
+        float tanX = 1.0f / matrix[0][0];
+        float tanY = 1.0f / matrix[1][1];
+        nearPlane = matrix[3][2] / (matrix[2][2] - 1.0f);
+        farPlane = matrix[3][2] / (matrix[2][2] + 1.0f);
+        // a view space point (x, y, z) is right of the column boundary at NDC x = k where x + k tanX z > 0
+        for (int i = 0; i <= CLUSTERS_X; i++)
+        {
+            float k = (-1.0f + 2.0f * i / CLUSTERS_X) * tanX;
+            columnPlanes[i] = glm::vec2(1.0f, k) / std::sqrt(1.0f + k * k);
+        }
+        for (int i = 0; i <= CLUSTERS_Y; i++)
+        {
+            float k = (-1.0f + 2.0f * i / CLUSTERS_Y) * tanY;
+            rowPlanes[i] = glm::vec2(1.0f, k) / std::sqrt(1.0f + k * k);
+        }
+        float logRatio = std::log(farPlane / nearPlane);
+        sliceScale = CLUSTER_SLICES / logRatio;
+        sliceBias = -CLUSTER_SLICES * std::log(nearPlane) / logRatio;
+        for (int i = 0; i <= CLUSTER_SLICES; i++)
+            sliceDepths[i] = nearPlane * std::pow(farPlane / nearPlane, (float)i / CLUSTER_SLICES);
+    }
+
+    int sliceOf(float depth) const
+    {
+        return std::min(CLUSTER_SLICES - 1, std::max(0, (int)(std::log(depth) * sliceScale + sliceBias)));
+    }
+
+    // the light buffer, uploaded only when a light changed
+    void packLights(int count)
+    {
+        lightTexels.resize(count * POINT_LIGHT_TEXELS);
+        radius.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            const PointLight &light = lights[i];
+            radius[i] = Range(light);
+            glm::vec4 *texel = &lightTexels[i * POINT_LIGHT_TEXELS];
+            texel[0] = glm::vec4(light.position, radius[i]);
+            texel[1] = glm::vec4(light.ambient, light.constant);
+            texel[2] = glm::vec4(light.diffuse, light.linear);
+            texel[3] = glm::vec4(light.specular, light.quadratic);
+        }
+        if (lightTexels.size() == uploadedLightTexels.size() &&
+            memcmp(lightTexels.data(), uploadedLightTexels.data(), lightTexels.size() * sizeof(glm::vec4)) == 0)
+            return;
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[0]);
+        glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(16, lightTexels.size() * sizeof(glm::vec4)), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, lightTexels.size() * sizeof(glm::vec4), lightTexels.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        uploadedLightTexels = lightTexels;
+    }
+
+    // view space positions and the depth slices each light's sphere reaches
+    void placeLights(const glm::mat4 &view, int count)
+    {
+        viewX.resize(count);
+        viewY.resize(count);
+        viewDepth.resize(count);
+        firstSlice.resize(count);
+        lastSlice.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            const glm::vec3 &p = lights[i].position;
+            viewX[i] = view[0][0] * p.x + view[1][0] * p.y + view[2][0] * p.z + view[3][0];
+            viewY[i] = view[0][1] * p.x + view[1][1] * p.y + view[2][1] * p.z + view[3][1];
+            viewDepth[i] = -(view[0][2] * p.x + view[1][2] * p.y + view[2][2] * p.z + view[3][2]);
+        }
+        for (int i = 0; i < count; i++)
+        {
+            float nearEdge = viewDepth[i] - radius[i];
+            float farEdge = viewDepth[i] + radius[i];
+            if (radius[i] <= 0.0f || farEdge < nearPlane || nearEdge > farPlane)
+            {
+                firstSlice[i] = 1;
+                lastSlice[i] = 0;
+                continue;
+            }
+            firstSlice[i] = nearEdge <= nearPlane ? 0 : sliceOf(nearEdge);
+            lastSlice[i] = farEdge >= farPlane ? CLUSTER_SLICES - 1 : sliceOf(farEdge);
+        }
+    }
+
+    // runs on this thread and the helpers until every slice is taken
+    void assignSlices()
+    {
+        for (int slice = nextSlice++; slice < CLUSTER_SLICES; slice = nextSlice++)
+        {
+            assignSlice(slice);
+            doneSlices++;
+        }
+    }
+
+    // the first tile of a row or column of boundary planes the sphere reaches, and the last
+    static bool tileRange(const glm::vec2 *planes, int tiles, float along, float depth, float r, int &first, int &last)
+    {
+        // distance to the plane of a view space point with z = -depth
+        auto distance = [planes, along, depth](int i) { return planes[i].x * along - planes[i].y * depth; };
+        if (distance(0) <= -r || distance(tiles) >= r)
+            return false;
+        first = 0;
+        while (first < tiles - 1 && distance(first + 1) >= r)
+            first++;
+        last = tiles - 1;
+        while (last > first && distance(last) <= -r)
+            last--;
+        return true;
+    }
+
+    void assignSlice(int slice)
+    {
+        Slice &out = slices[slice];
+        float sliceNear = sliceDepths[slice];
+        float sliceFar = sliceDepths[slice + 1];
+
+        // the part of a sphere inside the slice lies inside the sphere around the cross section at the
+        // slice face nearest its center, so tiles are tested against that smaller sphere
+        out.candidates.clear();
+        for (int i = 0; i < assignedLights; i++)
+        {
+            if (firstSlice[i] > slice || lastSlice[i] < slice)
+                continue;
+            float depth = viewDepth[i];
+            float r = radius[i];
+            float face = std::min(std::max(depth, sliceNear), sliceFar);
+            if (face != depth)
+            {
+                float offset = face - depth;
+                r = std::sqrt(std::max(0.0f, r * r - offset * offset));
+                depth = face;
+            }
+            int x0, x1, y0, y1;
+            if (!tileRange(columnPlanes, CLUSTERS_X, viewX[i], depth, r, x0, x1) ||
+                !tileRange(rowPlanes, CLUSTERS_Y, viewY[i], depth, r, y0, y1))
+                continue;
+            Candidate candidate = {(uint16_t)i, (uint8_t)x0, (uint8_t)x1, (uint8_t)y0, (uint8_t)y1};
+            out.candidates.push_back(candidate);
+        }
+
+        // count per cluster, then list the lights in the clusters' runs in light order
+        uint32_t *offsets = out.offsets;
+        std::fill(offsets, offsets + CLUSTERS_X * CLUSTERS_Y + 1, 0u);
+        for (const Candidate &candidate : out.candidates)
+            for (int y = candidate.y0; y <= candidate.y1; y++)
+                for (int x = candidate.x0; x <= candidate.x1; x++)
+                    offsets[y * CLUSTERS_X + x + 1]++;
+        for (int i = 0; i < CLUSTERS_X * CLUSTERS_Y; i++)
+            offsets[i + 1] += offsets[i];
+        out.indices.resize(offsets[CLUSTERS_X * CLUSTERS_Y]);
+        uint32_t cursors[CLUSTERS_X * CLUSTERS_Y];
+        std::copy(offsets, offsets + CLUSTERS_X * CLUSTERS_Y, cursors);
+        for (const Candidate &candidate : out.candidates)
+            for (int y = candidate.y0; y <= candidate.y1; y++)
+                for (int x = candidate.x0; x <= candidate.x1; x++)
+                    out.indices[cursors[y * CLUSTERS_X + x]++] = candidate.light;
+    }
+
+    // joins the slices' lists into the cluster ranges and the index list and uploads both
+    void upload()
+    {
+        clusterRanges.resize(CLUSTER_COUNT);
+        lightIndices.clear();
+        stats.maxPerCluster = 0;
+        for (int slice = 0; slice < CLUSTER_SLICES; slice++)
+        {
+            const Slice &in = slices[slice];
+            uint32_t base = (uint32_t)lightIndices.size();
+            for (int tile = 0; tile < CLUSTERS_X * CLUSTERS_Y; tile++)
+            {
+                uint32_t lightCount = in.offsets[tile + 1] - in.offsets[tile];
+                clusterRanges[slice * CLUSTERS_X * CLUSTERS_Y + tile] = glm::uvec2(base + in.offsets[tile], lightCount);
+                stats.maxPerCluster = std::max(stats.maxPerCluster, lightCount);
+            }
+            lightIndices.insert(lightIndices.end(), in.indices.begin(), in.indices.end());
+        }
+        stats.references = (unsigned int)lightIndices.size();
+
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[1]);
+        glBufferData(GL_TEXTURE_BUFFER, clusterRanges.size() * sizeof(glm::uvec2), clusterRanges.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[2]);
+        glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(16, lightIndices.size() * sizeof(uint16_t)), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, lightIndices.size() * sizeof(uint16_t), lightIndices.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        const unsigned int units[3] = {POINT_LIGHT_UNIT, CLUSTER_RANGE_UNIT, CLUSTER_INDEX_UNIT};
+        for (int i = 0; i < 3; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + units[i]);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+};
+#endif
@@ -0,0 +1,91 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <learnopengl/hash.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// size and modification time of a file, used to cheaply tell whether a source asset changed
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0; // nanoseconds since epoch
+
+    static bool Get(const std::string &path, FileStamp &stamp)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return false;
+        stamp.size = (uint64_t)st.st_size;
+        stamp.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        return true;
+    }
+};
+
+// whether the source a derived file (mesh cache, cooked texture) was built from is still the same, given the
+// size, mtime and content hash recorded at build time. The source is only hashed when its mtime changed;
+// a missing source counts as unchanged, so derived files keep working without the originals.
+inline bool SourceUnchanged(const std::string &path, uint64_t size, int64_t mtime, uint64_t hash)
+{
+    FileStamp stamp;
+    if (!FileStamp::Get(path, stamp))
+        return true;
+    if (stamp.size != size)
+        return false;
+    uint64_t current;
+    return stamp.mtime == mtime || (HashFile(path, current) && current == hash);
+}
+
+// read-only memory mapping of a whole file. The pages are shared with the OS file cache,
+// so reading from it does not copy anything until the data is actually touched.
+class MappedFile
+{
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { Close(); }
+
+    bool Open(const std::string &path)
+    {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+        void *mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // the mapping keeps its own reference to the file
+        if (mapping == MAP_FAILED)
+            return false;
+        data = static_cast<const unsigned char *>(mapping);
+        size = (size_t)st.st_size;
+        return true;
+    }
+
+    void Close()
+    {
+        if (data)
+            munmap(const_cast<unsigned char *>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+
+    const unsigned char *Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+};
+#endif
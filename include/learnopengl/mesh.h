@@ -5,9 +5,17 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include <learnopengl/sampler_cache.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_registry.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 using namespace std;
@@ -25,7 +33,102 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// how a mesh keeps its vertices on the GPU. Either way the buffer holds the positions of all vertices
+// first, a stream of their own for the depth pre-pass, then the rest of every vertex
+enum VertexFormat {
+    VERTEX_FULL,        // Vertex as is, 56 bytes
+    VERTEX_COMPRESSED   // CompressedVertex, 20 bytes
+};
+
+// Vertex packed for fetch bandwidth. The vertex shaders decode it (see vertexFormat in model.vs):
+// the position is 16 bits per axis within the mesh's aabb, normal and tangent are octahedral
+// encoded unit vectors, the bitangent is reduced to its sign (it is cross(normal, tangent) up to
+// that sign) and the texture coordinates are half floats.
+struct CompressedVertex {
+    uint16_t position[4];   // xyz: unorm16 within the aabb, w: bitangent sign, 0 for -1 and 65535 for +1
+    int16_t normal[2];      // snorm16 octahedral
+    int16_t tangent[2];     // snorm16 octahedral
+    uint16_t texCoords[2];  // half floats
+};
 
+// half floats keep 11 significant bits; beyond this the texture coordinates lose too much
+// precision and the mesh stays in the full format
+const float MAX_COMPRESSED_TEXCOORD = 2.0f;
+
+// maps a unit vector onto the octahedron, unfolded into the [-1, 1] square
+inline glm::vec2 OctahedralEncode(glm::vec3 v)
+{
+    float l1 = std::fabs(v.x) + std::fabs(v.y) + std::fabs(v.z);
+    if (!(l1 > 0.0f) || !std::isfinite(l1))
+        return glm::vec2(0.0f); // no direction (e.g. no tangents without texture coordinates)
+    v /= l1;
+    glm::vec2 encoded(v.x, v.y);
+    if (v.z < 0.0f)
+    {
+        encoded.x = (1.0f - std::fabs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f);
+        encoded.y = (1.0f - std::fabs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return encoded;
+}
+
+inline int16_t PackSnorm16(float value)
+{
+    return (int16_t)std::lround(std::max(-1.0f, std::min(1.0f, value)) * 32767.0f);
+}
+
+inline uint16_t PackUnorm16(float value)
+{
+    return (uint16_t)std::lround(std::max(0.0f, std::min(1.0f, value)) * 65535.0f);
+}
+
+// packs a vertex; positions are stored relative to the box at aabbMin with size extent
+inline CompressedVertex CompressVertex(const Vertex &vertex, glm::vec3 aabbMin, glm::vec3 extent)
+{
+    CompressedVertex packed;
+    for (int c = 0; c < 3; c++)
+        packed.position[c] = extent[c] > 0.0f ? PackUnorm16((vertex.Position[c] - aabbMin[c]) / extent[c]) : 0;
+    bool rightHanded = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) >= 0.0f;
+    packed.position[3] = rightHanded ? 65535 : 0;
+    glm::vec2 normal = OctahedralEncode(vertex.Normal);
+    glm::vec2 tangent = OctahedralEncode(vertex.Tangent);
+    for (int c = 0; c < 2; c++)
+    {
+        packed.normal[c] = PackSnorm16(normal[c]);
+        packed.tangent[c] = PackSnorm16(tangent[c]);
+        packed.texCoords[c] = glm::packHalf1x16(vertex.TexCoords[c]);
+    }
+    return packed;
+}
+
+// first of the four attribute locations holding the per-instance model matrix
+const unsigned int INSTANCE_MATRIX_LOCATION = 5;
+// first of the three attribute locations holding the per-instance normal matrix
+const unsigned int INSTANCE_NORMAL_MATRIX_LOCATION = 9;
+
+// what the instance buffers hold per instance: its model matrix and the inverse transpose of the
+// matrix's upper 3x3, which transforms normals and tangents; computed once here instead of per vertex
+struct InstanceData {
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+
+    InstanceData() = default;
+    explicit InstanceData(const glm::mat4 &model) : model(model), normalMatrix(glm::transpose(glm::inverse(glm::mat3(model))))
+    {
+    }
+};
+
+// most levels of detail a mesh keeps, the full mesh included
+const unsigned int MAX_MESH_LODS = 4;
+// how far (as a fraction of the allowed pixel error) a level's error has to move past the limit
+// before an instance switches to it, so instances near a threshold don't pop back and forth
+const float LOD_HYSTERESIS = 0.25f;
+
+// one level of detail: a range of the mesh's index buffer, indexing the same vertices as the full mesh
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float error; // how far (in model space) the simplified surface may be from the full one
+};
 
 struct Texture {
     unsigned int id;
@@ -41,29 +144,303 @@ public:
     vector<Texture>      textures;
 
     unsigned int VAO;
+    // the same indices over just the position stream, the first part of the vertex buffer: what the
+    // depth pre-pass (RenderQueue::ExecuteDepthPrepass) fetches, location 0 and the instance model matrix only
+    unsigned int depthVAO;
+    // indices of the full mesh (level of detail 0); the index buffer holds every level one after the other
+    unsigned int indexCount;
+    // GL_UNSIGNED_SHORT for meshes with fewer than 65536 vertices, GL_UNSIGNED_INT otherwise
+    GLenum indexType;
+    unsigned int vertexCount;
+    // layout of the vertex buffer; positionOffset + position * positionScale gives the model space position
+    VertexFormat format = VERTEX_FULL;
+    glm::vec3 positionOffset, positionScale;
+    // levels of detail, the full mesh first and then ever coarser ones
+    vector<MeshLod> lods;
+    // bounding volumes in model space, used for culling
+    glm::vec3 aabbMin, aabbMax;
+    glm::vec3 sphereCenter;
+    float sphereRadius;
     std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+
+    // material binding table, built once when the textures or the sampler prefix change: entry i is
+    // bound to texture unit i together with samplerObject and feeds the sampler uniform with the given name
+    struct TextureBinding {
+        string sampler;
+        unsigned int texture;
+        unsigned int samplerObject;
+    };
+    vector<TextureBinding> bindings;
+    // constructor; indices holds the given levels of detail one after the other (just the full mesh if there are none)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, VertexFormat format = VERTEX_FULL,
+         vector<MeshLod> lods = vector<MeshLod>())
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        setLods(lods, this->indices.size());
+
+        aabbMin = glm::vec3(0.0f);
+        aabbMax = glm::vec3(0.0f);
+        if (!this->vertices.empty())
+        {
+            aabbMin = aabbMax = this->vertices[0].Position;
+            for (const Vertex &vertex : this->vertices)
+            {
+                aabbMin = glm::min(aabbMin, vertex.Position);
+                aabbMax = glm::max(aabbMax, vertex.Position);
+            }
+        }
+        computeBoundingSphere(this->vertices.data(), this->vertices.size());
+        buildBindings();
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        if (IndexSizeFor(this->vertices.size()) == sizeof(uint16_t))
+        {
+            vector<uint16_t> shortIndices(this->indices.begin(), this->indices.end());
+            setupMesh(this->vertices.data(), this->vertices.size(), shortIndices.data(), shortIndices.size(), GL_UNSIGNED_SHORT, format);
+        }
+        else
+            setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size(), GL_UNSIGNED_INT, format);
+    }
+
+    // constructor for geometry that lives in memory the mesh doesn't own (e.g. a memory-mapped mesh cache).
+    // the data is uploaded straight from there and is not copied into vertices/indices.
+    // indexData holds 16-bit indices when the vertex count allows them (see IndexSizeFor), 32-bit otherwise.
+    Mesh(const Vertex *vertexData, size_t vertexCount, const void *indexData, size_t indexCount,
+         vector<Texture> textures, glm::vec3 aabbMin, glm::vec3 aabbMax, VertexFormat format = VERTEX_FULL,
+         vector<MeshLod> lods = vector<MeshLod>())
+    {
+        this->textures = textures;
+        setLods(lods, indexCount);
+        this->aabbMin = aabbMin;
+        this->aabbMax = aabbMax;
+        computeBoundingSphere(vertexData, vertexCount);
+        buildBindings();
+
+        setupMesh(vertexData, vertexCount, indexData, indexCount,
+                  IndexSizeFor(vertexCount) == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, format);
+    }
+
+    // deletes the GL objects. Copies of a mesh share them, so only for a mesh that was never copied
+    // to somewhere it is still drawn from.
+    void Destroy()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteVertexArrays(1, &depthVAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = depthVAO = VBO = EBO = 0;
+    }
+
+    // bytes per index for a mesh with the given number of vertices
+    static size_t IndexSizeFor(size_t vertexCount)
+    {
+        return vertexCount < 65536 ? sizeof(uint16_t) : sizeof(unsigned int);
     }
 
     // render the mesh
     void Draw(Shader &shader)
     {
-        // bind appropriate textures
+        SetVertexUniforms(shader);
+        bindTextures(shader);
+
+        // draw mesh
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+        glBindVertexArray(0);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // render instanceCount copies of the mesh (at the given level of detail) in a single draw call,
+    // each with its own model matrix taken from the buffer attached with SetInstanceBuffer
+    void DrawInstanced(Shader &shader, unsigned int instanceCount, unsigned int lod = 0)
+    {
+        SetVertexUniforms(shader);
+        bindTextures(shader);
+
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, lods[lod].indexCount, indexType, LodIndexOffset(lod), instanceCount);
+        glBindVertexArray(0);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // offset of a level's indices in the index buffer, as glDrawElements expects it
+    const void *LodIndexOffset(unsigned int lod) const
+    {
+        return (const void *)((size_t)lods[lod].firstIndex * (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int)));
+    }
+
+    // level of detail for an instance that covers pixelsPerUnit pixels per model space unit: the
+    // coarsest level whose error stays within maxPixelError pixels. current is the instance's level
+    // in the previous frame; a coarser level has to beat the limit by LOD_HYSTERESIS and the current
+    // or a finer one may exceed it by as much, so the choice only flips after a clear change.
+    unsigned int SelectLod(float pixelsPerUnit, float maxPixelError, unsigned int current) const
+    {
+        for (unsigned int lod = (unsigned int)lods.size() - 1; lod > 0; lod--)
+        {
+            float limit = maxPixelError * (lod > current ? 1.0f - LOD_HYSTERESIS : 1.0f + LOD_HYSTERESIS);
+            if (lods[lod].error * pixelsPerUnit <= limit)
+                return lod;
+        }
+        return 0;
+    }
+
+    // sets the prefix of the sampler names (e.g. "material." for samplers inside a struct)
+    void SetSamplerPrefix(const std::string &prefix)
+    {
+        glslIdentifierPrefix = prefix;
+        buildBindings();
+    }
+
+    // feeds the per-instance InstanceData from the given buffer, starting at offset bytes, to attribute
+    // locations 5-8 (the model matrix takes four vec4 slots) and 9-11 (the normal matrix, three vec3),
+    // advancing once per instance instead of once per vertex; the depth VAO gets the model matrix.
+    // Nothing is touched if the VAOs already read from there; returns whether they had to be updated
+    // (which leaves no VAO bound).
+    bool SetInstanceBuffer(unsigned int buffer, size_t offset = 0)
+    {
+        if (buffer == instanceBuffer && offset == instanceOffset)
+            return false;
+        instanceBuffer = buffer;
+        instanceOffset = offset;
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + column);
+            glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_MATRIX_LOCATION + column, 1);
+        }
+        for (unsigned int column = 0; column < 3; column++)
+        {
+            glEnableVertexAttribArray(INSTANCE_NORMAL_MATRIX_LOCATION + column);
+            glVertexAttribPointer(INSTANCE_NORMAL_MATRIX_LOCATION + column, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  (void*)(offset + offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec3)));
+            glVertexAttribDivisor(INSTANCE_NORMAL_MATRIX_LOCATION + column, 1);
+        }
+        glBindVertexArray(depthVAO);
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + column);
+            glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_MATRIX_LOCATION + column, 1);
+        }
+        glBindVertexArray(0);
+        return true;
+    }
+
+    // re-uploads the vertices (the same ones the mesh was created from) in another format. Meshes whose
+    // texture coordinates don't fit in half floats stay in the full format.
+    void SetVertexFormat(VertexFormat format, const Vertex *vertexData, size_t vertexCount)
+    {
+        uploadVertices(vertexData, vertexCount, format);
+        glBindVertexArray(0);
+    }
+
+    // whether the material has a texture of the type ("texture_height", ...)
+    bool HasTexture(const string &type) const
+    {
+        for (const Texture &texture : textures)
+            if (texture.type == type)
+                return true;
+        return false;
+    }
+
+    // bytes per vertex in the vertex buffer, the position stream and the other attributes together
+    size_t VertexStride() const
+    {
+        return format == VERTEX_COMPRESSED ? sizeof(CompressedVertex) : sizeof(Vertex);
+    }
+
+    // bytes per vertex in the position stream, at the start of the vertex buffer
+    size_t PositionStride() const
+    {
+        return format == VERTEX_COMPRESSED ? sizeof(CompressedVertex::position) : sizeof(glm::vec3);
+    }
+
+    // sets the uniforms the vertex shader decodes this mesh's vertex format with
+    void SetVertexUniforms(Shader &shader)
+    {
+        resolveUniforms(shader);
+        shader.setBool(vertexUniforms[0], format == VERTEX_COMPRESSED);
+        shader.setVec3(vertexUniforms[1], positionOffset);
+        shader.setVec3(vertexUniforms[2], positionScale);
+    }
+
+    // sampler uniform indices of the binding table entries for the given program, for code that binds
+    // the textures itself (the render queue). Resolved by name only when the program changes.
+    const int *SamplerUniforms(const Shader &shader)
+    {
+        resolveUniforms(shader);
+        return samplerUniforms.data();
+    }
+
+private:
+    // render data
+    unsigned int VBO, EBO;
+    // where the instance attributes currently point to
+    unsigned int instanceBuffer = 0;
+    size_t instanceOffset = 0;
+
+    // a single level covering all indices when none are given
+    void setLods(const vector<MeshLod> &lods, size_t indexCount)
+    {
+        this->lods = lods;
+        if (this->lods.empty())
+        {
+            MeshLod full;
+            full.firstIndex = 0;
+            full.indexCount = (unsigned int)indexCount;
+            full.error = 0.0f;
+            this->lods.push_back(full);
+        }
+    }
+
+    // sphere around the center of the aabb, just large enough to hold every vertex
+    void computeBoundingSphere(const Vertex *vertexData, size_t vertexCount)
+    {
+        sphereCenter = (aabbMin + aabbMax) * 0.5f;
+        float radiusSquared = 0.0f;
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            glm::vec3 offset = vertexData[i].Position - sphereCenter;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+        sphereRadius = std::sqrt(radiusSquared);
+    }
+
+    // sampler and vertex format uniforms of the program the mesh was last drawn with
+    GLuint samplerProgram = 0;
+    vector<int> samplerUniforms;
+    int vertexUniforms[3];
+
+    void resolveUniforms(const Shader &shader)
+    {
+        if (shader.ID == samplerProgram)
+            return;
+        samplerProgram = shader.ID;
+        for(unsigned int i = 0; i < bindings.size(); i++)
+            samplerUniforms[i] = shader.findUniform(bindings[i].sampler);
+        vertexUniforms[0] = shader.findUniform("vertexFormat.compressed");
+        vertexUniforms[1] = shader.findUniform("vertexFormat.positionOffset");
+        vertexUniforms[2] = shader.findUniform("vertexFormat.positionScale");
+    }
+
+    // names every texture's sampler following the texture_diffuseN, texture_specularN, ... convention.
+    // all string work happens here, at load time, never while drawing.
+    void buildBindings()
+    {
+        bindings.clear();
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -76,64 +453,162 @@ public:
             else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
 
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            TextureBinding binding;
+            binding.sampler = glslIdentifierPrefix + name + number;
+            binding.texture = textures[i].id;
+            binding.samplerObject = SamplerCache::Get(SAMPLER_REPEAT);
+            bindings.push_back(binding);
         }
-
-
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        // a map the material lacks (or a material that wasn't found) is sampled from a default texture;
+        // unbound, the sampler would read what the previous mesh drawn with the program left on its unit
+        const unsigned int counts[3] = {diffuseNr, specularNr, normalNr};
+        const char *const names[3] = {"texture_diffuse1", "texture_specular1", "texture_normal1"};
+        const TextureKind kinds[3] = {TEXTURE_COLOR, TEXTURE_DATA, TEXTURE_NORMAL};
+        for(unsigned int i = 0; i < 3; i++)
+        {
+            if(counts[i] > 1)
+                continue;
+            TextureBinding binding;
+            binding.sampler = glslIdentifierPrefix + names[i];
+            binding.texture = TextureRegistry::Default(kinds[i]);
+            binding.samplerObject = SamplerCache::Get(SAMPLER_REPEAT);
+            bindings.push_back(binding);
+        }
+        samplerProgram = 0;
+        samplerUniforms.assign(bindings.size(), -1);
     }
 
-private:
-    // render data
-    unsigned int VBO, EBO;
+    // sets the sampler uniforms and binds the textures of the mesh. Sampler names are looked up
+    // only when the mesh is drawn with a different program than last time; after that this is
+    // just the texture binds plus the uniform cache skipping unchanged sampler values.
+    void bindTextures(Shader &shader)
+    {
+        const int *samplers = SamplerUniforms(shader);
+        for(unsigned int i = 0; i < bindings.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // now set the sampler to the correct texture unit
+            shader.setInt(samplers[i], i);
+            // and finally bind the texture and how it is sampled
+            glBindTexture(GL_TEXTURE_2D, bindings[i].texture);
+            glBindSampler(i, bindings[i].samplerObject);
+        }
+    }
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex *vertexData, size_t vertexCount, const void *indexData, size_t indexCount, GLenum indexType, VertexFormat format)
     {
+        this->indexCount = lods[0].indexCount;
+        this->indexType = indexType;
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
+        glGenVertexArrays(1, &depthVAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
+        glBindVertexArray(depthVAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int)), indexData, GL_STATIC_DRAW);
 
-        // set the vertex attribute pointers
-        // vertex Positions
+        uploadVertices(vertexData, vertexCount, format);
+        glBindVertexArray(0);
+    }
+
+    // fills the vertex buffer in the given format, split into the position stream and the other
+    // attributes, points attributes 0-4 of the VAO and the position of the depth VAO at it (leaves the VAO bound)
+    void uploadVertices(const Vertex *vertexData, size_t vertexCount, VertexFormat format)
+    {
+        this->vertexCount = (unsigned int)vertexCount;
+        if (format == VERTEX_COMPRESSED)
+        {
+            for (size_t i = 0; i < vertexCount; i++)
+            {
+                const glm::vec2 &uv = vertexData[i].TexCoords;
+                if (!(std::fabs(uv.x) <= MAX_COMPRESSED_TEXCOORD && std::fabs(uv.y) <= MAX_COMPRESSED_TEXCOORD))
+                {
+                    format = VERTEX_FULL;
+                    break;
+                }
+            }
+        }
+        this->format = format;
+
+        size_t stride = VertexStride();
+        size_t positionSize = PositionStride();
+        vector<unsigned char> split;
+        if (format == VERTEX_COMPRESSED)
+        {
+            positionOffset = aabbMin;
+            positionScale = aabbMax - aabbMin;
+            vector<CompressedVertex> packed(vertexCount);
+            for (size_t i = 0; i < vertexCount; i++)
+                packed[i] = CompressVertex(vertexData[i], positionOffset, positionScale);
+            split = splitPositions(packed.data(), vertexCount, stride, positionSize);
+        }
+        else
+        {
+            positionOffset = glm::vec3(0.0f);
+            positionScale = glm::vec3(1.0f);
+            split = splitPositions(vertexData, vertexCount, stride, positionSize);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, split.size(), split.data(), GL_STATIC_DRAW);
+
+        // the position stream, for both VAOs
+        GLint positionComponents = format == VERTEX_COMPRESSED ? 4 : 3;
+        GLenum positionType = format == VERTEX_COMPRESSED ? GL_UNSIGNED_SHORT : GL_FLOAT;
+        GLboolean positionNormalized = format == VERTEX_COMPRESSED ? GL_TRUE : GL_FALSE;
+        glBindVertexArray(depthVAO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, positionComponents, positionType, positionNormalized, (GLsizei)positionSize, (void*)0);
+        glBindVertexArray(VAO);
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glVertexAttribPointer(0, positionComponents, positionType, positionNormalized, (GLsizei)positionSize, (void*)0);
+
+        // the other attributes follow the positions of all vertices; offset is the attribute's offset in the vertex struct
+        size_t attributesStart = vertexCount * positionSize;
+        GLsizei attributesStride = (GLsizei)(stride - positionSize);
+        auto attribute = [attributesStart, attributesStride, positionSize](GLuint location, GLint size, GLenum type, GLboolean normalized, size_t offset) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, size, type, normalized, attributesStride, (void*)(attributesStart + offset - positionSize));
+        };
+        if (format == VERTEX_COMPRESSED)
+        {
+            // the normalized integer attributes arrive in the shader already scaled to [0, 1] / [-1, 1]
+            attribute(1, 2, GL_SHORT, GL_TRUE, offsetof(CompressedVertex, normal));
+            attribute(2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(CompressedVertex, texCoords));
+            attribute(3, 2, GL_SHORT, GL_TRUE, offsetof(CompressedVertex, tangent));
+            // no bitangent, the shaders rebuild it from the normal and tangent
+            glDisableVertexAttribArray(4);
+            return;
+        }
+
         // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        attribute(1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal));
         // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        attribute(2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords));
         // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        attribute(3, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Tangent));
         // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        attribute(4, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Bitangent));
+    }
 
-        glBindVertexArray(0);
+    // interleaved vertices (position first, positionSize bytes) as the vertex buffer holds them: the
+    // positions of all vertices, then the rest of every vertex
+    static vector<unsigned char> splitPositions(const void *vertices, size_t count, size_t stride, size_t positionSize)
+    {
+        const unsigned char *source = (const unsigned char *)vertices;
+        vector<unsigned char> split(count * stride);
+        unsigned char *attributes = split.data() + count * positionSize;
+        for (size_t i = 0; i < count; i++)
+        {
+            std::memcpy(split.data() + i * positionSize, source + i * stride, positionSize);
+            std::memcpy(attributes + i * (stride - positionSize), source + i * stride + positionSize, stride - positionSize);
+        }
+        return split;
     }
 };
 #endif
\ No newline at end of file
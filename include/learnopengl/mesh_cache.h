@@ -0,0 +1,305 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_import.h>
+#include <learnopengl/hash.h>
+#include <learnopengl/mapped_file.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+using namespace std;
+
+// Binary cache of a model's processed meshes, written next to the source file after the first
+// Assimp import (<model>.meshcache) and memory-mapped on later runs. File layout, every section
+// 16-byte aligned and every offset relative to the start of the file:
+//   MeshCacheHeader
+//   MeshCacheEntry[meshCount]
+//   MeshCacheTexture[textureCount]
+//   string blob (texture types and paths, not null terminated)
+//   vertex and index arrays, stored exactly as they get uploaded to the GPU (optimized meshes,
+//   16-bit indices when the mesh has fewer than 65536 vertices, every level of detail's indices
+//   after the full mesh's)
+const char MESH_CACHE_MAGIC[4] = {'R', 'G', 'M', 'C'};
+const uint32_t MESH_CACHE_VERSION = 3;
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexSize;   // sizeof(Vertex) at write time, guards against layout changes
+    uint32_t importFlags;  // Assimp post-processing flags the data was produced with
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;   // FNV-1a of the source file, checked when the mtime changed
+    double importMillis;   // how long the cold import took, for the startup report
+    uint32_t meshCount;
+    uint32_t textureCount;
+    uint64_t entriesOffset;
+    uint64_t texturesOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+};
+
+struct MeshCacheEntry {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTexture;
+    uint32_t textureCount;
+    float aabbMin[3];
+    float aabbMax[3];
+    uint32_t indexSize;  // bytes per index, 2 or 4
+    uint32_t lodCount;   // levels of detail, the full mesh included
+    uint32_t lodFirstIndex[MAX_MESH_LODS];
+    uint32_t lodIndexCount[MAX_MESH_LODS];
+    float lodError[MAX_MESH_LODS];
+};
+
+struct MeshCacheTexture {
+    uint32_t typeOffset;
+    uint32_t typeLength;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+// one cached mesh; vertices and indices point straight into the mapping
+struct CachedMesh {
+    const Vertex *vertices;
+    uint32_t vertexCount;
+    const void *indices;  // Mesh::IndexSizeFor(vertexCount) bytes each
+    uint32_t indexCount;
+    glm::vec3 aabbMin, aabbMax;
+    vector<MeshLod> lods;
+    vector<pair<string, string>> textures; // (type, path) pairs, same order as Mesh::textures
+};
+
+class MeshCache
+{
+public:
+    static string PathFor(const string &sourcePath)
+    {
+        return sourcePath + ".meshcache";
+    }
+
+    // maps the cache of the given model and checks that it is still valid for the source file.
+    // the source is only hashed when its mtime changed; a missing source keeps the cache usable.
+    bool Open(const string &sourcePath, uint32_t importFlags)
+    {
+        header = nullptr;
+        if (!file.Open(PathFor(sourcePath)) || file.Size() < sizeof(MeshCacheHeader))
+            return false;
+        const MeshCacheHeader *h = reinterpret_cast<const MeshCacheHeader *>(file.Data());
+        if (memcmp(h->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 || h->version != MESH_CACHE_VERSION ||
+            h->vertexSize != sizeof(Vertex) || h->importFlags != importFlags)
+            return invalidate();
+
+        if (!SourceUnchanged(sourcePath, h->sourceSize, h->sourceMtime, h->sourceHash))
+            return invalidate();
+
+        if (!inBounds(h->entriesOffset, (uint64_t)h->meshCount * sizeof(MeshCacheEntry)) ||
+            !inBounds(h->texturesOffset, (uint64_t)h->textureCount * sizeof(MeshCacheTexture)) ||
+            !inBounds(h->stringsOffset, h->stringsSize))
+            return invalidate();
+        header = h;
+        for (uint32_t i = 0; i < h->meshCount; i++)
+        {
+            const MeshCacheEntry &entry = entries()[i];
+            if (entry.indexSize != Mesh::IndexSizeFor(entry.vertexCount) ||
+                !inBounds(entry.vertexOffset, (uint64_t)entry.vertexCount * sizeof(Vertex)) ||
+                !inBounds(entry.indexOffset, (uint64_t)entry.indexCount * entry.indexSize) ||
+                (uint64_t)entry.firstTexture + entry.textureCount > h->textureCount ||
+                entry.lodCount == 0 || entry.lodCount > MAX_MESH_LODS)
+                return invalidate();
+            for (uint32_t lod = 0; lod < entry.lodCount; lod++)
+            {
+                if ((uint64_t)entry.lodFirstIndex[lod] + entry.lodIndexCount[lod] > entry.indexCount)
+                    return invalidate();
+            }
+        }
+        for (uint32_t i = 0; i < h->textureCount; i++)
+        {
+            const MeshCacheTexture &texture = textures()[i];
+            if ((uint64_t)texture.typeOffset + texture.typeLength > h->stringsSize ||
+                (uint64_t)texture.pathOffset + texture.pathLength > h->stringsSize)
+                return invalidate();
+        }
+        return true;
+    }
+
+    size_t MeshCount() const { return header ? header->meshCount : 0; }
+    double ColdImportMillis() const { return header ? header->importMillis : 0.0; }
+
+    CachedMesh GetMesh(size_t i) const
+    {
+        const MeshCacheEntry &entry = entries()[i];
+        CachedMesh mesh;
+        mesh.vertices = reinterpret_cast<const Vertex *>(file.Data() + entry.vertexOffset);
+        mesh.vertexCount = entry.vertexCount;
+        mesh.indices = file.Data() + entry.indexOffset;
+        mesh.indexCount = entry.indexCount;
+        mesh.aabbMin = glm::vec3(entry.aabbMin[0], entry.aabbMin[1], entry.aabbMin[2]);
+        mesh.aabbMax = glm::vec3(entry.aabbMax[0], entry.aabbMax[1], entry.aabbMax[2]);
+        for (uint32_t lod = 0; lod < entry.lodCount; lod++)
+        {
+            MeshLod level;
+            level.firstIndex = entry.lodFirstIndex[lod];
+            level.indexCount = entry.lodIndexCount[lod];
+            level.error = entry.lodError[lod];
+            mesh.lods.push_back(level);
+        }
+        const char *strings = reinterpret_cast<const char *>(file.Data() + header->stringsOffset);
+        for (uint32_t t = 0; t < entry.textureCount; t++)
+        {
+            const MeshCacheTexture &texture = textures()[entry.firstTexture + t];
+            mesh.textures.push_back(make_pair(string(strings + texture.typeOffset, texture.typeLength),
+                                              string(strings + texture.pathOffset, texture.pathLength)));
+        }
+        return mesh;
+    }
+
+    // serializes freshly imported meshes (by the viewer or the asset cooker). Written to a temporary file first and renamed,
+    // so a crash half way through never leaves a truncated cache behind.
+    static bool Write(const string &sourcePath, uint32_t importFlags, const vector<ImportedMesh> &meshes, double importMillis)
+    {
+        MeshCacheHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+        h.version = MESH_CACHE_VERSION;
+        h.vertexSize = sizeof(Vertex);
+        h.importFlags = importFlags;
+        FileStamp stamp;
+        if (!FileStamp::Get(sourcePath, stamp) || !HashFile(sourcePath, h.sourceHash))
+            return false;
+        h.sourceSize = stamp.size;
+        h.sourceMtime = stamp.mtime;
+        h.importMillis = importMillis;
+        h.meshCount = (uint32_t)meshes.size();
+
+        vector<MeshCacheEntry> entries(meshes.size());
+        vector<MeshCacheTexture> textures;
+        string strings;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            const ImportedMesh &mesh = meshes[i];
+            MeshCacheEntry &entry = entries[i];
+            memset(&entry, 0, sizeof(entry));
+            entry.vertexCount = (uint32_t)mesh.vertices.size();
+            entry.indexCount = (uint32_t)mesh.indices.size();
+            entry.indexSize = (uint32_t)Mesh::IndexSizeFor(mesh.vertices.size());
+            entry.firstTexture = (uint32_t)textures.size();
+            entry.textureCount = (uint32_t)mesh.textures.size();
+            entry.lodCount = (uint32_t)std::min<size_t>(mesh.lods.size(), MAX_MESH_LODS);
+            for (uint32_t lod = 0; lod < entry.lodCount; lod++)
+            {
+                entry.lodFirstIndex[lod] = mesh.lods[lod].firstIndex;
+                entry.lodIndexCount[lod] = mesh.lods[lod].indexCount;
+                entry.lodError[lod] = mesh.lods[lod].error;
+            }
+            for (int c = 0; c < 3; c++)
+            {
+                entry.aabbMin[c] = mesh.aabbMin[c];
+                entry.aabbMax[c] = mesh.aabbMax[c];
+            }
+            for (const pair<string, string> &texture : mesh.textures)
+            {
+                MeshCacheTexture ref;
+                ref.typeOffset = (uint32_t)strings.size();
+                ref.typeLength = (uint32_t)texture.first.size();
+                strings += texture.first;
+                ref.pathOffset = (uint32_t)strings.size();
+                ref.pathLength = (uint32_t)texture.second.size();
+                strings += texture.second;
+                textures.push_back(ref);
+            }
+        }
+        h.textureCount = (uint32_t)textures.size();
+
+        uint64_t offset = align(sizeof(MeshCacheHeader));
+        h.entriesOffset = offset;
+        offset = align(offset + entries.size() * sizeof(MeshCacheEntry));
+        h.texturesOffset = offset;
+        offset = align(offset + textures.size() * sizeof(MeshCacheTexture));
+        h.stringsOffset = offset;
+        h.stringsSize = strings.size();
+        offset = align(offset + strings.size());
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            entries[i].vertexOffset = offset;
+            offset = align(offset + meshes[i].vertices.size() * sizeof(Vertex));
+            entries[i].indexOffset = offset;
+            offset = align(offset + meshes[i].indices.size() * entries[i].indexSize);
+        }
+
+        string cachePath = PathFor(sourcePath);
+        string tmpPath = cachePath + ".tmp";
+        FILE *out = fopen(tmpPath.c_str(), "wb");
+        if (!out)
+            return false;
+        bool ok = writeAt(out, 0, &h, sizeof(h)) &&
+                  writeAt(out, h.entriesOffset, entries.data(), entries.size() * sizeof(MeshCacheEntry)) &&
+                  writeAt(out, h.texturesOffset, textures.data(), textures.size() * sizeof(MeshCacheTexture)) &&
+                  writeAt(out, h.stringsOffset, strings.data(), strings.size());
+        for (size_t i = 0; ok && i < meshes.size(); i++)
+        {
+            const vector<unsigned int> &indices = meshes[i].indices;
+            ok = writeAt(out, entries[i].vertexOffset, meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(Vertex));
+            if (entries[i].indexSize == sizeof(uint16_t))
+            {
+                vector<uint16_t> shortIndices(indices.begin(), indices.end());
+                ok = ok && writeAt(out, entries[i].indexOffset, shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+            }
+            else
+                ok = ok && writeAt(out, entries[i].indexOffset, indices.data(), indices.size() * sizeof(unsigned int));
+        }
+        ok = fclose(out) == 0 && ok;
+        if (!ok || rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+        {
+            remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    MappedFile file;
+    const MeshCacheHeader *header = nullptr;
+
+    const MeshCacheEntry *entries() const
+    {
+        return reinterpret_cast<const MeshCacheEntry *>(file.Data() + header->entriesOffset);
+    }
+    const MeshCacheTexture *textures() const
+    {
+        return reinterpret_cast<const MeshCacheTexture *>(file.Data() + header->texturesOffset);
+    }
+    bool inBounds(uint64_t offset, uint64_t size) const
+    {
+        return offset <= file.Size() && size <= file.Size() - offset;
+    }
+    bool invalidate()
+    {
+        header = nullptr;
+        file.Close();
+        return false;
+    }
+
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + 15) & ~(uint64_t)15;
+    }
+    static bool writeAt(FILE *out, uint64_t offset, const void *data, size_t size)
+    {
+        if (fseek(out, (long)offset, SEEK_SET) != 0)
+            return false;
+        return size == 0 || fwrite(data, 1, size, out) == size;
+    }
+};
+#endif
@@ -0,0 +1,193 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+#include <glm/glm.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplifier.h>
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// post-processing applied to every import, also part of the mesh cache key
+const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+// one mesh of a model as it comes out of the import: optimized, with its levels of detail, and with
+// the material textures only named. Nothing here touches OpenGL, so the asset cooker imports with it too.
+struct ImportedMesh {
+    string name;
+    vector<Vertex> vertices;
+    vector<unsigned int> indices; // every level of detail one after the other
+    vector<MeshLod> lods;
+    vector<pair<string, string>> textures; // (type, path relative to the model), same order as Mesh::textures
+    glm::vec3 aabbMin, aabbMax;
+};
+
+// Reads a model with ASSIMP and turns every mesh into an ImportedMesh. Each mesh is welded and
+// reordered for the vertex cache (MeshOptimizer), then gets its simplified levels of detail (MeshSimplifier).
+class MeshImporter
+{
+public:
+    static bool Import(const string &path, vector<ImportedMesh> &meshes)
+    {
+        // read file via ASSIMP
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+        // check for errors
+        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+        {
+            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+            return false;
+        }
+        string directory = path.substr(0, path.find_last_of('/'));
+        // process ASSIMP's root node recursively
+        processNode(scene->mRootNode, scene, directory, meshes);
+        return true;
+    }
+
+private:
+    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
+    static void processNode(aiNode *node, const aiScene *scene, const string &directory, vector<ImportedMesh> &meshes)
+    {
+        // process each mesh located at the current node
+        for(unsigned int i = 0; i < node->mNumMeshes; i++)
+        {
+            // the node object only contains indices to index the actual objects in the scene.
+            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
+            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+            meshes.push_back(processMesh(mesh, scene, directory));
+        }
+        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+        for(unsigned int i = 0; i < node->mNumChildren; i++)
+        {
+            processNode(node->mChildren[i], scene, directory, meshes);
+        }
+
+    }
+
+    static ImportedMesh processMesh(aiMesh *mesh, const aiScene *scene, const string &directory)
+    {
+        // data to fill
+        ImportedMesh result;
+        result.name = mesh->mName.C_Str();
+        vector<Vertex> &vertices = result.vertices;
+        vector<unsigned int> &indices = result.indices;
+
+        // walk through each of the mesh's vertices
+        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
+        {
+            Vertex vertex = {}; // zeroed, so attributes the mesh lacks can't keep otherwise identical vertices from welding
+            glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
+            // positions
+            vector.x = mesh->mVertices[i].x;
+            vector.y = mesh->mVertices[i].y;
+            vector.z = mesh->mVertices[i].z;
+            vertex.Position = vector;
+            // normals
+            if (mesh->HasNormals())
+            {
+                vector.x = mesh->mNormals[i].x;
+                vector.y = mesh->mNormals[i].y;
+                vector.z = mesh->mNormals[i].z;
+                vertex.Normal = vector;
+            }
+            // texture coordinates
+            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+            {
+                glm::vec2 vec;
+                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
+                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+                vec.x = mesh->mTextureCoords[0][i].x;
+                vec.y = mesh->mTextureCoords[0][i].y;
+                vertex.TexCoords = vec;
+                // tangent
+                vector.x = mesh->mTangents[i].x;
+                vector.y = mesh->mTangents[i].y;
+                vector.z = mesh->mTangents[i].z;
+                vertex.Tangent = vector;
+                // bitangent
+                vector.x = mesh->mBitangents[i].x;
+                vector.y = mesh->mBitangents[i].y;
+                vector.z = mesh->mBitangents[i].z;
+                vertex.Bitangent = vector;
+            }
+            else
+                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+
+            vertices.push_back(vertex);
+
+
+        }
+        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+        {
+            aiFace face = mesh->mFaces[i];
+            // retrieve all indices of the face and store them in the indices vector
+            for(unsigned int j = 0; j < face.mNumIndices; j++)
+                indices.push_back(face.mIndices[j]);
+        }
+        // weld, reorder for the vertex cache, overdraw and fetch locality; the mesh cache stores the result
+        MeshOptimizeReport report = MeshOptimizer::Optimize(vertices, indices);
+        cout << "OPTIMIZE:: " << directory << " mesh '" << result.name << "': vertices " << report.verticesBefore
+             << " -> " << report.verticesAfter << ", ACMR " << report.acmrBefore << " -> " << report.acmrAfter
+             << ", index memory " << report.indexBytesBefore / 1024.0 << " -> " << report.indexBytesAfter / 1024.0 << " KB" << endl;
+        // simplified levels of detail, stored after the full mesh in the same index buffer
+        result.lods = MeshSimplifier::GenerateLods(vertices, indices);
+        if (result.lods.size() > 1)
+        {
+            cout << "LOD:: " << directory << " mesh '" << result.name << "': triangles";
+            for (const MeshLod &lod : result.lods)
+                cout << " " << lod.indexCount / 3 << (&lod == &result.lods.back() ? "" : " /");
+            cout << ", error " << result.lods.back().error << endl;
+        }
+
+        result.aabbMin = result.aabbMax = glm::vec3(0.0f);
+        if (!vertices.empty())
+        {
+            result.aabbMin = result.aabbMax = vertices[0].Position;
+            for (const Vertex &vertex : vertices)
+            {
+                result.aabbMin = glm::min(result.aabbMin, vertex.Position);
+                result.aabbMax = glm::max(result.aabbMax, vertex.Position);
+            }
+        }
+
+        // process materials
+        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
+        // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
+        // Same applies to other texture as the following list summarizes:
+        // diffuse: texture_diffuseN
+        // specular: texture_specularN
+        // normal: texture_normalN
+
+        // 1. diffuse maps
+        materialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", result.textures);
+        // 2. specular maps
+        materialTextures(material, aiTextureType_SPECULAR, "texture_specular", result.textures);
+        // 3. normal maps
+        materialTextures(material, aiTextureType_HEIGHT, "texture_normal", result.textures);
+        // 4. height maps
+        materialTextures(material, aiTextureType_AMBIENT, "texture_height", result.textures);
+        return result;
+    }
+
+    // appends the paths of all material textures of a given type
+    static void materialTextures(aiMaterial *mat, aiTextureType type, const string &typeName, vector<pair<string, string>> &textures)
+    {
+        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        {
+            aiString str;
+            mat->GetTexture(type, i, &str);
+            textures.push_back(make_pair(typeName, string(str.C_Str())));
+        }
+    }
+};
+#endif
@@ -0,0 +1,325 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/hash.h>
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// size of the FIFO post-transform cache ACMR is measured with
+const unsigned int ACMR_CACHE_SIZE = 16;
+// size of the LRU cache the triangle order is optimized for
+const unsigned int FORSYTH_CACHE_SIZE = 32;
+
+// what the optimizer did to one mesh, for the import report
+struct MeshOptimizeReport {
+    size_t verticesBefore = 0, verticesAfter = 0;
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
+    size_t indexBytesBefore = 0, indexBytesAfter = 0;
+};
+
+// Import time optimization of indexed triangle meshes:
+//   1. welds vertices that are bitwise identical
+//   2. orders triangles for the post-transform vertex cache (Tom Forsyth's linear-speed algorithm)
+//   3. reorders the resulting clusters of triangles so the ones facing outwards come first,
+//      which lets early depth testing reject more of the overdraw (as in Sander et al., "Fast
+//      triangle reordering for vertex locality and reduced overdraw")
+//   4. renumbers the vertices in the order the triangles first use them, for fetch locality
+// The mesh then usually fits 16-bit indices, see Mesh::indexType.
+class MeshOptimizer
+{
+public:
+    static MeshOptimizeReport Optimize(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        MeshOptimizeReport report;
+        report.verticesBefore = vertices.size();
+        report.acmrBefore = ACMR(indices, vertices.size());
+        report.indexBytesBefore = indices.size() * sizeof(unsigned int);
+
+        weld(vertices, indices);
+        OptimizeVertexCache(indices, vertices.size());
+        optimizeOverdraw(indices, vertices);
+        optimizeVertexFetch(vertices, indices);
+
+        report.verticesAfter = vertices.size();
+        report.acmrAfter = ACMR(indices, vertices.size());
+        report.indexBytesAfter = indices.size() * (vertices.size() < 65536 ? sizeof(uint16_t) : sizeof(unsigned int));
+        return report;
+    }
+
+    // average cache miss ratio: vertices transformed per triangle with a FIFO cache of the given size
+    // (3 when nothing is reused, 0.5 is the best a large regular grid can do)
+    static float ACMR(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = ACMR_CACHE_SIZE)
+    {
+        if (indices.size() < 3)
+            return 0.0f;
+        // a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+        vector<unsigned int> loadedAt(vertexCount, 0);
+        unsigned int misses = 0;
+        for (unsigned int index : indices)
+        {
+            if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize)
+            {
+                misses++;
+                loadedAt[index] = misses;
+            }
+        }
+        return (float)misses / (float)(indices.size() / 3);
+    }
+
+    // reorders the triangles for the post-transform vertex cache (also used for simplified levels of detail)
+    static void OptimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        // triangles using each vertex; the first remaining[v] entries are the ones not emitted yet
+        vector<unsigned int> remaining(vertexCount, 0);
+        for (unsigned int index : indices)
+            remaining[index]++;
+        vector<unsigned int> first(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++)
+            first[v + 1] = first[v] + remaining[v];
+        vector<unsigned int> adjacency(indices.size());
+        vector<unsigned int> fill(first.begin(), first.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+        vector<int> cachePosition(vertexCount, -1);
+        vector<float> score(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            score[v] = vertexScore(-1, remaining[v]);
+        int best = 0;
+        float bestScore = -1.0f;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            float s = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+            if (s > bestScore)
+            {
+                bestScore = s;
+                best = (int)t;
+            }
+        }
+
+        vector<char> emitted(triangleCount, 0);
+        vector<unsigned int> output;
+        output.reserve(indices.size());
+        unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+        unsigned int cacheCount = 0;
+        size_t cursor = 0;
+        while (output.size() < indices.size())
+        {
+            if (best < 0)
+            {
+                // dead end, nothing in the cache has triangles left: continue with the next unused triangle
+                while (emitted[cursor])
+                    cursor++;
+                best = (int)cursor;
+            }
+            emitted[best] = 1;
+            const unsigned int *triangle = &indices[best * 3];
+            unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+            unsigned int newCount = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v = triangle[k];
+                output.push_back(v);
+                newCache[newCount++] = v;
+                // drop the triangle from the vertex's remaining ones
+                unsigned int *list = &adjacency[first[v]];
+                for (unsigned int j = 0; j < remaining[v]; j++)
+                {
+                    if (list[j] == (unsigned int)best)
+                    {
+                        std::swap(list[j], list[remaining[v] - 1]);
+                        remaining[v]--;
+                        break;
+                    }
+                }
+            }
+            for (unsigned int i = 0; i < cacheCount; i++)
+            {
+                unsigned int v = cache[i];
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                    newCache[newCount++] = v;
+            }
+
+            // vertices pushed past the end of the cache lose their cache bonus
+            for (unsigned int i = 0; i < newCount; i++)
+            {
+                unsigned int v = newCache[i];
+                cachePosition[v] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+                score[v] = vertexScore(cachePosition[v], remaining[v]);
+            }
+            cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+            std::copy(newCache, newCache + cacheCount, cache);
+
+            // only triangles touching the cache changed score; the best of them goes next
+            best = -1;
+            bestScore = -1.0f;
+            for (unsigned int i = 0; i < cacheCount; i++)
+            {
+                unsigned int v = cache[i];
+                for (unsigned int j = 0; j < remaining[v]; j++)
+                {
+                    unsigned int t = adjacency[first[v] + j];
+                    float s = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                    if (s > bestScore)
+                    {
+                        bestScore = s;
+                        best = (int)t;
+                    }
+                }
+            }
+        }
+        indices.swap(output);
+    }
+
+private:
+    static void weld(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        size_t tableSize = 1;
+        while (tableSize < vertices.size() * 2)
+            tableSize *= 2;
+        // open addressing table of indices into the welded vertices
+        const unsigned int EMPTY = ~0u;
+        vector<unsigned int> table(tableSize, EMPTY);
+        vector<unsigned int> remap(vertices.size());
+        vector<Vertex> welded;
+        welded.reserve(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            size_t slot = HashBytes(&vertices[i], sizeof(Vertex)) & (tableSize - 1);
+            while (table[slot] != EMPTY && memcmp(&welded[table[slot]], &vertices[i], sizeof(Vertex)) != 0)
+                slot = (slot + 1) & (tableSize - 1);
+            if (table[slot] == EMPTY)
+            {
+                table[slot] = (unsigned int)welded.size();
+                welded.push_back(vertices[i]);
+            }
+            remap[i] = table[slot];
+        }
+        for (unsigned int &index : indices)
+            index = remap[index];
+        vertices.swap(welded);
+    }
+
+    // score of a vertex: high while it is in the cache (and highest for the most recent ones),
+    // plus a bonus for vertices with few triangles left so they get finished instead of left behind
+    static float vertexScore(int cachePosition, unsigned int remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+                score = 0.75f; // used by the last triangle, fixed so it doesn't favour strips
+            else
+                score = std::pow(1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+        }
+        return score + 2.0f / std::sqrt((float)remainingTriangles);
+    }
+
+    static void optimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        // clusters start where the cache starts over (all three vertices miss), so moving them
+        // around keeps the ACMR of the vertex cache order
+        vector<size_t> clusterStart;
+        vector<unsigned int> loadedAt(vertices.size(), 0);
+        unsigned int misses = 0;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            unsigned int triangleMisses = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int index = indices[t * 3 + k];
+                if (loadedAt[index] == 0 || misses - loadedAt[index] >= ACMR_CACHE_SIZE)
+                {
+                    misses++;
+                    triangleMisses++;
+                    loadedAt[index] = misses;
+                }
+            }
+            if (t == 0 || triangleMisses == 3)
+                clusterStart.push_back(t);
+        }
+        clusterStart.push_back(triangleCount);
+        size_t clusterCount = clusterStart.size() - 1;
+        if (clusterCount < 2)
+            return;
+
+        // clusters facing away from the mesh center are drawn first: they are the likeliest to occlude the rest
+        glm::vec3 meshCenter(0.0f);
+        float meshArea = 0.0f;
+        vector<glm::vec3> clusterCenter(clusterCount, glm::vec3(0.0f)), clusterNormal(clusterCount, glm::vec3(0.0f));
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            float area = 0.0f;
+            for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+            {
+                const glm::vec3 &a = vertices[indices[t * 3]].Position;
+                const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3 &d = vertices[indices[t * 3 + 2]].Position;
+                glm::vec3 normal = glm::cross(b - a, d - a);
+                float triangleArea = glm::length(normal);
+                clusterCenter[c] += (a + b + d) * (triangleArea / 3.0f);
+                clusterNormal[c] += normal;
+                area += triangleArea;
+            }
+            meshCenter += clusterCenter[c];
+            meshArea += area;
+            clusterCenter[c] = area > 0.0f ? clusterCenter[c] / area : vertices[indices[clusterStart[c] * 3]].Position;
+            float length = glm::length(clusterNormal[c]);
+            clusterNormal[c] = length > 0.0f ? clusterNormal[c] / length : glm::vec3(0.0f);
+        }
+        if (meshArea > 0.0f)
+            meshCenter /= meshArea;
+
+        vector<float> sortKey(clusterCount);
+        vector<unsigned int> order(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            sortKey[c] = glm::dot(clusterCenter[c] - meshCenter, clusterNormal[c]);
+            order[c] = (unsigned int)c;
+        }
+        std::stable_sort(order.begin(), order.end(), [&sortKey](unsigned int a, unsigned int b) { return sortKey[a] > sortKey[b]; });
+
+        vector<unsigned int> output;
+        output.reserve(indices.size());
+        for (unsigned int c : order)
+            output.insert(output.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+        indices.swap(output);
+    }
+
+    // vertices in the order the index buffer first uses them; unused vertices are dropped
+    static void optimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        const unsigned int UNUSED = ~0u;
+        vector<unsigned int> remap(vertices.size(), UNUSED);
+        vector<Vertex> ordered;
+        ordered.reserve(vertices.size());
+        for (unsigned int &index : indices)
+        {
+            if (remap[index] == UNUSED)
+            {
+                remap[index] = (unsigned int)ordered.size();
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(ordered);
+    }
+};
+#endif
@@ -0,0 +1,344 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/hash.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// meshes with fewer triangles are cheap enough to always draw in full
+const size_t LOD_MIN_TRIANGLES = 512;
+// a level is only kept if it has at most this fraction of the previous level's triangles
+const float LOD_MIN_REDUCTION = 0.75f;
+
+// Builds the levels of detail of a mesh with quadric error edge collapses (Garland & Heckbert,
+// "Surface simplification using quadric error metrics"). Every collapse moves a vertex onto one
+// of its neighbours, so all levels index the vertex buffer of the full mesh and a level is just
+// another range of its index buffer. Vertices on open borders stay where they are, and a vertex
+// with several attribute variants (on a texture or normal seam) only collapses along the seam.
+class MeshSimplifier
+{
+public:
+    // appends up to MAX_MESH_LODS - 1 simplified versions of the mesh, each with about half the
+    // triangles of the one before, to indices and returns all levels, the full mesh first
+    static vector<MeshLod> GenerateLods(const vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        vector<MeshLod> lods(1);
+        lods[0].firstIndex = 0;
+        lods[0].indexCount = (unsigned int)indices.size();
+        lods[0].error = 0.0f;
+        if (indices.size() / 3 < LOD_MIN_TRIANGLES)
+            return lods;
+
+        MeshSimplifier simplifier(vertices, indices);
+        size_t target = indices.size() / 3;
+        while (lods.size() < MAX_MESH_LODS)
+        {
+            target /= 2;
+            bool reached = simplifier.simplify(target);
+            if (simplifier.indices.size() > lods.back().indexCount * LOD_MIN_REDUCTION)
+                break;
+            vector<unsigned int> level = simplifier.indices;
+            MeshOptimizer::OptimizeVertexCache(level, vertices.size());
+            MeshLod lod;
+            lod.firstIndex = (unsigned int)indices.size();
+            lod.indexCount = (unsigned int)level.size();
+            lod.error = simplifier.error;
+            indices.insert(indices.end(), level.begin(), level.end());
+            lods.push_back(lod);
+            if (!reached)
+                break;
+        }
+        return lods;
+    }
+
+private:
+    // sum of squared distances to a set of planes, weighted by the area of the triangles they came from
+    struct Quadric {
+        double m[10] = {}; // upper triangle of the symmetric 4x4 matrix, row by row
+        double area = 0.0;
+
+        void AddPlane(const glm::vec3 &normal, float d, float weight)
+        {
+            double p[4] = {normal.x, normal.y, normal.z, d};
+            int k = 0;
+            for (int i = 0; i < 4; i++)
+                for (int j = i; j < 4; j++)
+                    m[k++] += weight * p[i] * p[j];
+            area += weight;
+        }
+
+        void Add(const Quadric &other)
+        {
+            for (int k = 0; k < 10; k++)
+                m[k] += other.m[k];
+            area += other.area;
+        }
+
+        double Evaluate(const glm::vec3 &point) const
+        {
+            double x = point.x, y = point.y, z = point.z;
+            return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+                 + m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+                 + m[7] * z * z + 2.0 * m[8] * z
+                 + m[9];
+        }
+    };
+
+    // moving every vertex at position from onto the matching vertex at position to
+    struct Collapse {
+        unsigned int from, to;
+        float cost;
+    };
+
+    const vector<Vertex> &vertices;
+    vector<unsigned int> indices;     // triangles left, indexing the full mesh's vertices
+    vector<unsigned int> positionOf;  // vertices sharing a position (attribute variants) share an id
+    vector<glm::vec3> positions;
+    vector<Quadric> quadrics;         // per position, the planes it was collapsed away from
+    float error = 0.0f;               // largest collapse error so far, as a model space distance
+
+    MeshSimplifier(const vector<Vertex> &vertices, const vector<unsigned int> &indices) : vertices(vertices)
+    {
+        // position ids, with the same kind of table MeshOptimizer welds with
+        size_t tableSize = 1;
+        while (tableSize < vertices.size() * 2)
+            tableSize *= 2;
+        const unsigned int EMPTY = ~0u;
+        vector<unsigned int> table(tableSize, EMPTY);
+        positionOf.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            const glm::vec3 &position = vertices[i].Position;
+            size_t slot = HashBytes(&position, sizeof(glm::vec3)) & (tableSize - 1);
+            while (table[slot] != EMPTY && memcmp(&positions[table[slot]], &position, sizeof(glm::vec3)) != 0)
+                slot = (slot + 1) & (tableSize - 1);
+            if (table[slot] == EMPTY)
+            {
+                table[slot] = (unsigned int)positions.size();
+                positions.push_back(position);
+            }
+            positionOf[i] = table[slot];
+        }
+
+        quadrics.resize(positions.size());
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            unsigned int a = positionOf[indices[t]], b = positionOf[indices[t + 1]], c = positionOf[indices[t + 2]];
+            if (a == b || b == c || a == c)
+                continue; // already degenerate, nothing to simplify
+            this->indices.insert(this->indices.end(), indices.begin() + t, indices.begin() + t + 3);
+            glm::vec3 normal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+            float length = glm::length(normal);
+            if (length == 0.0f)
+                continue;
+            normal /= length;
+            float d = -glm::dot(normal, positions[a]);
+            quadrics[a].AddPlane(normal, d, length * 0.5f);
+            quadrics[b].AddPlane(normal, d, length * 0.5f);
+            quadrics[c].AddPlane(normal, d, length * 0.5f);
+        }
+    }
+
+    // collapses edges until at most targetTriangles are left; false when it got stuck before that
+    bool simplify(size_t targetTriangles)
+    {
+        while (indices.size() / 3 > targetTriangles)
+        {
+            if (!pass(targetTriangles))
+                return false;
+        }
+        return true;
+    }
+
+    // one round of collapses, cheapest first. A collapse changes the triangles around the collapsed
+    // position, so nothing in its one-ring collapses again in the same round.
+    bool pass(size_t targetTriangles)
+    {
+        size_t positionCount = positions.size();
+        // triangles around every position
+        vector<unsigned int> first(positionCount + 1, 0);
+        for (unsigned int index : indices)
+            first[positionOf[index] + 1]++;
+        for (size_t p = 0; p < positionCount; p++)
+            first[p + 1] += first[p];
+        vector<unsigned int> adjacency(indices.size());
+        vector<unsigned int> fill(first.begin(), first.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[positionOf[indices[i]]]++] = (unsigned int)(i / 3);
+
+        vector<Collapse> collapses;
+        vector<unsigned int> neighbours;
+        vector<pair<unsigned int, unsigned int>> mapping;
+        for (unsigned int p = 0; p < positionCount; p++)
+        {
+            neighbours.clear();
+            for (unsigned int j = first[p]; j < first[p + 1]; j++)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int other = positionOf[indices[adjacency[j] * 3 + k]];
+                    if (other != p)
+                        neighbours.push_back(other);
+                }
+            }
+            // on a closed manifold every edge has two triangles; anything else is a border to keep
+            sort(neighbours.begin(), neighbours.end());
+            bool locked = false;
+            for (size_t j = 0; j < neighbours.size() && !locked; j += 2)
+                locked = j + 1 >= neighbours.size() || neighbours[j] != neighbours[j + 1] ||
+                         (j + 2 < neighbours.size() && neighbours[j + 2] == neighbours[j]);
+            if (locked)
+                continue;
+
+            for (size_t j = 0; j < neighbours.size(); j += 2)
+            {
+                unsigned int to = neighbours[j];
+                if (!mapVariants(p, to, first, adjacency, mapping))
+                    continue;
+                Quadric quadric = quadrics[p];
+                quadric.Add(quadrics[to]);
+                Collapse collapse;
+                collapse.from = p;
+                collapse.to = to;
+                collapse.cost = quadric.area > 0.0 ? (float)std::sqrt(std::max(0.0, quadric.Evaluate(positions[to]) / quadric.area)) : 0.0f;
+                collapses.push_back(collapse);
+            }
+        }
+        sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        // only the cheaper part of the candidates per round, the rest are re-evaluated on the simplified mesh
+        size_t limit = collapses.size() / 3 + 1;
+        size_t triangleCount = indices.size() / 3;
+        vector<char> touched(positionCount, 0);
+        vector<unsigned int> remap(vertices.size());
+        iota(remap.begin(), remap.end(), 0u);
+        size_t performed = 0;
+        for (size_t i = 0; i < collapses.size() && i < limit && triangleCount > targetTriangles; i++)
+        {
+            const Collapse &collapse = collapses[i];
+            if (touched[collapse.from] || touched[collapse.to] || flips(collapse, first, adjacency))
+                continue;
+            mapVariants(collapse.from, collapse.to, first, adjacency, mapping);
+            for (const pair<unsigned int, unsigned int> &variant : mapping)
+                remap[variant.first] = variant.second;
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            for (unsigned int j = first[collapse.from]; j < first[collapse.from + 1]; j++)
+            {
+                bool removed = false;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int other = positionOf[indices[adjacency[j] * 3 + k]];
+                    touched[other] = 1;
+                    removed = removed || other == collapse.to;
+                }
+                if (removed)
+                    triangleCount--;
+            }
+            error = std::max(error, collapse.cost);
+            performed++;
+        }
+        if (performed == 0)
+            return false;
+
+        // apply the collapses and drop the triangles that became degenerate
+        size_t kept = 0;
+        for (size_t t = 0; t < indices.size(); t += 3)
+        {
+            unsigned int a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+            if (positionOf[a] == positionOf[b] || positionOf[b] == positionOf[c] || positionOf[a] == positionOf[c])
+                continue;
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+        return true;
+    }
+
+    // pairs every vertex at position from with the vertex at position to it shares an edge with.
+    // Fails when a variant of from has no such partner or two (the edge crosses a seam), since
+    // collapsing would then tear the seam or stretch attributes across it.
+    bool mapVariants(unsigned int from, unsigned int to, const vector<unsigned int> &first, const vector<unsigned int> &adjacency,
+                     vector<pair<unsigned int, unsigned int>> &mapping) const
+    {
+        mapping.clear();
+        for (unsigned int j = first[from]; j < first[from + 1]; j++)
+        {
+            const unsigned int *triangle = &indices[adjacency[j] * 3];
+            unsigned int fromVertex = ~0u, toVertex = ~0u;
+            for (int k = 0; k < 3; k++)
+            {
+                if (positionOf[triangle[k]] == from)
+                    fromVertex = triangle[k];
+                else if (positionOf[triangle[k]] == to)
+                    toVertex = triangle[k];
+            }
+            if (toVertex == ~0u)
+                continue;
+            bool known = false;
+            for (const pair<unsigned int, unsigned int> &variant : mapping)
+            {
+                if (variant.first == fromVertex)
+                {
+                    if (variant.second != toVertex)
+                        return false;
+                    known = true;
+                }
+            }
+            if (!known)
+                mapping.push_back(make_pair(fromVertex, toVertex));
+        }
+        for (unsigned int j = first[from]; j < first[from + 1]; j++)
+        {
+            const unsigned int *triangle = &indices[adjacency[j] * 3];
+            for (int k = 0; k < 3; k++)
+            {
+                if (positionOf[triangle[k]] != from)
+                    continue;
+                bool known = false;
+                for (const pair<unsigned int, unsigned int> &variant : mapping)
+                    known = known || variant.first == triangle[k];
+                if (!known)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // whether a triangle that survives the collapse would turn over (or rotate by more than ~75 degrees)
+    bool flips(const Collapse &collapse, const vector<unsigned int> &first, const vector<unsigned int> &adjacency) const
+    {
+        for (unsigned int j = first[collapse.from]; j < first[collapse.from + 1]; j++)
+        {
+            const unsigned int *triangle = &indices[adjacency[j] * 3];
+            glm::vec3 before[3], after[3];
+            bool removed = false;
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int position = positionOf[triangle[k]];
+                removed = removed || position == collapse.to;
+                before[k] = after[k] = positions[position];
+                if (position == collapse.from)
+                    after[k] = positions[collapse.to];
+            }
+            if (removed)
+                continue;
+            glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(normalBefore, normalAfter) < 0.25f * glm::length(normalBefore) * glm::length(normalAfter))
+                return true;
+        }
+        return false;
+    }
+};
+#endif
@@ -6,39 +6,236 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
 
+#include <learnopengl/frustum.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_import.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_kind.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/texture_storage.h>
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromFile(const char *path, const string &directory, TextureKind kind = TEXTURE_COLOR);
+
+// A model's meshes as far as they can be loaded without a GL context: mapped from the mesh cache when it
+// is valid, otherwise imported with ASSIMP (and written to the cache for the next run). Load() may run
+// on any thread; the model turns the result into GL meshes on the GL thread (Model::BuildMesh).
+struct ModelData {
+    string path;
+    MeshCache cache;
+    bool fromCache = false;
+    bool loaded = false;    // what Load returned
+    vector<ImportedMesh> imported;
+    // bounds of all meshes together, in model space
+    glm::vec3 aabbMin = glm::vec3(0.0f);
+    glm::vec3 aabbMax = glm::vec3(0.0f);
+    double loadMillis = 0.0;
+    double coldImportMillis = 0.0;
+
+    size_t MeshCount() const { return fromCache ? cache.MeshCount() : imported.size(); }
+
+    // every image file the meshes reference, once, as TextureFromFile will name it
+    vector<string> TexturePaths() const
+    {
+        string directory = path.substr(0, path.find_last_of('/'));
+        vector<string> paths;
+        for (size_t i = 0; i < MeshCount(); i++)
+        {
+            vector<pair<string, string>> textures = fromCache ? cache.GetMesh(i).textures : imported[i].textures;
+            for (const pair<string, string> &texture : textures)
+            {
+                string file = directory + '/' + texture.second;
+                if (find(paths.begin(), paths.end(), file) == paths.end())
+                    paths.push_back(file);
+            }
+        }
+        return paths;
+    }
 
+    // false if the model could neither be mapped from its cache nor imported
+    bool Load(const string &sourcePath)
+    {
+        auto start = chrono::steady_clock::now();
+        path = sourcePath;
+        fromCache = cache.Open(path, MODEL_IMPORT_FLAGS);
+        if (fromCache)
+        {
+            coldImportMillis = cache.ColdImportMillis();
+            for (size_t i = 0; i < cache.MeshCount(); i++)
+            {
+                CachedMesh mesh = cache.GetMesh(i);
+                addBounds(i, mesh.aabbMin, mesh.aabbMax);
+            }
+        }
+        else
+        {
+            if (!MeshImporter::Import(path, imported))
+                return false;
+            for (size_t i = 0; i < imported.size(); i++)
+                addBounds(i, imported[i].aabbMin, imported[i].aabbMax);
+            coldImportMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            if (!MeshCache::Write(path, MODEL_IMPORT_FLAGS, imported, coldImportMillis))
+                cout << "MODEL:: failed to write mesh cache " << MeshCache::PathFor(path) << endl;
+        }
+        loadMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        loaded = true;
+        return true;
+    }
+
+private:
+    void addBounds(size_t mesh, glm::vec3 meshMin, glm::vec3 meshMax)
+    {
+        aabbMin = mesh == 0 ? meshMin : glm::min(aabbMin, meshMin);
+        aabbMax = mesh == 0 ? meshMax : glm::max(aabbMax, meshMax);
+    }
+};
 
 
 class Model
 {
 public:
     // model data
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// stores all the textures loaded so far, each holds a reference in the TextureRegistry
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // startup statistics: whether the meshes came from the binary mesh cache and how long loading took
+    bool loadedFromCache = false;
+    double loadMillis = 0.0;
+    double coldImportMillis = 0.0;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, VertexFormat format = VERTEX_FULL) : gammaCorrection(gamma), vertexFormat(format)
     {
         loadModel(path);
     }
+    // a model without meshes, for ModelLoader::Request to load in the background
+    explicit Model(VertexFormat format) : gammaCorrection(false), vertexFormat(format), resident(false)
+    {
+    }
+    // the meshes and textures belong to GL, a copy would release the textures twice
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+
+    ~Model()
+    {
+        for (const Texture &texture : textures_loaded)
+            TextureRegistry::Release(texture.id);
+    }
+
+    // whether meshes holds the model's own meshes. While it is loading, meshes holds nothing, or (once
+    // the bounds are known) a single box around the model (IsProxy) that stands in for it.
+    bool Resident() const { return resident; }
+    bool IsProxy() const { return !resident && !meshes.empty(); }
+
+    // loading in steps, on the GL thread, from data that finished loading: BeginLoad puts up the proxy,
+    // BuildMesh creates the GL objects of one mesh at a time and FinishLoad swaps them in
+    void BeginLoad(const ModelData &data)
+    {
+        directory = data.path.substr(0, data.path.find_last_of('/'));
+        sourcePath = data.path;
+        loadedFromCache = data.fromCache;
+        loadMillis = data.loadMillis;
+        coldImportMillis = data.coldImportMillis;
+        // a model loaded by its constructor is never drawn before it has its meshes
+        if (resident || data.MeshCount() == 0)
+            return;
+        destroyMeshes();
+        meshes.push_back(proxyBox(data.aabbMin, data.aabbMax));
+        meshesChanged();
+    }
+
+    void BuildMesh(const ModelData &data, size_t i)
+    {
+        auto start = chrono::steady_clock::now();
+        vector<Texture> textures;
+        if (data.fromCache)
+        {
+            CachedMesh cached = data.cache.GetMesh(i);
+            for (const pair<string, string> &texture : cached.textures)
+                textures.push_back(loadTexture(texture.second.c_str(), texture.first));
+            loadingMeshes.push_back(Mesh(cached.vertices, cached.vertexCount, cached.indices, cached.indexCount,
+                                         textures, cached.aabbMin, cached.aabbMax, vertexFormat, cached.lods));
+        }
+        else
+        {
+            const ImportedMesh &mesh = data.imported[i];
+            for (const pair<string, string> &texture : mesh.textures)
+                textures.push_back(loadTexture(texture.second.c_str(), texture.first));
+            loadingMeshes.push_back(Mesh(mesh.vertices, mesh.indices, textures, vertexFormat, mesh.lods));
+        }
+        if (!samplerPrefix.empty())
+            loadingMeshes.back().SetSamplerPrefix(samplerPrefix);
+        loadMillis += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    void FinishLoad()
+    {
+        destroyMeshes();
+        meshes.swap(loadingMeshes);
+        resident = true;
+        meshesChanged();
+    }
+
+    // switches the vertex buffers of all meshes to another format. The vertices are taken again from
+    // where the meshes were built from: the meshes themselves after an import, otherwise the mesh cache.
+    void SetVertexFormat(VertexFormat format)
+    {
+        if (format == vertexFormat)
+            return;
+        // meshes still to be built are built in the new format
+        if (!resident)
+        {
+            vertexFormat = format;
+            return;
+        }
+        MeshCache cache;
+        if (loadedFromCache && !cache.Open(sourcePath, MODEL_IMPORT_FLAGS))
+        {
+            cout << "MODEL:: " << sourcePath << " can't switch vertex format, its mesh cache is gone" << endl;
+            return;
+        }
+        vertexFormat = format;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            if (loadedFromCache)
+            {
+                CachedMesh cached = cache.GetMesh(i);
+                meshes[i].SetVertexFormat(format, cached.vertices, cached.vertexCount);
+            }
+            else
+                meshes[i].SetVertexFormat(format, meshes[i].vertices.data(), meshes[i].vertices.size());
+        }
+    }
+
+    // size of the vertex buffers (position streams included) as they are now, and in the full format
+    size_t VertexBytes() const
+    {
+        size_t bytes = 0;
+        for (const Mesh &mesh : meshes)
+            bytes += mesh.vertexCount * mesh.VertexStride();
+        return bytes;
+    }
+    size_t FullVertexBytes() const
+    {
+        size_t bytes = 0;
+        for (const Mesh &mesh : meshes)
+            bytes += mesh.vertexCount * sizeof(Vertex);
+        return bytes;
+    }
 
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
@@ -47,213 +244,272 @@ public:
             meshes[i].Draw(shader);
     }
 
-    void SetShaderTextureNamePrefix(std::string prefix) {
-        for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+    // draws only the meshes the culler considers visible when the model is placed with transform
+    void Draw(Shader &shader, ViewCuller &culler, const glm::mat4 &transform)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            Mesh &mesh = meshes[i];
+            if (culler.IsVisible(mesh.sphereCenter, mesh.sphereRadius, mesh.aabbMin, mesh.aabbMax, transform))
+                mesh.Draw(shader);
         }
     }
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+
+    // sets the transforms DrawInstanced renders the model with, one copy per matrix.
+    // the matrices (with their normal matrices) are kept in a vertex buffer, so a static set only has
+    // to be uploaded once.
+    void SetInstances(const vector<glm::mat4> &transforms)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+        instanceData.clear();
+        for (const glm::mat4 &transform : transforms)
+            instanceData.push_back(InstanceData(transform));
+        if (instanceVBO == 0)
+            glGenBuffers(1, &instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (transforms.size() > instanceCapacity)
         {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            instanceCapacity = (unsigned int)transforms.size();
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(InstanceData), instanceData.data(), GL_DYNAMIC_DRAW);
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        else if (!transforms.empty())
+            glBufferSubData(GL_ARRAY_BUFFER, 0, transforms.size() * sizeof(InstanceData), instanceData.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        instanceCount = (unsigned int)transforms.size();
+        instanceTransforms = transforms;
+        instanceLods.assign(meshes.size() * transforms.size(), 0);
+    }
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+    const vector<glm::mat4> &Instances() const
+    {
+        return instanceTransforms;
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // draws every instance set with SetInstances; one draw call per mesh no matter how many instances there are
+    void DrawInstanced(Shader &shader)
     {
-        // process each mesh located at the current node
-        for(unsigned int i = 0; i < node->mNumMeshes; i++)
+        if (instanceCount == 0)
+            return;
+        for(unsigned int i = 0; i < meshes.size(); i++)
         {
-            // the node object only contains indices to index the actual objects in the scene.
-            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            meshes[i].SetInstanceBuffer(instanceVBO);
+            meshes[i].DrawInstanced(shader, instanceCount);
         }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-        for(unsigned int i = 0; i < node->mNumChildren; i++)
+    }
+
+    // draws only the visible instances: every mesh is tested against the view once per instance and
+    // the surviving transforms are uploaded grouped by mesh and level of detail, so each mesh takes
+    // one draw call per level in use
+    void DrawInstanced(Shader &shader, ViewCuller &culler)
+    {
+        CullInstances(culler);
+        for(unsigned int i = 0; i < meshes.size(); i++)
         {
-            processNode(node->mChildren[i], scene);
+            for (unsigned int lod = 0; lod < meshes[i].lods.size(); lod++)
+            {
+                if (VisibleCount(i, lod) == 0)
+                    continue;
+                meshes[i].SetInstanceBuffer(visibleVBO, VisibleOffset(i, lod));
+                meshes[i].DrawInstanced(shader, VisibleCount(i, lod), lod);
+            }
         }
-
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // culls the instances of every mesh, picks their levels of detail and uploads the visible transforms
+    // for this frame; afterwards level lod of mesh i draws VisibleCount(i, lod) instances starting at
+    // VisibleOffset(i, lod) in VisibleBuffer()
+    void CullInstances(ViewCuller &culler)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
-
-        // walk through each of the mesh's vertices
-        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
+        visibleInstances.clear();
+        visibleFirst.resize(meshes.size() * MAX_MESH_LODS);
+        visibleCount.resize(meshes.size() * MAX_MESH_LODS);
+        visibleDepth.resize(meshes.size() * MAX_MESH_LODS);
+        instanceLevel.resize(instanceTransforms.size());
+        instanceDepth.resize(instanceTransforms.size());
+        for(unsigned int i = 0; i < meshes.size(); i++)
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
+            const Mesh &mesh = meshes[i];
+            for (size_t j = 0; j < instanceTransforms.size(); j++)
             {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
+                float pixelScale;
+                instanceLevel[j] = -1;
+                if (culler.IsVisible(mesh.sphereCenter, mesh.sphereRadius, mesh.aabbMin, mesh.aabbMax, instanceTransforms[j],
+                                     &instanceDepth[j], &pixelScale))
+                {
+                    unsigned char &lod = instanceLods[i * instanceTransforms.size() + j];
+                    lod = (unsigned char)mesh.SelectLod(pixelScale, culler.lodPixelError, lod);
+                    instanceLevel[j] = lod;
+                }
             }
-            // texture coordinates
-            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+            for (unsigned int lod = 0; lod < MAX_MESH_LODS; lod++)
             {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
+                unsigned int slot = i * MAX_MESH_LODS + lod;
+                visibleFirst[slot] = (unsigned int)visibleInstances.size();
+                visibleDepth[slot] = 0.0f;
+                for (size_t j = 0; j < instanceTransforms.size(); j++)
+                {
+                    if (instanceLevel[j] != (int)lod)
+                        continue;
+                    visibleDepth[slot] = visibleInstances.size() == visibleFirst[slot] ? instanceDepth[j] : std::min(visibleDepth[slot], instanceDepth[j]);
+                    visibleInstances.push_back(instanceData[j]);
+                }
+                visibleCount[slot] = (unsigned int)visibleInstances.size() - visibleFirst[slot];
             }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+        }
+        if (visibleInstances.empty())
+            return;
 
-            vertices.push_back(vertex);
+        if (visibleVBO == 0)
+            glGenBuffers(1, &visibleVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, visibleVBO);
+        if (visibleInstances.size() > visibleCapacity)
+            visibleCapacity = (unsigned int)visibleInstances.capacity();
+        // orphan last frame's storage so the driver doesn't have to wait for draws still reading it
+        glBufferData(GL_ARRAY_BUFFER, visibleCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, visibleInstances.size() * sizeof(InstanceData), visibleInstances.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
 
+    unsigned int VisibleBuffer() const { return visibleVBO; }
+    unsigned int VisibleCount(unsigned int mesh, unsigned int lod) const { return visibleCount[mesh * MAX_MESH_LODS + lod]; }
+    size_t VisibleOffset(unsigned int mesh, unsigned int lod) const { return visibleFirst[mesh * MAX_MESH_LODS + lod] * sizeof(InstanceData); }
+    // view depth of the nearest visible instance of the mesh at that level of detail
+    float VisibleDepth(unsigned int mesh, unsigned int lod) const { return visibleDepth[mesh * MAX_MESH_LODS + lod]; }
 
+    void SetShaderTextureNamePrefix(std::string prefix) {
+        samplerPrefix = prefix;
+        for (Mesh& mesh: meshes) {
+            mesh.SetSamplerPrefix(prefix);
         }
-        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
-        {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
-            for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+        for (Mesh& mesh: loadingMeshes) {
+            mesh.SetSamplerPrefix(prefix);
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
-        // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
-        // Same applies to other texture as the following list summarizes:
-        // diffuse: texture_diffuseN
-        // specular: texture_specularN
-        // normal: texture_normalN
-        aiColor3D color(0.0f, 0.0f, 0.0f);
-        material->Get(AI_MATKEY_COLOR_AMBIENT, color);
-
-
-        // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-        // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-        // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+    }
+private:
+    string sourcePath;
+    VertexFormat vertexFormat;
+    bool resident = true;
+    // meshes built while the model is loading, not drawn until FinishLoad
+    vector<Mesh> loadingMeshes;
+    std::string samplerPrefix;
+    // index into textures_loaded by type and the path the materials name
+    unordered_map<string, size_t> loadedTextures;
+    // per-instance model and normal matrices, attached to the VAO of every mesh
+    unsigned int instanceVBO = 0;
+    unsigned int instanceCapacity = 0;
+    unsigned int instanceCount = 0;
+    vector<glm::mat4> instanceTransforms;
+    vector<InstanceData> instanceData;
+    // level of detail every instance of every mesh had last frame (mesh major), for the hysteresis
+    vector<unsigned char> instanceLods;
+    // per instance of the mesh being culled: its level of detail this frame (-1 when culled) and view depth
+    vector<int> instanceLevel;
+    vector<float> instanceDepth;
+    // instances that survived culling this frame, grouped by mesh and level of detail
+    unsigned int visibleVBO = 0;
+    unsigned int visibleCapacity = 0;
+    vector<InstanceData> visibleInstances;
+    vector<unsigned int> visibleFirst, visibleCount;
+    vector<float> visibleDepth;
+
+    // loads a model from its mesh cache if there is a valid one, otherwise with ASSIMP (and writes the cache for the next run)
+    void loadModel(string const &path)
+    {
+        ModelData data;
+        if (!data.Load(path))
+            return;
+        BeginLoad(data);
+        for (size_t i = 0; i < data.MeshCount(); i++)
+            BuildMesh(data, i);
+        FinishLoad();
+        if (loadedFromCache)
+            cout << "MODEL:: " << path << " loaded from mesh cache in " << loadMillis << " ms (cold import took " << coldImportMillis << " ms)" << endl;
+        else
+            cout << "MODEL:: " << path << " imported with ASSIMP in " << loadMillis << " ms" << endl;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // deletes the GL objects of what meshes holds: the proxy box is the only mesh that can be replaced
+    void destroyMeshes()
     {
-        vector<Texture> textures;
-        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        if (IsProxy())
+            meshes[0].Destroy();
+        meshes.clear();
+    }
+
+    // the per-instance level of detail state is per mesh
+    void meshesChanged()
+    {
+        instanceLods.assign(meshes.size() * instanceTransforms.size(), 0);
+    }
+
+    // a closed box over the bounds, with a flat normal per face and no textures
+    static Mesh proxyBox(glm::vec3 aabbMin, glm::vec3 aabbMax)
+    {
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        for (int axis = 0; axis < 3; axis++)
         {
-            aiString str;
-            mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            for (int side = 0; side < 2; side++)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                glm::vec3 normal(0.0f);
+                normal[axis] = side ? 1.0f : -1.0f;
+                int u = (axis + 1) % 3, v = (axis + 2) % 3;
+                unsigned int first = (unsigned int)vertices.size();
+                for (int corner = 0; corner < 4; corner++)
                 {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
+                    Vertex vertex = Vertex();
+                    vertex.Position[axis] = side ? aabbMax[axis] : aabbMin[axis];
+                    vertex.Position[u] = (corner == 1 || corner == 2) ? aabbMax[u] : aabbMin[u];
+                    vertex.Position[v] = corner >= 2 ? aabbMax[v] : aabbMin[v];
+                    vertex.Normal = normal;
+                    vertex.TexCoords = glm::vec2(corner == 1 || corner == 2, corner >= 2);
+                    vertex.Tangent[u] = 1.0f;
+                    vertex.Bitangent[v] = 1.0f;
+                    vertices.push_back(vertex);
                 }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+                // counter-clockwise seen from outside
+                const unsigned int front[] = {0, 1, 2, 0, 2, 3}, back[] = {0, 2, 1, 0, 3, 2};
+                for (int i = 0; i < 6; i++)
+                    indices.push_back(first + (side ? front[i] : back[i]));
             }
         }
-        return textures;
+        return Mesh(vertices, indices, vector<Texture>(), VERTEX_FULL);
+    }
+
+    // loads a single texture relative to the model directory, unless this model loaded it before as the same type.
+    // textures other models (or other paths with the same image) loaded are shared through the TextureRegistry
+    Texture loadTexture(const char *path, const string &typeName)
+    {
+        string key = typeName + '\n' + path;
+        auto loaded = loadedTextures.find(key);
+        if (loaded != loadedTextures.end())
+            return textures_loaded[loaded->second];
+        Texture texture;
+        texture.id = TextureFromFile(path, this->directory, MaterialTextureKind(typeName));
+        texture.type = typeName;
+        texture.path = path;
+        loadedTextures[key] = textures_loaded.size();
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        return texture;
     }
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+unsigned int TextureFromFile(const char *path, const string &directory, TextureKind kind)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    // the image is decoded on a worker thread, the texture gets its data in TextureLoader::FinishPending or Poll.
+    // the texture is shared with every other request for the same image as the same kind of texture
+    return TextureRegistry::Acquire(filename, TextureKindName(kind), [kind](unsigned int textureID, const DecodedImage &image) {
+        if (image.data || image.cooked)
+        {
+            TextureStorage::Upload2D(textureID, image, kind); // sampled through SamplerCache's SAMPLER_REPEAT
+        }
+        else
+        {
+            std::cout << "Texture failed to load at path: " << image.path << std::endl;
+        }
+    });
 }
 #endif
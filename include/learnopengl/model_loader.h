@@ -0,0 +1,194 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <learnopengl/model.h>
+#include <learnopengl/task_graph.h>
+#include <learnopengl/texture_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Loads models in the background while frames are rendered. Request() maps the mesh cache or runs the
+// ASSIMP import (and the mesh processing that comes with it) as a TaskGraph task on the shared thread
+// pool; the GL objects are created on the GL thread in Update(), a mesh at a time until the frame's time
+// budget is used. A model shows as its bounding box (Model::IsProxy) from the moment its data is loaded
+// until all of its meshes are built. The import prefetches the decodes of the textures it found, so they
+// run on the workers while the meshes are still being built; the uploads follow in TextureLoader.
+class ModelLoader
+{
+public:
+    // runs on the GL thread once the model has its meshes
+    typedef std::function<void(Model &)> ReadyFunction;
+
+    // model must be empty (Model(VertexFormat)) and outlive the request
+    static void Request(Model &model, const std::string &path, ReadyFunction ready = nullptr)
+    {
+        ModelLoader &loader = instance();
+        if (loader.jobs.empty())
+            loader.batchStart = std::chrono::steady_clock::now();
+        Job job;
+        job.model = &model;
+        job.ready = std::move(ready);
+        job.data = std::make_shared<ModelData>();
+        job.name = path.substr(path.find_last_of('/') + 1);
+        std::shared_ptr<ModelData> data = job.data;
+        job.import = TaskGraph::Submit("import " + job.name, TASK_IMPORT, [data, path] {
+            if (!data->Load(path))
+                return;
+            for (const std::string &texture : data->TexturePaths())
+                TextureLoader::Prefetch(texture, TaskGraph::Current());
+        });
+        loader.jobs.push_back(std::move(job));
+    }
+
+    // once per frame on the GL thread: puts up the proxies of the models whose data finished loading and
+    // builds meshes for at most budgetMillis (at least one). Returns whether the meshes of any model
+    // changed, which a RenderQueue drawing them has to know (MarkDirty).
+    static bool Update(double budgetMillis)
+    {
+        ModelLoader &loader = instance();
+        if (loader.jobs.empty())
+            return false;
+        auto start = std::chrono::steady_clock::now();
+        bool changed = false;
+        for (Job &job : loader.jobs)
+        {
+            if (!job.begun && TaskGraph::Finished(job.import))
+                changed = loader.begin(job) || changed;
+        }
+        bool built = false;
+        for (size_t i = 0; i < loader.jobs.size();)
+        {
+            Job &job = loader.jobs[i];
+            if (!job.begun)
+            {
+                i++;
+                continue;
+            }
+            if (job.nextMesh < job.data->MeshCount() && (!built || millisSince(start) < budgetMillis))
+            {
+                job.build = TaskGraph::Run("build " + job.name, TASK_UPLOAD, [&job, &built, start, budgetMillis] {
+                    while (job.nextMesh < job.data->MeshCount() && (!built || millisSince(start) < budgetMillis))
+                    {
+                        job.model->BuildMesh(*job.data, job.nextMesh++);
+                        built = true;
+                    }
+                }, {job.build});
+            }
+            if (job.nextMesh < job.data->MeshCount())
+                break;
+            // out of the list first, the ready function may request more
+            Job done = std::move(job);
+            loader.jobs.erase(loader.jobs.begin() + i);
+            loader.finish(done);
+            changed = true;
+        }
+        double millis = millisSince(start);
+        loader.frames++;
+        loader.maxFrameMillis = std::max(loader.maxFrameMillis, millis);
+        loader.glMillis += millis;
+        if (loader.jobs.empty())
+            loader.wallMillis += millisSince(loader.batchStart);
+        return changed;
+    }
+
+    // waits for every requested model and builds all of its meshes now
+    static void FinishPending()
+    {
+        ModelLoader &loader = instance();
+        if (loader.jobs.empty())
+            return;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Job> jobs;
+        jobs.swap(loader.jobs);
+        for (Job &job : jobs)
+        {
+            if (!job.begun)
+            {
+                TaskGraph::Wait(job.import);
+                loader.begin(job);
+            }
+            TaskGraph::Run("build " + job.name, TASK_UPLOAD, [&job] {
+                while (job.nextMesh < job.data->MeshCount())
+                    job.model->BuildMesh(*job.data, job.nextMesh++);
+            }, {job.build});
+            loader.finish(job);
+        }
+        loader.glMillis += millisSince(start);
+        loader.wallMillis += millisSince(loader.batchStart);
+    }
+
+    static bool Idle()
+    {
+        return instance().jobs.empty();
+    }
+
+    static void PrintReport()
+    {
+        ModelLoader &loader = instance();
+        std::cout << "MODELS:: " << loader.models << " models (" << loader.cached << " from mesh cache) loaded in "
+                  << loader.wallMillis << " ms wall, GL objects built in " << loader.glMillis << " ms";
+        if (loader.frames)
+            std::cout << " over " << loader.frames << " frames, at most " << loader.maxFrameMillis << " ms per frame";
+        std::cout << std::endl;
+    }
+
+private:
+    struct Job {
+        Model *model;
+        ReadyFunction ready;
+        std::string name;
+        std::shared_ptr<ModelData> data;
+        TaskGraph::Task import = NO_TASK;
+        TaskGraph::Task build = NO_TASK; // the latest slice of the GL work, which follows the import
+        bool begun = false;
+        size_t nextMesh = 0;
+    };
+    std::vector<Job> jobs;
+    std::chrono::steady_clock::time_point batchStart;
+    int models = 0;
+    int cached = 0;
+    int frames = 0;
+    double maxFrameMillis = 0.0;
+    double glMillis = 0.0;
+    double wallMillis = 0.0;
+
+    // the data is loaded: the model gets its proxy. Returns whether it has one.
+    bool begin(Job &job)
+    {
+        job.begun = true;
+        job.build = job.import;
+        if (!job.data->loaded)
+            job.data->imported.clear();
+        job.model->BeginLoad(*job.data);
+        return job.model->IsProxy();
+    }
+
+    void finish(Job &job)
+    {
+        job.model->FinishLoad();
+        models++;
+        cached += job.data->fromCache;
+        // the mapping and the imported vertices aren't needed once the meshes are built
+        job.data.reset();
+        if (job.ready)
+            job.ready(*job.model);
+    }
+
+    static double millisSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static ModelLoader &instance()
+    {
+        static ModelLoader loader;
+        return loader;
+    }
+};
+#endif
@@ -0,0 +1,170 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <glad/glad.h>
+
+#ifdef RG_HAVE_EGL
+// keeps Xlib and its macros (None, Bool, Status, ...) out of the code including this header
+#ifndef EGL_NO_X11
+#define EGL_NO_X11
+#endif
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <iostream>
+
+#ifdef RG_HAVE_EGL
+// OpenGL 3.3 core context without any window or display connection, through EGL on Mesa's
+// surfaceless platform (works with llvmpipe on machines without a GPU or X server). Falls
+// back to the default EGL display when the surfaceless platform isn't available.
+class OffscreenContext
+{
+public:
+    ~OffscreenContext()
+    {
+        Destroy();
+    }
+
+    bool Create()
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint major, minor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        {
+            std::cout << "ERROR::EGL:: could not initialize a display" << std::endl;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API))
+        {
+            std::cout << "ERROR::EGL:: desktop OpenGL is not supported" << std::endl;
+            return false;
+        }
+        // no config and no surface: everything is rendered into framebuffer objects
+        context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes());
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            std::cout << "ERROR::EGL:: could not create a surfaceless OpenGL 3.3 core context (0x" << std::hex
+                      << eglGetError() << std::dec << ")" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // a second context sharing the objects of this one, for another thread to make current
+    bool CreateShared()
+    {
+        sharedContext = eglCreateContext(display, EGL_NO_CONFIG_KHR, context, attributes());
+        if (sharedContext == EGL_NO_CONTEXT)
+        {
+            std::cout << "ERROR::EGL:: could not create a shared context (0x" << std::hex << eglGetError() << std::dec << ")"
+                      << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // on the other thread
+    bool MakeSharedCurrent()
+    {
+        return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, sharedContext) == EGL_TRUE;
+    }
+
+    void ReleaseShared()
+    {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+
+    void Destroy()
+    {
+        if (sharedContext != EGL_NO_CONTEXT)
+        {
+            eglDestroyContext(display, sharedContext);
+            sharedContext = EGL_NO_CONTEXT;
+        }
+        if (context != EGL_NO_CONTEXT)
+        {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(display, context);
+            context = EGL_NO_CONTEXT;
+        }
+        if (display != EGL_NO_DISPLAY)
+        {
+            eglTerminate(display);
+            display = EGL_NO_DISPLAY;
+        }
+    }
+
+    static void *GetProcAddress(const char *name)
+    {
+        return (void *)eglGetProcAddress(name);
+    }
+
+private:
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLContext sharedContext = EGL_NO_CONTEXT;
+
+    static const EGLint *attributes()
+    {
+        static const EGLint attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        return attributes;
+    }
+};
+#endif
+
+// fixed size color + depth/stencil framebuffer to render into when there is no window
+class OffscreenTarget
+{
+public:
+    unsigned int FBO = 0;
+    int width = 0, height = 0;
+
+    bool Create(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR::FRAMEBUFFER:: offscreen target is not complete" << std::endl;
+            return false;
+        }
+        glViewport(0, 0, width, height);
+        return true;
+    }
+
+    // must run while the context is still current
+    void Destroy()
+    {
+        if (FBO != 0)
+        {
+            glDeleteRenderbuffers(2, renderbuffers);
+            glDeleteFramebuffers(1, &FBO);
+            FBO = 0;
+        }
+    }
+
+private:
+    unsigned int renderbuffers[2];
+};
+#endif
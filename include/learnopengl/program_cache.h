@@ -0,0 +1,208 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/hash.h>
+
+#include <sys/stat.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Linked programs saved as the driver's own binaries (glGetProgramBinary) in a directory, one file per
+// program named after its key: a hash of the shader sources, their defines and the vendor, renderer and
+// version strings of the GL, so a new driver or an edited shader never picks up a stale binary. File
+// layout: ProgramCacheHeader, then the binary. A file that is damaged or that the driver refuses is
+// removed and the program compiled from source as if there had been none. The ShaderCompiler reads
+// binaries on the thread pool and hands them to the driver on the GL thread.
+const char PROGRAM_CACHE_MAGIC[4] = {'R', 'G', 'P', 'B'};
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+    uint64_t binaryHash;   // FNV-1a of the binary, so a truncated or damaged file is never handed to the driver
+};
+
+class ProgramCache
+{
+public:
+    // call on the GL thread after GLExtensions::Load; until then (or on a GL without binary formats)
+    // every program is compiled from source
+    static void Enable(const std::string &directory)
+    {
+        ProgramCache &cache = instance();
+        if (!GLExtensions::HasProgramBinary())
+        {
+            std::cout << "SHADER CACHE:: the GL offers no program binary formats, shaders are compiled from source" << std::endl;
+            return;
+        }
+        mkdir(directory.c_str(), 0755);
+        cache.directory = directory;
+        cache.driver = std::string(reinterpret_cast<const char *>(glGetString(GL_VENDOR))) + '\n' +
+                       reinterpret_cast<const char *>(glGetString(GL_RENDERER)) + '\n' +
+                       reinterpret_cast<const char *>(glGetString(GL_VERSION));
+        cache.enabled = true;
+    }
+
+    static bool Enabled()
+    {
+        return instance().enabled;
+    }
+
+    // the key a program built from these sources (in stage order, empty for a missing stage) and defines
+    // is stored under
+    static uint64_t Key(const std::vector<std::string> &sources, const std::string &defines)
+    {
+        uint64_t key = HashString(instance().driver);
+        for (const std::string &source : sources)
+        {
+            // the length keeps "ab" + "c" apart from "a" + "bc"
+            uint64_t size = source.size();
+            key = HashBytes(&size, sizeof(size), key);
+            key = HashString(source, key);
+        }
+        return HashString(defines, key);
+    }
+
+    // reads the binary stored under key; false when there is none or it is damaged (then it is removed).
+    // Only file I/O, safe on any thread once Enable returned
+    static bool Read(uint64_t key, GLenum &binaryFormat, std::vector<char> &binary)
+    {
+        ProgramCache &cache = instance();
+        if (!cache.enabled)
+            return false;
+        std::string path = cache.pathFor(key);
+        FILE *file = fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+        ProgramCacheHeader header;
+        bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, PROGRAM_CACHE_MAGIC, 4) == 0 &&
+                  header.version == PROGRAM_CACHE_VERSION && header.key == key;
+        // the size in the header is only trusted if the file holds exactly that much after it
+        struct stat status;
+        ok = ok && fstat(fileno(file), &status) == 0 && (uint64_t)status.st_size == sizeof(header) + (uint64_t)header.binarySize;
+        if (ok)
+        {
+            binary.resize(header.binarySize);
+            ok = fread(binary.data(), 1, binary.size(), file) == binary.size() && HashBytes(binary.data(), binary.size()) == header.binaryHash;
+        }
+        fclose(file);
+        if (!ok)
+        {
+            Reject(key);
+            return false;
+        }
+        binaryFormat = header.binaryFormat;
+        return true;
+    }
+
+    // the binary under key was damaged or the driver refused to link it: it is removed, the program is
+    // compiled from source instead
+    static void Reject(uint64_t key)
+    {
+        ProgramCache &cache = instance();
+        std::string path = cache.pathFor(key);
+        std::cout << "SHADER CACHE:: " << path << " is stale or damaged, compiling from source" << std::endl;
+        remove(path.c_str());
+        cache.rejected++;
+    }
+
+    // before linking a program that will be stored: some drivers only keep the binary when asked to
+    static void PrepareLink(GLuint program)
+    {
+        if (instance().enabled)
+            GLExtensions::ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // saves the binary of a program that linked. Written to a temporary file first and renamed, so a
+    // run that stops halfway never leaves a truncated binary behind
+    static void Store(GLuint program, uint64_t key)
+    {
+        ProgramCache &cache = instance();
+        if (!cache.enabled)
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        GLExtensions::GetProgramBinary(program, length, &written, &format, binary.data());
+        if (written <= 0)
+            return;
+
+        ProgramCacheHeader header;
+        memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+        header.version = PROGRAM_CACHE_VERSION;
+        header.key = key;
+        header.binaryFormat = format;
+        header.binarySize = (uint32_t)written;
+        header.binaryHash = HashBytes(binary.data(), written);
+        std::string path = cache.pathFor(key);
+        std::string tmpPath = path + ".tmp";
+        FILE *file = fopen(tmpPath.c_str(), "wb");
+        if (!file)
+            return;
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, written, file) == (size_t)written;
+        ok = fclose(file) == 0 && ok;
+        if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0)
+            remove(tmpPath.c_str());
+    }
+
+    // a program was loaded from the cache (hit) or compiled from source, taking millis of the GL thread
+    static void Record(const std::string &name, bool hit, double millis)
+    {
+        ProgramCache &cache = instance();
+        (hit ? cache.hitMillis : cache.compileMillis) += millis;
+        (hit ? cache.hits : cache.compiles)++;
+        std::cout << "SHADER:: " << name << (hit ? " loaded from program cache, " : " compiled, ") << millis << " ms on the GL thread" << std::endl;
+    }
+
+    static void PrintReport()
+    {
+        ProgramCache &cache = instance();
+        std::cout << "SHADER CACHE:: " << cache.hits + cache.compiles << " programs, " << cache.hits << " from cache in "
+                  << cache.hitMillis << " ms, " << cache.compiles << " compiled in " << cache.compileMillis << " ms";
+        if (cache.rejected)
+            std::cout << " (" << cache.rejected << " cached binaries rejected)";
+        if (!cache.enabled)
+            std::cout << " (cache disabled)";
+        std::cout << std::endl;
+    }
+
+private:
+    bool enabled = false;
+    std::string directory;
+    std::string driver;
+    int hits = 0;
+    int compiles = 0;
+    std::atomic<int> rejected{0};
+    double hitMillis = 0.0;
+    double compileMillis = 0.0;
+
+    std::string pathFor(uint64_t key) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return directory + '/' + name;
+    }
+
+    static ProgramCache &instance()
+    {
+        static ProgramCache cache;
+        return cache;
+    }
+};
+#endif
@@ -0,0 +1,379 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/frustum.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_variants.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// passes run in this order, each with its own fixed function state
+enum RenderPass {
+    PASS_OPAQUE = 0,
+    PASS_OPAQUE_CULL_FRONT = 1, // closed meshes seen from the inside (the lamp shades)
+};
+
+// which of the submitted packets Execute draws
+enum PacketFilter {
+    PACKETS_ALL = 0,
+    PACKETS_LIT = 1,   // the models added with ShaderVariants (the deferred renderer's geometry pass)
+    PACKETS_UNLIT = 2, // the rest: models with a fixed shader, and proxy boxes
+};
+
+// Layout of the 64-bit sort key, most significant bits first:
+//   pass 4 | shader 8 | material 20 | VAO 16 | depth 16
+// Sorting by key groups packets by state in order of switching cost, and draws front to back
+// within a group so early depth testing rejects as much as possible.
+const int SORT_KEY_PASS_SHIFT = 60;
+const int SORT_KEY_SHADER_SHIFT = 52;
+const int SORT_KEY_MATERIAL_SHIFT = 32;
+const int SORT_KEY_VAO_SHIFT = 16;
+const uint64_t SORT_KEY_DEPTH_MASK = 0xffff;
+
+// state changes and draws issued by RenderQueue::Execute during one frame (all its calls since Submit)
+struct RenderQueueStats {
+    unsigned int packets = 0;
+    unsigned int programChanges = 0;
+    unsigned int materialChanges = 0;
+    unsigned int textureBinds = 0;
+    unsigned int vaoBinds = 0;
+    unsigned int rebuilds = 0;   // times the static draw list was compiled, over the whole run
+    unsigned int prepassPackets = 0; // drawn into the depth pre-pass
+    // vertex data read by the draws (every vertex once per instance), and what it would be with full vertices
+    unsigned long long vertexBytes = 0;
+    unsigned long long fullVertexBytes = 0;
+    // instances and triangles drawn at every level of detail
+    unsigned int lodInstances[MAX_MESH_LODS] = {};
+    unsigned long long lodTriangles[MAX_MESH_LODS] = {};
+};
+
+// Draws the static models of the scene. Models are registered once with the shader and pass
+// they are drawn with; the queue compiles them into a persistent list of packets (one per mesh
+// and level of detail) whose state part of the sort key never changes, and only recompiles it when
+// the scene changes. Every frame the instances are culled and assigned their level of detail,
+// each visible packet gets its depth and the packets are executed in key order, skipping every
+// program, texture and VAO bind that is already in place. A model still loading in the background is
+// drawn as its bounding box (Model::IsProxy) with the proxy shader, or not at all without one.
+//
+// A model added with ShaderVariants is drawn with the variant that does just what each mesh needs: the
+// frame's defines (SetDefines: which lights are on) plus PARALLAX for materials with a height map. The
+// variant is part of the compiled packet, so changing the defines recompiles the list. The deferred
+// renderer executes the list in two parts, the lit packets into its G-buffer and the others after its
+// lighting pass. With a depth pre-pass the lit packets are first drawn depth only from their position
+// streams (ExecuteDepthPrepass); their shading pass then tests GL_EQUAL and shades every visible
+// pixel once.
+class RenderQueue
+{
+public:
+    RenderQueueStats stats;
+    // view depth mapped to the largest depth key, normally the far plane
+    float maxDepth = 100.0f;
+
+    void Add(Model &model, Shader &shader, RenderPass pass)
+    {
+        ModelEntry entry;
+        entry.model = &model;
+        entry.shader = &shader;
+        entry.variants = nullptr;
+        entry.pass = pass;
+        models.push_back(entry);
+        MarkDirty();
+    }
+
+    void Add(Model &model, ShaderVariants &variants, RenderPass pass)
+    {
+        ModelEntry entry;
+        entry.model = &model;
+        entry.shader = nullptr;
+        entry.variants = &variants;
+        entry.pass = pass;
+        models.push_back(entry);
+        MarkDirty();
+    }
+
+    // the defines every variant is picked with; cheap to call every frame when they don't change
+    void SetDefines(const ShaderDefines &defines)
+    {
+        if (defines == frameDefines)
+            return;
+        frameDefines = defines;
+        MarkDirty();
+    }
+
+    // the program proxy boxes are drawn with
+    void SetProxyShader(Shader &shader)
+    {
+        proxyShader = &shader;
+        MarkDirty();
+    }
+
+    void Clear()
+    {
+        models.clear();
+        MarkDirty();
+    }
+
+    // the set of models, their meshes (a model finished loading) or their materials changed; recompile
+    // before the next frame
+    void MarkDirty()
+    {
+        dirty = true;
+    }
+
+    // culls all instances and builds this frame's sorted packet list
+    void Submit(ViewCuller &culler)
+    {
+        if (dirty)
+            compile();
+        for (ModelEntry &entry : models)
+            entry.model->CullInstances(culler);
+
+        frame.clear();
+        for (unsigned int i = 0; i < packets.size(); i++)
+        {
+            const StaticPacket &packet = packets[i];
+            if (packet.model->VisibleCount(packet.mesh, packet.lod) == 0)
+                continue;
+            float depth = std::max(0.0f, std::min(1.0f, packet.model->VisibleDepth(packet.mesh, packet.lod) / maxDepth));
+            FramePacket visible;
+            visible.key = packet.stateKey | (uint64_t)(depth * SORT_KEY_DEPTH_MASK);
+            visible.packet = i;
+            frame.push_back(visible);
+        }
+        std::sort(frame.begin(), frame.end(), [](const FramePacket &a, const FramePacket &b) { return a.key < b.key; });
+
+        RenderQueueStats frameStats;
+        frameStats.rebuilds = stats.rebuilds;
+        stats = frameStats;
+    }
+
+    void Execute(PacketFilter filter = PACKETS_ALL)
+    {
+        int currentPass = -1;
+        Shader *currentShader = nullptr;
+        int currentMaterial = -1;
+        unsigned int currentVAO = 0;
+        for (unsigned int &texture : boundTextures)
+            texture = 0;
+        for (unsigned int &sampler : boundSamplers)
+            sampler = 0;
+
+        for (const FramePacket &visible : frame)
+        {
+            const StaticPacket &packet = packets[visible.packet];
+            if (filter != PACKETS_ALL && packet.lit != (filter == PACKETS_LIT))
+                continue;
+            Mesh &mesh = packet.model->meshes[packet.mesh];
+            stats.packets++;
+
+            if (packet.pass != currentPass)
+            {
+                currentPass = packet.pass;
+                applyPass(packet.pass);
+            }
+            if (packet.shader != currentShader)
+            {
+                currentShader = packet.shader;
+                currentShader->use();
+                currentMaterial = -1; // sampler uniforms are per program
+                stats.programChanges++;
+            }
+            if (packet.material != currentMaterial)
+            {
+                currentMaterial = packet.material;
+                stats.materialChanges++;
+                const int *samplers = mesh.SamplerUniforms(*currentShader);
+                for (unsigned int unit = 0; unit < mesh.bindings.size() && unit < MAX_TEXTURE_UNITS; unit++)
+                {
+                    currentShader->setInt(samplers[unit], unit);
+                    if (boundTextures[unit] != mesh.bindings[unit].texture)
+                    {
+                        glActiveTexture(GL_TEXTURE0 + unit);
+                        glBindTexture(GL_TEXTURE_2D, mesh.bindings[unit].texture);
+                        boundTextures[unit] = mesh.bindings[unit].texture;
+                        stats.textureBinds++;
+                    }
+                    if (boundSamplers[unit] != mesh.bindings[unit].samplerObject)
+                    {
+                        glBindSampler(unit, mesh.bindings[unit].samplerObject);
+                        boundSamplers[unit] = mesh.bindings[unit].samplerObject;
+                    }
+                }
+            }
+            mesh.SetVertexUniforms(*currentShader);
+            // re-pointing the instance attributes goes through the VAO and unbinds it
+            if (mesh.SetInstanceBuffer(packet.model->VisibleBuffer(), packet.model->VisibleOffset(packet.mesh, packet.lod)))
+                currentVAO = 0;
+            if (mesh.VAO != currentVAO)
+            {
+                currentVAO = mesh.VAO;
+                glBindVertexArray(currentVAO);
+                stats.vaoBinds++;
+            }
+            unsigned int instances = packet.model->VisibleCount(packet.mesh, packet.lod);
+            const MeshLod &lod = mesh.lods[packet.lod];
+            glDrawElementsInstanced(GL_TRIANGLES, lod.indexCount, mesh.indexType, mesh.LodIndexOffset(packet.lod), instances);
+            stats.lodInstances[packet.lod] += instances;
+            stats.lodTriangles[packet.lod] += (unsigned long long)lod.indexCount / 3 * instances;
+            stats.vertexBytes += (unsigned long long)mesh.vertexCount * mesh.VertexStride() * instances;
+            stats.fullVertexBytes += (unsigned long long)mesh.vertexCount * sizeof(Vertex) * instances;
+        }
+
+        // leave the defaults behind for the hand written draws that follow
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        if (currentPass != -1)
+            applyPass(PASS_OPAQUE);
+    }
+
+    // the lit packets' depth, through each mesh's position stream with the given depth only program, for
+    // Execute(PACKETS_LIT) to test GL_EQUAL against. The lit programs have no discard, so the depth is
+    // exactly what they would write.
+    void ExecuteDepthPrepass(Shader &shader)
+    {
+        int currentPass = -1;
+        unsigned int currentVAO = 0;
+        shader.use();
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        for (const FramePacket &visible : frame)
+        {
+            const StaticPacket &packet = packets[visible.packet];
+            if (!packet.lit)
+                continue;
+            Mesh &mesh = packet.model->meshes[packet.mesh];
+            stats.prepassPackets++;
+
+            if (packet.pass != currentPass)
+            {
+                currentPass = packet.pass;
+                applyPass(packet.pass);
+            }
+            mesh.SetVertexUniforms(shader);
+            if (mesh.SetInstanceBuffer(packet.model->VisibleBuffer(), packet.model->VisibleOffset(packet.mesh, packet.lod)))
+                currentVAO = 0;
+            if (mesh.depthVAO != currentVAO)
+            {
+                currentVAO = mesh.depthVAO;
+                glBindVertexArray(currentVAO);
+                stats.vaoBinds++;
+            }
+            unsigned int instances = packet.model->VisibleCount(packet.mesh, packet.lod);
+            const MeshLod &lod = mesh.lods[packet.lod];
+            glDrawElementsInstanced(GL_TRIANGLES, lod.indexCount, mesh.indexType, mesh.LodIndexOffset(packet.lod), instances);
+            stats.vertexBytes += (unsigned long long)mesh.vertexCount * mesh.PositionStride() * instances;
+            stats.fullVertexBytes += (unsigned long long)mesh.vertexCount * sizeof(glm::vec3) * instances;
+        }
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glBindVertexArray(0);
+        if (currentPass != -1)
+            applyPass(PASS_OPAQUE);
+    }
+
+private:
+    static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+    struct ModelEntry {
+        Model *model;
+        Shader *shader;
+        ShaderVariants *variants; // instead of shader
+        RenderPass pass;
+    };
+    // one level of detail of a mesh of a registered model; everything but the depth is known at compile time
+    struct StaticPacket {
+        uint64_t stateKey;
+        Model *model;
+        unsigned int mesh;
+        unsigned int lod;
+        Shader *shader;
+        int material;
+        int pass;
+        bool lit; // drawn with a variant
+    };
+    struct FramePacket {
+        uint64_t key;
+        unsigned int packet;
+    };
+
+    vector<ModelEntry> models;
+    Shader *proxyShader = nullptr;
+    ShaderDefines frameDefines;
+    vector<StaticPacket> packets;
+    vector<FramePacket> frame;
+    bool dirty = true;
+    unsigned int boundTextures[MAX_TEXTURE_UNITS];
+    unsigned int boundSamplers[MAX_TEXTURE_UNITS];
+
+    void compile()
+    {
+        packets.clear();
+        // small ids for the key fields, handed out in registration order
+        map<Shader *, uint64_t> shaderIds;
+        map<vector<pair<unsigned int, string>>, uint64_t> materialIds; // a material is what its binding table binds
+        map<unsigned int, uint64_t> vaoIds;
+        for (ModelEntry &entry : models)
+        {
+            bool proxy = entry.model->IsProxy();
+            RenderPass pass = proxy ? PASS_OPAQUE : entry.pass;
+            for (unsigned int i = 0; i < entry.model->meshes.size(); i++)
+            {
+                const Mesh &mesh = entry.model->meshes[i];
+                Shader *shader = proxy ? proxyShader : entry.shader;
+                if (!proxy && entry.variants)
+                {
+                    ShaderDefines defines = frameDefines;
+                    defines.Set("PARALLAX", mesh.HasTexture("texture_height"));
+                    shader = &entry.variants->Get(defines);
+                }
+                if (!shader)
+                    continue;
+                uint64_t shaderId = shaderIds.insert(make_pair(shader, (uint64_t)shaderIds.size())).first->second;
+                vector<pair<unsigned int, string>> textures;
+                for (const Mesh::TextureBinding &binding : mesh.bindings)
+                    textures.push_back(make_pair(binding.texture, binding.sampler));
+                uint64_t materialId = materialIds.insert(make_pair(textures, (uint64_t)materialIds.size())).first->second;
+                uint64_t vaoId = vaoIds.insert(make_pair(mesh.VAO, (uint64_t)vaoIds.size())).first->second;
+
+                // the levels of a mesh share its VAO and material, so they sort next to each other
+                for (unsigned int lod = 0; lod < mesh.lods.size(); lod++)
+                {
+                    StaticPacket packet;
+                    packet.stateKey = ((uint64_t)pass << SORT_KEY_PASS_SHIFT) |
+                                      ((shaderId & 0xff) << SORT_KEY_SHADER_SHIFT) |
+                                      ((materialId & 0xfffff) << SORT_KEY_MATERIAL_SHIFT) |
+                                      ((vaoId & 0xffff) << SORT_KEY_VAO_SHIFT);
+                    packet.model = entry.model;
+                    packet.mesh = i;
+                    packet.lod = lod;
+                    packet.shader = shader;
+                    packet.material = (int)materialId;
+                    packet.pass = pass;
+                    packet.lit = !proxy && entry.variants;
+                    packets.push_back(packet);
+                }
+            }
+        }
+        frame.reserve(packets.size());
+        dirty = false;
+        stats.rebuilds++;
+    }
+
+    static void applyPass(int pass)
+    {
+        if (pass == PASS_OPAQUE_CULL_FRONT)
+        {
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_FRONT);
+        }
+        else
+            glDisable(GL_CULL_FACE);
+    }
+};
+#endif
@@ -0,0 +1,74 @@
+#ifndef SAMPLER_CACHE_H
+#define SAMPLER_CACHE_H
+
+#include <glad/glad.h>
+
+// how a texture is sampled
+enum SamplerKind {
+    SAMPLER_REPEAT,  // tiled, trilinear (material textures)
+    SAMPLER_CLAMP,   // clamped to the edge, trilinear (textures with alpha: no semi-transparent border from the opposite side)
+    SAMPLER_CUBEMAP, // clamped on all three axes, bilinear (the skybox)
+    SAMPLER_POINT,   // clamped, unfiltered, base level only (render targets read back by a later pass)
+    SAMPLER_KIND_COUNT
+};
+
+// One sampler object per kind of sampling, shared by every texture sampled that way instead of each
+// texture carrying its own filter and wrap parameters. A sampler bound to a unit overrides the
+// parameters of any texture bound there, so whoever binds a texture binds its sampler as well.
+class SamplerCache
+{
+public:
+    static unsigned int Get(SamplerKind kind)
+    {
+        SamplerCache &cache = instance();
+        if (!cache.samplers[kind])
+            cache.samplers[kind] = create(kind);
+        return cache.samplers[kind];
+    }
+
+    static void Bind(unsigned int unit, SamplerKind kind)
+    {
+        glBindSampler(unit, Get(kind));
+    }
+
+    // deletes the samplers; call while the GL context is still current
+    static void Clear()
+    {
+        SamplerCache &cache = instance();
+        for (unsigned int &sampler : cache.samplers)
+        {
+            if (sampler)
+                glDeleteSamplers(1, &sampler);
+            sampler = 0;
+        }
+    }
+
+private:
+    unsigned int samplers[SAMPLER_KIND_COUNT] = {};
+
+    static unsigned int create(SamplerKind kind)
+    {
+        unsigned int sampler;
+        glGenSamplers(1, &sampler);
+        GLint wrap = kind == SAMPLER_REPEAT ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, wrap);
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, wrap);
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R, wrap);
+        if (kind == SAMPLER_POINT)
+        {
+            glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            return sampler;
+        }
+        glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, kind == SAMPLER_CUBEMAP ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+        glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return sampler;
+    }
+
+    static SamplerCache &instance()
+    {
+        static SamplerCache cache;
+        return cache;
+    }
+};
+#endif
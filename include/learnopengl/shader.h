@@ -4,195 +4,181 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <memory>
 #include <string>
-#include <fstream>
-#include <sstream>
-#include <iostream>
+#include <utility>
+#include <vector>
 #include <common.h>
+#include <learnopengl/shader_compiler.h>
+#include <learnopengl/uniform_cache.h>
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor starts building the program: the files are read on the thread pool and compiled by
+    // the ShaderCompiler while the caller goes on. Every stage may #include "files" relative to its own
+    // directory and is compiled with the lines in defines ("#define NAME value") right after its #version.
+    // The program is waited for when it is first used; uniform blocks bound before that are bound then
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::string &defines = "")
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
-        {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
-        }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        build = ShaderCompiler::Submit(vertexPath, fragmentPath, geometryPath != nullptr ? geometryPath : "", defines);
+        ID = build->program;
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
+        finish();
         glUseProgram(ID); 
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        int intValue = (int)value;
+        GLint location = uniforms.Update(name, &intValue, sizeof(intValue));
+        if (location != -1)
+            glUniform1i(location, intValue);
+    }
+    // by uniform index from findUniform, for hot paths that must not touch strings
+    void setBool(int uniform, bool value) const
+    {
+        int intValue = (int)value;
+        GLint location = uniforms.Update(uniform, &intValue, sizeof(intValue));
+        if (location != -1)
+            glUniform1i(location, intValue);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        GLint location = uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform1i(location, value);
+    }
+    // by uniform index from findUniform, for hot paths that must not touch strings
+    void setInt(int uniform, int value) const
+    {
+        GLint location = uniforms.Update(uniform, &value, sizeof(value));
+        if (location != -1)
+            glUniform1i(location, value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        GLint location = uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform1f(location, value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLint location = uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform2fv(location, 1, &value[0]);
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glm::vec2 value(x, y);
+        GLint location = uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform2fv(location, 1, &value[0]);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLint location = uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform3fv(location, 1, &value[0]);
+    }
+    // by uniform index from findUniform
+    void setVec3(int uniform, const glm::vec3 &value) const
+    {
+        GLint location = uniforms.Update(uniform, &value, sizeof(value));
+        if (location != -1)
+            glUniform3fv(location, 1, &value[0]);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glm::vec3 value(x, y, z);
+        GLint location = uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform3fv(location, 1, &value[0]);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLint location = uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform4fv(location, 1, &value[0]);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glm::vec4 value(x, y, z, w);
+        GLint location = uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform4fv(location, 1, &value[0]);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLint location = uniforms.Update(name, &mat, sizeof(mat));
+        if (location != -1)
+            glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLint location = uniforms.Update(name, &mat, sizeof(mat));
+        if (location != -1)
+            glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLint location = uniforms.Update(name, &mat, sizeof(mat));
+        if (location != -1)
+            glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
     }
-
-private:
-    // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    // index of an active uniform for the index based setters, -1 if the program doesn't use it
+    int findUniform(const std::string &name) const
     {
-        GLint success;
-        GLchar infoLog[1024];
-        if(type != "PROGRAM")
-        {
-            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-            if(!success)
-            {
-                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
-        }
-        else
+        finish();
+        return uniforms.Find(name);
+    }
+    // ------------------------------------------------------------------------
+    // connects a uniform block of the program to a buffer binding point; blocks the program doesn't declare are ignored
+    void bindUniformBlock(const std::string &name, unsigned int binding) const
+    {
+        if (build)
         {
-            glGetProgramiv(shader, GL_LINK_STATUS, &success);
-            if(!success)
-            {
-                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
+            blockBindings.push_back(std::make_pair(name, binding));
+            return;
         }
+        unsigned int index = glGetUniformBlockIndex(ID, name.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+
+private:
+    // active uniform locations and the values last uploaded to them
+    mutable UniformCache uniforms;
+    // until the program is first used: its build, and the uniform blocks to bind once it is linked
+    mutable std::shared_ptr<ProgramBuild> build;
+    mutable std::vector<std::pair<std::string, unsigned int>> blockBindings;
+
+    // waits for the program and resolves every uniform location once, the setters only look them up
+    void finish() const
+    {
+        if (!build)
+            return;
+        ShaderCompiler::Finish(build);
+        build.reset();
+        uniforms.Reflect(ID);
+        for (const std::pair<std::string, unsigned int> &block : blockBindings)
+            bindUniformBlock(block.first, block.second);
+        blockBindings.clear();
     }
 };
 #endif
@@ -0,0 +1,471 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/task_graph.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the stages of a program, in the order their sources go into the ProgramCache key
+const GLenum SHADER_STAGE_TYPES[3] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER};
+const char *const SHADER_STAGE_NAMES[3] = {"VERTEX", "FRAGMENT", "GEOMETRY"};
+
+// A program on its way from its files to being linked. The read task fills in the sources and the
+// cached binary on a worker; from then on only the GL thread touches it
+struct ProgramBuild {
+    GLuint program = 0;
+    std::string name;      // the files and defines, for the log
+    std::string paths[3];  // per stage, empty for a missing geometry stage
+    std::string defines;
+    TaskGraph::Task read = NO_TASK;
+    // from the read task
+    std::string sources[3];
+    uint64_t key = 0;
+    bool cached = false;
+    GLenum binaryFormat = 0;
+    std::vector<char> binary;
+    // on the GL thread
+    GLuint shaders[3] = {};
+    std::future<void> compiled;  // with a compile thread: ready once the thread is done with the program
+    bool submitted = false;
+    bool finished = false;
+    bool linked = false;
+    double glMillis = 0.0;  // time the GL thread spent on it
+};
+
+// Builds programs without making the GL thread wait for the compiler. Submit starts reading (and
+// preprocessing) the files of a program on the thread pool and returns; Update submits the compile and
+// link of every program whose files were read, without asking for their status, which is what makes a
+// driver finish the work there and then. A program is only waited for (its status checked, its binary
+// stored in the ProgramCache) by Finish, when it is first used.
+//
+// With GL_KHR_parallel_shader_compile the driver compiles on threads of its own, and Update also
+// finishes the programs it reports complete, so by first use there is nothing left to wait for. Other
+// drivers compile when the shaders are submitted or when their status is first asked for; for those
+// StartCompileThread moves the compile and link onto a thread of our own, in a second context sharing
+// the objects of the GL thread's, and Update finishes the programs that thread is done with. Without
+// either the compile happens on the GL thread, between loading steps instead of in one block before them.
+class ShaderCompiler
+{
+public:
+    // GL thread: creates the program object and starts reading its files
+    static std::shared_ptr<ProgramBuild> Submit(const std::string &vertexPath, const std::string &fragmentPath,
+                                                const std::string &geometryPath, const std::string &defines)
+    {
+        ShaderCompiler &compiler = instance();
+        std::shared_ptr<ProgramBuild> build = std::make_shared<ProgramBuild>();
+        build->program = glCreateProgram();
+        build->paths[0] = vertexPath;
+        build->paths[1] = fragmentPath;
+        build->paths[2] = geometryPath;
+        build->defines = defines;
+        build->name = vertexPath + " + " + fragmentPath + definesSummary(defines);
+        build->read = TaskGraph::Submit("read " + build->name, TASK_SHADER, [build] { read(*build); });
+        compiler.pending.push_back(build);
+        compiler.programs++;
+        return build;
+    }
+
+    // GL thread, once per frame while loading: submits what was read, finishes what the driver completed
+    static void Update()
+    {
+        ShaderCompiler &compiler = instance();
+        for (size_t i = 0; i < compiler.pending.size();)
+        {
+            std::shared_ptr<ProgramBuild> build = compiler.pending[i];
+            if (!TaskGraph::Finished(build->read))
+            {
+                i++;
+                continue;
+            }
+            compiler.pending.erase(compiler.pending.begin() + i);
+            compiler.submit(build);
+        }
+        if (!compiler.parallel && !compiler.compileThread.joinable())
+            return;
+        for (size_t i = 0; i < compiler.compiling.size();)
+        {
+            std::shared_ptr<ProgramBuild> build = compiler.compiling[i];
+            if (!build->finished && !completed(*build))
+            {
+                i++;
+                continue;
+            }
+            compiler.compiling.erase(compiler.compiling.begin() + i);
+            if (!build->finished)
+                compiler.finish(*build);
+        }
+    }
+
+    // GL thread: waits for the program to be linked, submitting it first if Update hasn't; returns
+    // whether it linked
+    static bool Finish(const std::shared_ptr<ProgramBuild> &build)
+    {
+        if (build->finished)
+            return build->linked;
+        ShaderCompiler &compiler = instance();
+        auto start = std::chrono::steady_clock::now();
+        if (!build->submitted)
+        {
+            TaskGraph::Wait(build->read);
+            compiler.pending.erase(std::find(compiler.pending.begin(), compiler.pending.end(), build));
+            compiler.submit(build);
+        }
+        compiler.compiling.erase(std::find(compiler.compiling.begin(), compiler.compiling.end(), build));
+        compiler.finish(*build);
+        compiler.waitedAtFirstUse++;
+        compiler.firstUseMillis += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return build->linked;
+    }
+
+    // GL thread, before the first Submit, when the driver has no parallel compile: starts the compile
+    // thread. makeCurrent runs on it first and makes a context sharing objects with the GL thread's
+    // current (returning whether it could), release runs on it last. Returns whether the thread runs.
+    static bool StartCompileThread(std::function<bool()> makeCurrent, std::function<void()> release)
+    {
+        ShaderCompiler &compiler = instance();
+        if (compiler.parallel || compiler.compileThread.joinable())
+            return false;
+        std::promise<bool> started;
+        std::future<bool> current = started.get_future();
+        compiler.compileThread = std::thread([&compiler, started = std::move(started), makeCurrent, release]() mutable {
+            bool ok = makeCurrent();
+            started.set_value(ok);
+            if (!ok)
+                return;
+            compiler.compileLoop();
+            release();
+        });
+        if (!current.get())
+        {
+            compiler.compileThread.join();
+            std::cout << "ERROR::SHADER:: could not make a context current on the compile thread" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // GL thread: compiles what is still queued, then stops the compile thread; before its context is destroyed
+    static void StopCompileThread()
+    {
+        instance().stopCompileThread();
+    }
+
+    static void PrintReport()
+    {
+        ShaderCompiler &compiler = instance();
+        std::cout << "SHADER COMPILER:: " << compiler.programs << " programs, "
+                  << (compiler.parallel ? "compiled on driver threads"
+                      : compiler.compileThread.joinable() ? "compiled on a compile thread"
+                      : "no parallel compile in the driver") << "; GL thread "
+                  << compiler.submitMillis << " ms submitting, " << compiler.finishMillis << " ms finishing, "
+                  << compiler.waitedAtFirstUse << " programs waited for at first use (" << compiler.firstUseMillis << " ms)" << std::endl;
+    }
+
+private:
+    bool parallel = false;
+    // read or being read, not submitted yet
+    std::vector<std::shared_ptr<ProgramBuild>> pending;
+    // submitted, polled by Update when the driver or the compile thread compiles in parallel
+    std::vector<std::shared_ptr<ProgramBuild>> compiling;
+    // without parallel compile in the driver: the programs waiting for the compile thread
+    struct CompileJob {
+        std::shared_ptr<ProgramBuild> build;
+        std::promise<void> done;
+    };
+    std::thread compileThread;
+    std::mutex compileMutex;
+    std::condition_variable compileQueued;
+    std::deque<CompileJob> compileQueue;
+    bool stopping = false;
+    int programs = 0;
+    int waitedAtFirstUse = 0;
+    double submitMillis = 0.0;
+    double finishMillis = 0.0;
+    double firstUseMillis = 0.0;
+
+    ShaderCompiler()
+    {
+        // created by the first Submit, on the GL thread
+        parallel = GLExtensions::HasParallelShaderCompile();
+        if (parallel)
+            GLExtensions::MaxShaderCompilerThreads(0xFFFFFFFF);
+    }
+
+    ~ShaderCompiler()
+    {
+        stopCompileThread();
+    }
+
+    void stopCompileThread()
+    {
+        if (!compileThread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(compileMutex);
+            stopping = true;
+        }
+        compileQueued.notify_one();
+        compileThread.join();
+    }
+
+    // compile thread: links what submit queued, asking for its status there so the driver is done with
+    // the work before the GL thread looks at the program
+    void compileLoop()
+    {
+        for (;;)
+        {
+            CompileJob job;
+            {
+                std::unique_lock<std::mutex> lock(compileMutex);
+                compileQueued.wait(lock, [this] { return stopping || !compileQueue.empty(); });
+                if (compileQueue.empty())
+                    return;
+                job = std::move(compileQueue.front());
+                compileQueue.pop_front();
+            }
+            ProgramBuild &b = *job.build;
+            TaskGraph::Run("compile " + b.name, TASK_SHADER, [this, &b] {
+                link(b);
+                GLint linked = GL_FALSE;
+                glGetProgramiv(b.program, GL_LINK_STATUS, &linked);
+                // the program's new state reaches the GL thread's context once the commands completed
+                glFinish();
+            }, {b.read});
+            job.done.set_value();
+        }
+    }
+
+    // worker: the sources with includes and defines, and a binary of them linked on an earlier run
+    static void read(ProgramBuild &build)
+    {
+        for (int stage = 0; stage < 3; stage++)
+        {
+            if (build.paths[stage].empty())
+                continue;
+            std::ifstream file(build.paths[stage]);
+            if (!file)
+            {
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << build.paths[stage] << std::endl;
+                continue;
+            }
+            std::stringstream stream;
+            stream << file.rdbuf();
+            build.sources[stage] = preprocess(stream.str(), build.paths[stage], build.defines);
+        }
+        build.key = ProgramCache::Key({build.sources[0], build.sources[1], build.sources[2]}, build.defines);
+        build.cached = ProgramCache::Read(build.key, build.binaryFormat, build.binary);
+    }
+
+    // hands the binary or the sources to the driver and starts the link, asking nothing back
+    void submit(const std::shared_ptr<ProgramBuild> &build)
+    {
+        auto start = std::chrono::steady_clock::now();
+        ProgramBuild &b = *build;
+        if (compileThread.joinable())
+        {
+            // the program object created here has to reach the compile thread's context
+            glFlush();
+            CompileJob job;
+            job.build = build;
+            b.compiled = job.done.get_future();
+            {
+                std::lock_guard<std::mutex> lock(compileMutex);
+                compileQueue.push_back(std::move(job));
+            }
+            compileQueued.notify_one();
+        }
+        else
+            TaskGraph::Run("compile " + b.name, TASK_SHADER, [this, &b] { link(b); }, {b.read});
+        b.submitted = true;
+        compiling.push_back(build);
+        double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        b.glMillis += millis;
+        submitMillis += millis;
+    }
+
+    // the binary or the sources into the program
+    void link(ProgramBuild &build)
+    {
+        if (build.cached)
+        {
+            GLExtensions::ProgramBinary(build.program, build.binaryFormat, build.binary.data(), (GLsizei)build.binary.size());
+            std::vector<char>().swap(build.binary);
+        }
+        else
+            compileAndLink(build);
+    }
+
+    void compileAndLink(ProgramBuild &build)
+    {
+        for (int stage = 0; stage < 3; stage++)
+        {
+            if (build.paths[stage].empty())
+                continue;
+            const char *code = build.sources[stage].c_str();
+            build.shaders[stage] = glCreateShader(SHADER_STAGE_TYPES[stage]);
+            glShaderSource(build.shaders[stage], 1, &code, NULL);
+            glCompileShader(build.shaders[stage]);
+            glAttachShader(build.program, build.shaders[stage]);
+        }
+        ProgramCache::PrepareLink(build.program);
+        glLinkProgram(build.program);
+    }
+
+    // checks what the driver made of the program: a refused binary is compiled from source after all,
+    // a program linked from source goes into the ProgramCache
+    void finish(ProgramBuild &build)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (build.compiled.valid())
+            build.compiled.wait();
+        if (build.cached)
+        {
+            GLint linked = GL_FALSE;
+            glGetProgramiv(build.program, GL_LINK_STATUS, &linked);
+            build.linked = linked == GL_TRUE;
+            if (!build.linked)
+            {
+                ProgramCache::Reject(build.key);
+                build.cached = false;
+                compileAndLink(build);
+            }
+        }
+        if (!build.cached)
+        {
+            for (int stage = 0; stage < 3; stage++)
+                if (build.shaders[stage])
+                    checkCompileErrors(build.shaders[stage], SHADER_STAGE_NAMES[stage]);
+            build.linked = checkCompileErrors(build.program, "PROGRAM");
+            if (build.linked)
+                ProgramCache::Store(build.program, build.key);
+            // the shaders are linked into the program now and no longer necessary
+            for (int stage = 0; stage < 3; stage++)
+                if (build.shaders[stage])
+                    glDeleteShader(build.shaders[stage]);
+        }
+        build.finished = true;
+        for (std::string &source : build.sources)
+            std::string().swap(source);
+        double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        build.glMillis += millis;
+        finishMillis += millis;
+        ProgramCache::Record(build.name, build.cached, build.glMillis);
+    }
+
+    // whether the driver or the compile thread is done with the program, without waiting for it; parallel
+    // compile only
+    static bool completed(const ProgramBuild &build)
+    {
+        if (build.compiled.valid())
+            return build.compiled.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        GLint done = GL_FALSE;
+        glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+    // returns whether it compiled (linked)
+    static bool checkCompileErrors(GLuint shader, const std::string &type)
+    {
+        GLint success;
+        GLchar infoLog[1024];
+        if (type != "PROGRAM")
+        {
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+        else
+        {
+            glGetProgramiv(shader, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+        return success == GL_TRUE;
+    }
+
+    // the source with its includes expanded (each file once) and the defines after the #version line
+    static std::string preprocess(const std::string &code, const std::string &path, const std::string &defines)
+    {
+        std::set<std::string> included;
+        included.insert(path);
+        std::string expanded = expandIncludes(code, path, included);
+        size_t version = expanded.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : expanded.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return defines + expanded;
+        return expanded.substr(0, lineEnd + 1) + defines + expanded.substr(lineEnd + 1);
+    }
+
+    static std::string expandIncludes(const std::string &code, const std::string &path, std::set<std::string> &included)
+    {
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        std::istringstream lines(code);
+        std::string result, line;
+        while (std::getline(lines, line))
+        {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+            {
+                result += line + '\n';
+                continue;
+            }
+            size_t open = line.find('"', start);
+            size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+            std::string includePath = close == std::string::npos ? "" : directory + line.substr(open + 1, close - open - 1);
+            if (!included.insert(includePath).second)
+                continue;
+            std::ifstream file(includePath);
+            if (includePath.empty() || !file)
+            {
+                std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << line << " in " << path << std::endl;
+                continue;
+            }
+            std::stringstream stream;
+            stream << file.rdbuf();
+            result += expandIncludes(stream.str(), includePath, included);
+        }
+        return result;
+    }
+
+    // " (NAME=value, ...)" for the log, empty without defines
+    static std::string definesSummary(const std::string &defines)
+    {
+        std::istringstream lines(defines);
+        std::string summary, directive, name, value;
+        while (lines >> directive >> name >> value)
+            summary += (summary.empty() ? " (" : ", ") + name + "=" + value;
+        return summary.empty() ? summary : summary + ")";
+    }
+
+    static ShaderCompiler &instance()
+    {
+        static ShaderCompiler compiler;
+        return compiler;
+    }
+};
+#endif
@@ -0,0 +1,103 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <learnopengl/shader.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+// integer #defines a program is specialized with, kept sorted so equal sets give equal sources
+class ShaderDefines
+{
+public:
+    ShaderDefines &Set(const std::string &name, int value)
+    {
+        values[name] = value;
+        return *this;
+    }
+
+    // "#define NAME value" lines, as Shader takes them
+    std::string Text() const
+    {
+        std::string text;
+        for (const std::pair<const std::string, int> &define : values)
+            text += "#define " + define.first + " " + std::to_string(define.second) + "\n";
+        return text;
+    }
+
+    bool operator==(const ShaderDefines &other) const { return values == other.values; }
+    bool operator!=(const ShaderDefines &other) const { return values != other.values; }
+
+private:
+    std::map<std::string, int> values;
+};
+
+// One pair of shader files compiled into a program per set of defines: the shaders turn what would be
+// branches on uniforms (is the lamp on, how many lights, is there a height map) into code that is only
+// there when it is needed, and the renderer asks for the variant that fits the draw. A variant is
+// built (compiled, or loaded from the ProgramCache) the first time it is submitted or asked for and kept
+// from then on; setup runs when it is first asked for, which is when the program is waited for.
+class ShaderVariants
+{
+public:
+    // runs once on every new variant, to set what the program needs before it is drawn with (uniform
+    // block bindings, sampler units, constants)
+    typedef std::function<void(Shader &)> SetupFunction;
+
+    ShaderVariants(const std::string &vertexPath, const std::string &fragmentPath, SetupFunction setup = nullptr)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), setup(std::move(setup))
+    {
+    }
+
+    // starts building the variant without waiting for it, for variants known to be drawn with soon
+    void Submit(const ShaderDefines &defines)
+    {
+        variant(defines.Text());
+    }
+
+    Shader &Get(const ShaderDefines &defines)
+    {
+        Variant &entry = variant(defines.Text());
+        if (!entry.setUp)
+        {
+            entry.setUp = true;
+            if (setup)
+                setup(*entry.shader);
+        }
+        return *entry.shader;
+    }
+
+    // every variant set up so far, for uniforms that change at run time
+    void ForEach(const std::function<void(Shader &)> &function)
+    {
+        for (std::pair<const std::string, Variant> &entry : variants)
+            if (entry.second.setUp)
+                function(*entry.second.shader);
+    }
+
+    size_t Count() const
+    {
+        return variants.size();
+    }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    SetupFunction setup;
+    struct Variant {
+        std::unique_ptr<Shader> shader;
+        bool setUp = false;
+    };
+    std::map<std::string, Variant> variants;
+
+    Variant &variant(const std::string &text)
+    {
+        Variant &entry = variants[text];
+        if (!entry.shader)
+            entry.shader.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), nullptr, text));
+        return entry;
+    }
+};
+#endif
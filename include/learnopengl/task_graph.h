@@ -0,0 +1,303 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// the stages of loading assets, the first three in the order their tasks depend on each other
+enum TaskStage {
+    TASK_IMPORT = 0, // mesh cache or ASSIMP import and mesh processing of a model (worker)
+    TASK_DECODE = 1, // decode of an image file (worker)
+    TASK_UPLOAD = 2, // GL objects of a model or a texture (GL thread)
+    TASK_SHADER = 3, // shader sources read (worker), compiled and linked (GL thread)
+};
+const int TASK_STAGES = 4;
+
+const int NO_TASK = -1;
+
+// Dependency graph of the work done while assets load. Worker tasks (Submit) run on the shared thread
+// pool as soon as every task they depend on finished; a task may depend on the one submitting it, and
+// then starts when that one returns. GL work can't be scheduled from here, the loaders run it on the
+// GL thread when its inputs are ready and record it with Run, so the graph still knows what it waited for.
+//
+// Every task's start and end is kept; WriteTimeline dumps them as a trace for chrome://tracing or
+// Perfetto and PrintReport names the critical path: the chain, from the task that finished last, of
+// the dependencies that finished last, which is what bounds the loading time.
+class TaskGraph
+{
+public:
+    typedef int Task;
+
+    static Task Submit(const std::string &name, TaskStage stage, std::function<void()> work, const std::vector<Task> &after = {})
+    {
+        TaskGraph &graph = instance();
+        Task task;
+        bool ready;
+        {
+            std::lock_guard<std::mutex> lock(graph.mutex);
+            task = graph.add(name, stage, after);
+            Node &node = graph.nodes[task];
+            node.work = std::move(work);
+            for (Task dependency : node.after)
+            {
+                if (!graph.nodes[dependency].finished)
+                {
+                    node.waitingFor++;
+                    graph.nodes[dependency].dependents.push_back(task);
+                }
+            }
+            ready = node.waitingFor == 0;
+        }
+        if (ready)
+            graph.schedule(task);
+        return task;
+    }
+
+    // runs work right away on the calling thread, as a task that needed the ones in after
+    static Task Run(const std::string &name, TaskStage stage, const std::function<void()> &work, const std::vector<Task> &after = {})
+    {
+        TaskGraph &graph = instance();
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(graph.mutex);
+            task = graph.add(name, stage, after);
+        }
+        graph.execute(task, work);
+        return task;
+    }
+
+    // the task the calling thread is running, NO_TASK outside of one
+    static Task Current()
+    {
+        return currentTask();
+    }
+
+    static bool Finished(Task task)
+    {
+        if (task == NO_TASK)
+            return true;
+        TaskGraph &graph = instance();
+        std::lock_guard<std::mutex> lock(graph.mutex);
+        return graph.nodes[task].finished;
+    }
+
+    // blocks until the task finished
+    static void Wait(Task task)
+    {
+        if (task == NO_TASK)
+            return;
+        TaskGraph &graph = instance();
+        std::unique_lock<std::mutex> lock(graph.mutex);
+        graph.finishedTask.wait(lock, [&graph, task] { return graph.nodes[task].finished; });
+    }
+
+    // busy time per stage and the critical path of the tasks finished so far
+    static void PrintReport()
+    {
+        TaskGraph &graph = instance();
+        std::lock_guard<std::mutex> lock(graph.mutex);
+        double busy[TASK_STAGES] = {};
+        int counts[TASK_STAGES] = {};
+        for (const Node &node : graph.nodes)
+        {
+            if (!node.finished)
+                continue;
+            busy[node.stage] += node.end - node.start;
+            counts[node.stage]++;
+        }
+        std::cout << "TASKS:: " << graph.nodes.size() << " tasks on " << ThreadPool::Shared().ThreadCount() << " workers ("
+                  << ThreadPool::Shared().Steals() << " stolen) and the GL thread:";
+        for (int stage = 0; stage < TASK_STAGES; stage++)
+            std::cout << " " << counts[stage] << " " << stageName((TaskStage)stage) << " " << busy[stage] << " ms";
+        std::cout << std::endl;
+
+        std::vector<Task> path = graph.criticalPath();
+        if (path.empty())
+            return;
+        const Node &last = graph.nodes[path.back()];
+        std::cout << "TASKS:: critical path " << last.end << " ms, " << path.size() << " tasks:";
+        double previousEnd = 0.0;
+        for (Task task : path)
+        {
+            const Node &node = graph.nodes[task];
+            std::cout << "\n    " << node.name << " " << node.end - node.start << " ms";
+            if (task == path.front())
+                std::cout << " (started at " << node.start << " ms)";
+            else if (node.start - previousEnd > 0.05)
+                std::cout << " (started " << node.start - previousEnd << " ms after its input)";
+            previousEnd = node.end;
+        }
+        std::cout << std::endl;
+    }
+
+    // trace event JSON of every finished task: one row per worker and one for the GL thread, with the
+    // tasks on the critical path in their own category
+    static bool WriteTimeline(const std::string &path)
+    {
+        TaskGraph &graph = instance();
+        std::lock_guard<std::mutex> lock(graph.mutex);
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        std::vector<bool> critical(graph.nodes.size(), false);
+        for (Task task : graph.criticalPath())
+            critical[task] = true;
+
+        file << "{\"traceEvents\": [\n";
+        file << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"GL thread\"}}";
+        for (unsigned int i = 0; i < ThreadPool::Shared().ThreadCount(); i++)
+            file << ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << i + 1
+                 << ", \"args\": {\"name\": \"worker " << i << "\"}}";
+        for (unsigned int task = 0; task < graph.nodes.size(); task++)
+        {
+            const Node &node = graph.nodes[task];
+            if (!node.finished)
+                continue;
+            file << ",\n  {\"name\": \"" << escaped(node.name) << "\", \"cat\": \"" << stageName(node.stage)
+                 << (critical[task] ? ",critical" : "") << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << node.thread + 1
+                 << ", \"ts\": " << (long long)(node.start * 1000.0) << ", \"dur\": " << (long long)((node.end - node.start) * 1000.0)
+                 << ", \"args\": {\"task\": " << task << ", \"critical\": " << (critical[task] ? "true" : "false") << ", \"after\": [";
+            for (unsigned int i = 0; i < node.after.size(); i++)
+                file << (i ? ", " : "") << node.after[i];
+            file << "]}}";
+        }
+        file << "\n]}\n";
+        return (bool)file;
+    }
+
+private:
+    struct Node {
+        std::string name;
+        TaskStage stage;
+        std::vector<Task> after;
+        std::vector<Task> dependents;
+        std::function<void()> work;
+        int waitingFor = 0;
+        int thread = -1;     // worker index, -1 for any other thread
+        double start = 0.0;  // milliseconds since the graph was created
+        double end = 0.0;
+        bool finished = false;
+    };
+    // a deque keeps the nodes in place while others are added
+    std::deque<Node> nodes;
+    std::mutex mutex;
+    std::condition_variable finishedTask;
+    std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now();
+
+    Task add(const std::string &name, TaskStage stage, const std::vector<Task> &after)
+    {
+        Node node;
+        node.name = name;
+        node.stage = stage;
+        for (Task dependency : after)
+            if (dependency != NO_TASK)
+                node.after.push_back(dependency);
+        nodes.push_back(std::move(node));
+        return (Task)nodes.size() - 1;
+    }
+
+    void schedule(Task task)
+    {
+        ThreadPool::Shared().Submit([this, task] {
+            std::function<void()> work;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                work.swap(nodes[task].work);
+            }
+            execute(task, work);
+        });
+    }
+
+    void execute(Task task, const std::function<void()> &work)
+    {
+        double start = millis();
+        Task outer = currentTask();
+        currentTask() = task;
+        work();
+        currentTask() = outer;
+        double end = millis();
+
+        std::vector<Task> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Node &node = nodes[task];
+            node.thread = ThreadPool::Shared().WorkerIndex();
+            node.start = start;
+            node.end = end;
+            node.finished = true;
+            for (Task dependent : node.dependents)
+                if (--nodes[dependent].waitingFor == 0)
+                    ready.push_back(dependent);
+        }
+        finishedTask.notify_all();
+        for (Task dependent : ready)
+            schedule(dependent);
+    }
+
+    // from the task that finished last back along the dependency that finished last; call locked
+    std::vector<Task> criticalPath() const
+    {
+        Task task = NO_TASK;
+        for (unsigned int i = 0; i < nodes.size(); i++)
+            if (nodes[i].finished && (task == NO_TASK || nodes[i].end > nodes[task].end))
+                task = (Task)i;
+        std::vector<Task> path;
+        while (task != NO_TASK)
+        {
+            path.push_back(task);
+            Task gating = NO_TASK;
+            for (Task dependency : nodes[task].after)
+                if (gating == NO_TASK || nodes[dependency].end > nodes[gating].end)
+                    gating = dependency;
+            task = gating;
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    double millis() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - created).count();
+    }
+
+    static const char *stageName(TaskStage stage)
+    {
+        static const char *const names[] = {"import", "decode", "upload", "shader"};
+        return names[stage];
+    }
+
+    static std::string escaped(const std::string &text)
+    {
+        std::string result;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+
+    static Task &currentTask()
+    {
+        static thread_local Task task = NO_TASK;
+        return task;
+    }
+
+    static TaskGraph &instance()
+    {
+        static TaskGraph graph;
+        return graph;
+    }
+};
+#endif
@@ -0,0 +1,33 @@
+#ifndef TEXTURE_KIND_H
+#define TEXTURE_KIND_H
+
+#include <string>
+
+// what a texture holds. Decides its format and how its mips are filtered, the same way for the asset
+// cooker's block compressed textures and for images decoded at runtime.
+enum TextureKind {
+    TEXTURE_COLOR,  // sRGB color, filtered in linear space
+    TEXTURE_DATA,   // linear values in one channel (specular, height maps)
+    TEXTURE_NORMAL  // tangent space normals, renormalized per mip, two channels (z is rebuilt in the shader)
+};
+
+// kind of a material texture, by the sampler type names the model loader gives them (texture_diffuse, ...)
+inline TextureKind MaterialTextureKind(const std::string &type)
+{
+    if (type == "texture_diffuse")
+        return TEXTURE_COLOR;
+    if (type == "texture_normal")
+        return TEXTURE_NORMAL;
+    return TEXTURE_DATA;
+}
+
+inline const char *TextureKindName(TextureKind kind)
+{
+    switch (kind)
+    {
+    case TEXTURE_COLOR: return "color";
+    case TEXTURE_DATA: return "data";
+    default: return "normal";
+    }
+}
+#endif
@@ -0,0 +1,254 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/block_compression.h>
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/ktx.h>
+#include <learnopengl/task_graph.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct StbiDeleter {
+    void operator()(unsigned char *data) const { stbi_image_free(data); }
+};
+
+// pixels of one image as decoded by stb_image; data is null if the file could not be read.
+// When the asset cooker left an up to date <image>.ktx the GL can sample, that is used instead:
+// cooked is set, data stays null and width, height and channels describe the source image.
+// Copies share the pixels, so a streamed upload can hold on to them until they are in the GL.
+struct DecodedImage {
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::shared_ptr<unsigned char> data;
+    std::shared_ptr<KtxFile> cooked;
+};
+
+// Decodes images on the shared thread pool and hands the pixels back to the GL thread for upload.
+// Request() only queues work; every upload callback runs inside FinishPending() or Poll(), which must
+// be called on the thread that owns the GL context. Decodes and uploads are TaskGraph tasks.
+class TextureLoader
+{
+public:
+    typedef std::function<void(const DecodedImage &)> UploadFunction;
+
+    static void Request(const std::string &path, UploadFunction upload)
+    {
+        TextureLoader &loader = instance();
+        if (loader.pending.empty())
+            loader.batchStart = std::chrono::steady_clock::now();
+        Pending request;
+        request.upload = std::move(upload);
+        {
+            std::lock_guard<std::mutex> lock(loader.prefetchMutex);
+            loader.seen.insert(path);
+            auto prefetched = loader.prefetched.find(path);
+            if (prefetched != loader.prefetched.end())
+            {
+                request.decode = prefetched->second;
+                loader.prefetched.erase(prefetched);
+            }
+        }
+        if (!request.decode.image)
+            request.decode = loader.decode(path, NO_TASK);
+        loader.pending.push_back(std::move(request));
+    }
+
+    // any thread: starts decoding the image at path once the task after finished (which may be the
+    // calling one, TaskGraph::Current), ahead of its Request. The first Request of path takes the
+    // decoded image over; a path that was prefetched or requested before is ignored.
+    static void Prefetch(const std::string &path, TaskGraph::Task after)
+    {
+        TextureLoader &loader = instance();
+        std::lock_guard<std::mutex> lock(loader.prefetchMutex);
+        if (!loader.seen.insert(path).second)
+            return;
+        loader.prefetched[path] = loader.decode(path, after);
+    }
+
+    // the prefetched image at path won't be requested after all (the texture was shared)
+    static void Discard(const std::string &path)
+    {
+        TextureLoader &loader = instance();
+        std::lock_guard<std::mutex> lock(loader.prefetchMutex);
+        loader.prefetched.erase(path);
+    }
+
+    // lets Request() pick up cooked textures (see DecodedImage) in the block formats this GL can sample.
+    // call on the GL thread after GLExtensions::Load and before requesting anything; without it every
+    // image is decoded with stb_image
+    static void EnableCookedTextures()
+    {
+        TextureLoader &loader = instance();
+        // RGTC (BC4, BC5) is core since 3.0
+        loader.cookedFormats = {GL_COMPRESSED_RED_RGTC1, GL_COMPRESSED_RG_RGTC2};
+        if (GLExtensions::Has("GL_EXT_texture_compression_s3tc"))
+        {
+            loader.cookedFormats.push_back(GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+            loader.cookedFormats.push_back(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+            // sRGB S3TC isn't part of core sRGB support, it comes with EXT_texture_sRGB
+            if (GLExtensions::Has("GL_EXT_texture_sRGB") || GLExtensions::Has("GL_EXT_texture_compression_s3tc_srgb"))
+            {
+                loader.cookedFormats.push_back(GL_COMPRESSED_SRGB_S3TC_DXT1_EXT);
+                loader.cookedFormats.push_back(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT);
+            }
+        }
+        if (GLExtensions::Version(4, 2) || GLExtensions::Has("GL_ARB_texture_compression_bptc"))
+        {
+            loader.cookedFormats.push_back(GL_COMPRESSED_RGBA_BPTC_UNORM);
+            loader.cookedFormats.push_back(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM);
+        }
+    }
+
+    // waits for the outstanding decodes and uploads them in request order
+    static void FinishPending()
+    {
+        TextureLoader &loader = instance();
+        if (loader.pending.empty())
+            return;
+        for (Pending &request : loader.pending)
+            loader.finish(request);
+        loader.pending.clear();
+        loader.batchDone();
+    }
+
+    // uploads up to maxImages of the images decoded so far, in request order, without waiting for the
+    // rest, and returns how many it uploaded. For loading while frames are rendered: call every frame on
+    // the GL thread until Idle().
+    static int Poll(int maxImages = INT_MAX)
+    {
+        TextureLoader &loader = instance();
+        int ready = 0;
+        while (ready < maxImages && ready < (int)loader.pending.size() && TaskGraph::Finished(loader.pending[ready].decode.task))
+            loader.finish(loader.pending[ready++]);
+        loader.pending.erase(loader.pending.begin(), loader.pending.begin() + ready);
+        if (ready)
+            loader.batchDone();
+        return ready;
+    }
+
+    static bool Idle()
+    {
+        return instance().pending.empty();
+    }
+
+    // decode time is summed over all worker threads, so decode CPU / wall time shows how well it scales
+    static void PrintReport()
+    {
+        TextureLoader &loader = instance();
+        std::cout << "TEXTURES:: " << loader.imageCount << " images (" << loader.cookedCount << " cooked, "
+                  << loader.decodedBytes / (1024.0 * 1024.0) << " MB decoded) on "
+                  << ThreadPool::Shared().ThreadCount() << " threads: decode " << loader.decodeNanos / 1e6 << " ms CPU, upload "
+                  << loader.uploadMillis << " ms, GL thread waited " << loader.waitMillis << " ms, total " << loader.wallMillis
+                  << " ms wall" << std::endl;
+    }
+
+private:
+    // an image decoding (or decoded) in its task
+    struct Decode {
+        TaskGraph::Task task = NO_TASK;
+        std::shared_ptr<DecodedImage> image;
+    };
+    struct Pending {
+        Decode decode;
+        UploadFunction upload;
+    };
+    std::vector<Pending> pending;
+    // decodes started by Prefetch that no request took over yet, and every path prefetched or requested
+    std::mutex prefetchMutex;
+    std::unordered_map<std::string, Decode> prefetched;
+    std::unordered_set<std::string> seen;
+    std::chrono::steady_clock::time_point batchStart;
+    std::atomic<long long> decodeNanos{0};
+    std::atomic<long long> decodedBytes{0};
+    std::atomic<int> cookedCount{0};
+    // block formats EnableCookedTextures found support for; only written before any request is made
+    std::vector<GLenum> cookedFormats;
+    double uploadMillis = 0.0;
+    double waitMillis = 0.0;
+    double wallMillis = 0.0;
+    int imageCount = 0;
+
+    void finish(Pending &request)
+    {
+        auto waitStart = std::chrono::steady_clock::now();
+        TaskGraph::Wait(request.decode.task);
+        auto uploadStart = std::chrono::steady_clock::now();
+        const DecodedImage &image = *request.decode.image;
+        TaskGraph::Run("upload " + fileName(image.path), TASK_UPLOAD, [&request, &image] { request.upload(image); }, {request.decode.task});
+        auto uploadEnd = std::chrono::steady_clock::now();
+        waitMillis += std::chrono::duration<double, std::milli>(uploadStart - waitStart).count();
+        uploadMillis += std::chrono::duration<double, std::milli>(uploadEnd - uploadStart).count();
+        imageCount++;
+    }
+
+    // the batch of requests made since the loader was last idle is done
+    void batchDone()
+    {
+        if (pending.empty())
+            wallMillis += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batchStart).count();
+    }
+
+    Decode decode(const std::string &path, TaskGraph::Task after)
+    {
+        Decode result;
+        result.image = std::make_shared<DecodedImage>();
+        std::shared_ptr<DecodedImage> image = result.image;
+        result.task = TaskGraph::Submit("decode " + fileName(path), TASK_DECODE, [this, path, image] {
+            auto start = std::chrono::steady_clock::now();
+            image->path = path;
+            if (!cookedFormats.empty())
+                openCooked(*image);
+            if (image->cooked)
+                cookedCount++;
+            else
+                image->data.reset(stbi_load(path.c_str(), &image->width, &image->height, &image->channels, 0), StbiDeleter());
+            decodeNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            if (image->data)
+                decodedBytes += (long long)image->width * image->height * image->channels;
+        }, {after});
+        return result;
+    }
+
+    static std::string fileName(const std::string &path)
+    {
+        return path.substr(path.find_last_of('/') + 1);
+    }
+
+    // worker thread: attaches the image's cooked texture if it is up to date and in a supported format
+    void openCooked(DecodedImage &image) const
+    {
+        std::unique_ptr<KtxFile> texture(new KtxFile());
+        TextureCookInfo info;
+        if (!texture->Open(KtxFile::PathFor(image.path)) || !texture->IsFreshFor(image.path) || !texture->GetCookInfo(info) ||
+            std::find(cookedFormats.begin(), cookedFormats.end(), texture->InternalFormat()) == cookedFormats.end())
+            return;
+        image.width = (int)texture->Width();
+        image.height = (int)texture->Height();
+        image.channels = (int)info.channels;
+        image.cooked = std::move(texture);
+    }
+
+    static TextureLoader &instance()
+    {
+        static TextureLoader loader;
+        return loader;
+    }
+};
+#endif
@@ -0,0 +1,240 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/hash.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_storage.h>
+#include <learnopengl/texture_streamer.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide owner of the 2D textures loaded from image files. A request for a file that is already
+// registered gets the same GL texture back, whether it names the file by the same path (after resolving
+// it to a canonical one) or is a different file with byte-identical content. Textures are reference
+// counted and deleted when the last user releases them.
+//
+// How a texture is stored (its format) is part of the upload function, so requests that set textures up
+// differently pass a different variant name and never share.
+class TextureRegistry
+{
+public:
+    // uploads the decoded image into texture, which is bound to nothing yet
+    typedef std::function<void(unsigned int texture, const DecodedImage &)> UploadFunction;
+
+    // returns the texture for the image at path, requesting a decode through TextureLoader if it is new.
+    // like TextureLoader::Request, the texture gets its data in TextureLoader::FinishPending or Poll
+    static unsigned int Acquire(const std::string &path, const std::string &variant, UploadFunction upload)
+    {
+        TextureRegistry &registry = instance();
+        registry.requests++;
+        std::string key = canonicalPath(path) + '\n' + variant;
+        auto byPath = registry.byPath.find(key);
+        if (byPath != registry.byPath.end())
+        {
+            registry.pathHits++;
+            TextureLoader::Discard(path);
+            return registry.addReference(byPath->second);
+        }
+
+        // another file with the same content can only have the same size, so only those get hashed, and
+        // only those with the same hash get their bytes compared
+        FileStamp stamp;
+        bool exists = FileStamp::Get(path, stamp);
+        uint64_t hash = 0;
+        bool hashed = false;
+        for (auto it = registry.bySize.lower_bound(stamp.size); exists && it != registry.bySize.upper_bound(stamp.size); ++it)
+        {
+            Entry &other = registry.entries[it->second];
+            if (other.variant != variant)
+                continue;
+            if (!hashed)
+                hashed = HashFile(path, hash);
+            if (!other.hashed)
+                other.hashed = HashFile(other.path, other.hash);
+            if (hashed && other.hashed && hash == other.hash && sameContent(path, other.path))
+            {
+                registry.contentHits++;
+                TextureLoader::Discard(path);
+                registry.byPath[key] = it->second;
+                other.keys.push_back(key);
+                return registry.addReference(it->second);
+            }
+        }
+
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        Entry &entry = registry.entries[texture];
+        entry.path = path;
+        entry.variant = variant;
+        entry.keys.push_back(key);
+        entry.size = stamp.size;
+        entry.hash = hash;
+        entry.hashed = hashed;
+        registry.byPath[key] = texture;
+        if (exists)
+            registry.bySize.insert(std::make_pair(stamp.size, texture));
+        registry.addReference(texture);
+        TextureLoader::Request(path, [texture, upload](const DecodedImage &image) {
+            upload(texture, image);
+            // the entry may already be gone if it was released before the upload
+            TextureRegistry &registry = instance();
+            auto it = registry.entries.find(texture);
+            if (it != registry.entries.end())
+            {
+                glBindTexture(GL_TEXTURE_2D, texture);
+                it->second.bytes = TextureStorage::StoredBytes(GL_TEXTURE_2D);
+            }
+        });
+        return texture;
+    }
+
+    static void Release(unsigned int texture)
+    {
+        TextureRegistry &registry = instance();
+        auto it = registry.entries.find(texture);
+        if (it == registry.entries.end() || --it->second.references > 0)
+            return;
+        for (const std::string &key : it->second.keys)
+            registry.byPath.erase(key);
+        for (auto size = registry.bySize.lower_bound(it->second.size); size != registry.bySize.upper_bound(it->second.size); ++size)
+        {
+            if (size->second == texture)
+            {
+                registry.bySize.erase(size);
+                break;
+            }
+        }
+        registry.entries.erase(it);
+        TextureStreamer::Cancel(texture);
+        glDeleteTextures(1, &texture);
+    }
+
+    // 1x1 stand-in for a material texture a mesh doesn't have, so its sampler reads defined values
+    // instead of whatever an earlier draw left on the unit: the defaults of Blender's material (0.8 grey
+    // diffuse, 0.5 specular) and a flat normal. Created on first use, deleted by Clear.
+    static unsigned int Default(TextureKind kind)
+    {
+        TextureRegistry &registry = instance();
+        unsigned int &texture = registry.defaults[kind];
+        if (texture == 0)
+        {
+            static const unsigned char texels[3][4] = {{231, 231, 231, 255}, {128, 0, 0, 0}, {128, 128, 0, 0}};
+            static const int channels[3] = {4, 1, 2};
+            DecodedImage image;
+            image.path = std::string("default ") + TextureKindName(kind);
+            image.width = image.height = 1;
+            image.channels = channels[kind];
+            image.data = std::shared_ptr<unsigned char>(new unsigned char[4], std::default_delete<unsigned char[]>());
+            std::copy(texels[kind], texels[kind] + 4, image.data.get());
+            glGenTextures(1, &texture);
+            TextureStorage::Upload2D(texture, image, kind);
+        }
+        return texture;
+    }
+
+    // deletes every registered texture; call while the GL context is still current. Releases of
+    // textures acquired before are ignored afterwards.
+    static void Clear()
+    {
+        TextureRegistry &registry = instance();
+        for (unsigned int &texture : registry.defaults)
+        {
+            if (texture != 0)
+            {
+                TextureStreamer::Cancel(texture);
+                glDeleteTextures(1, &texture);
+                texture = 0;
+            }
+        }
+        for (const std::pair<const unsigned int, Entry> &entry : registry.entries)
+        {
+            TextureStreamer::Cancel(entry.first);
+            glDeleteTextures(1, &entry.first);
+        }
+        registry.entries.clear();
+        registry.byPath.clear();
+        registry.bySize.clear();
+    }
+
+    // how many requests were served by an existing texture and how much GPU memory that saved
+    static void PrintReport()
+    {
+        TextureRegistry &registry = instance();
+        double bytes = 0.0, savedBytes = 0.0;
+        for (const std::pair<const unsigned int, Entry> &entry : registry.entries)
+        {
+            bytes += entry.second.bytes;
+            savedBytes += (double)entry.second.bytes * (entry.second.acquired - 1);
+        }
+        std::cout << "TEXTURE REGISTRY:: " << registry.requests << " requests -> " << registry.entries.size() << " textures ("
+                  << registry.pathHits << " shared by path, " << registry.contentHits << " by content), "
+                  << bytes / (1024.0 * 1024.0) << " MB on the GPU, " << savedBytes / (1024.0 * 1024.0) << " MB saved" << std::endl;
+    }
+
+private:
+    struct Entry {
+        std::string path;             // the file the texture was decoded from
+        std::string variant;
+        std::vector<std::string> keys; // every canonical path (and variant) it is registered under
+        uint64_t size = 0;
+        uint64_t hash = 0;            // FNV-1a of the file, computed only when another file of the same size shows up
+        bool hashed = false;
+        int references = 0;
+        int acquired = 0;             // requests served over the texture's lifetime
+        size_t bytes = 0;             // GPU memory, known once uploaded
+    };
+    std::map<unsigned int, Entry> entries;
+    std::unordered_map<std::string, unsigned int> byPath;
+    std::multimap<uint64_t, unsigned int> bySize;
+    unsigned int defaults[3] = {}; // by TextureKind
+    int requests = 0;
+    int pathHits = 0;
+    int contentHits = 0;
+
+    unsigned int addReference(unsigned int texture)
+    {
+        Entry &entry = entries[texture];
+        entry.references++;
+        entry.acquired++;
+        return texture;
+    }
+
+    // whether the two files hold the same bytes; false if either can't be read
+    static bool sameContent(const std::string &path, const std::string &otherPath)
+    {
+        MappedFile file, other;
+        if (!file.Open(path) || !other.Open(otherPath))
+            return false;
+        return file.Size() == other.Size() && memcmp(file.Data(), other.Data(), file.Size()) == 0;
+    }
+
+    // resolves ./, ../ and symlinks; a path that doesn't exist is taken as it is
+    static std::string canonicalPath(const std::string &path)
+    {
+        char *resolved = realpath(path.c_str(), nullptr);
+        if (!resolved)
+            return path;
+        std::string canonical = resolved;
+        free(resolved);
+        return canonical;
+    }
+
+    static TextureRegistry &instance()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+};
+#endif
@@ -0,0 +1,244 @@
+#ifndef TEXTURE_STORAGE_H
+#define TEXTURE_STORAGE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/ktx.h>
+#include <learnopengl/texture_kind.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_streamer.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+// Gives textures their storage and data, in a sized format that depends on what the texture holds:
+//   color:  GL_SRGB8_ALPHA8, read back as linear values, so the shaders light in linear space
+//   normal: GL_RG8, the shaders rebuild z
+//   data:   GL_R8, swizzled to (r, r, r, 1) so shaders that read .rgb still get the gray value
+// Decoded images with fewer channels are expanded the same way; cooked textures keep their block
+// format (sRGB BC7/BC1/BC3 color, BC5 normals, BC4 data). Where the GL has glTexStorage2D (4.2 or
+// ARB_texture_storage) the storage is immutable, otherwise the same formats are allocated level by level.
+// The data follows through TextureStreamer, which may spread it over frames.
+// Filtering and wrapping are not set here, they come from the shared samplers (SamplerCache).
+class TextureStorage
+{
+public:
+    static GLenum SizedFormat(TextureKind kind)
+    {
+        switch (kind)
+        {
+        case TEXTURE_COLOR: return GL_SRGB8_ALPHA8;
+        case TEXTURE_NORMAL: return GL_RG8;
+        default: return GL_R8;
+        }
+    }
+
+    // levels of a full mip chain down to 1x1
+    static GLsizei MipLevels(int width, int height)
+    {
+        GLsizei levels = 1;
+        for (int size = std::max(width, height); size > 1; size /= 2)
+            levels++;
+        return levels;
+    }
+
+    // texture as a GL_TEXTURE_2D with a full mip chain (generated for decoded images). The storage is
+    // allocated here, the data goes through TextureStreamer, so it may arrive over the next frames.
+    static void Upload2D(unsigned int texture, const DecodedImage &image, TextureKind kind)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        if (image.cooked)
+        {
+            allocateCooked(GL_TEXTURE_2D, GL_TEXTURE_2D, *image.cooked);
+            streamCooked(texture, GL_TEXTURE_2D, GL_TEXTURE_2D, image);
+        }
+        else
+        {
+            GLenum format = SizedFormat(kind);
+            GLsizei levels = MipLevels(image.width, image.height);
+            if (GLExtensions::HasTextureStorage())
+                GLExtensions::TexStorage2D(GL_TEXTURE_2D, levels, format, image.width, image.height);
+            else
+            {
+                for (GLsizei level = 0; level < levels; level++)
+                    glTexImage2D(GL_TEXTURE_2D, level, format, std::max(image.width >> level, 1), std::max(image.height >> level, 1),
+                                 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+            }
+            streamPixels(texture, GL_TEXTURE_2D, GL_TEXTURE_2D, image, true);
+        }
+        setSwizzle(GL_TEXTURE_2D, kind, image);
+        instance().account(kind, StoredBytes(GL_TEXTURE_2D));
+    }
+
+    // one face of texture as a GL_TEXTURE_CUBE_MAP, with the mips a cooked face has. Faces arrive one at
+    // a time, so the first one allocates the storage of all six.
+    static void UploadCubemapFace(unsigned int texture, unsigned int face, const DecodedImage &image, TextureKind kind)
+    {
+        GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+        GLenum format = image.cooked ? image.cooked->InternalFormat() : SizedFormat(kind);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        if (GLExtensions::HasTextureStorage())
+        {
+            GLint width = 0, height = 0, allocatedFormat = 0;
+            glGetTexLevelParameteriv(target, 0, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(target, 0, GL_TEXTURE_HEIGHT, &height);
+            glGetTexLevelParameteriv(target, 0, GL_TEXTURE_INTERNAL_FORMAT, &allocatedFormat);
+            if (width != 0 && (width != image.width || height != image.height || (GLenum)allocatedFormat != format))
+            {
+                std::cout << "Cubemap face " << image.path << " doesn't match the size or format of the other faces" << std::endl;
+                return;
+            }
+            if (width == 0 && !image.cooked)
+                GLExtensions::TexStorage2D(GL_TEXTURE_CUBE_MAP, 1, format, image.width, image.height);
+        }
+        if (image.cooked)
+        {
+            allocateCooked(GL_TEXTURE_CUBE_MAP, target, *image.cooked);
+            streamCooked(texture, GL_TEXTURE_CUBE_MAP, target, image);
+        }
+        else
+        {
+            if (!GLExtensions::HasTextureStorage())
+                glTexImage2D(target, 0, format, image.width, image.height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+            streamPixels(texture, GL_TEXTURE_CUBE_MAP, target, image, false);
+        }
+        setSwizzle(GL_TEXTURE_CUBE_MAP, kind, image);
+        instance().account(kind, StoredBytes(target));
+    }
+
+    // memory of a 2D texture or one cubemap face with all its levels, as the GL reports the levels
+    // (compressed image size, or the bits of every component per texel)
+    static size_t StoredBytes(GLenum target)
+    {
+        size_t bytes = 0;
+        for (GLint level = 0; level < 16; level++)
+        {
+            GLint width = 0, height = 0, compressed = 0;
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+            if (width == 0)
+                break;
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &compressed);
+            if (compressed)
+            {
+                GLint size = 0;
+                glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+                bytes += size;
+                continue;
+            }
+            GLint bits = 0;
+            const GLenum components[] = {GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE};
+            for (GLenum component : components)
+            {
+                GLint componentBits = 0;
+                glGetTexLevelParameteriv(target, level, component, &componentBits);
+                bits += componentBits;
+            }
+            bytes += (size_t)width * height * bits / 8;
+        }
+        return bytes;
+    }
+
+    // memory of everything uploaded through here, by kind of texture
+    static void PrintReport()
+    {
+        TextureStorage &storage = instance();
+        double total = storage.bytes[TEXTURE_COLOR] + storage.bytes[TEXTURE_NORMAL] + storage.bytes[TEXTURE_DATA];
+        std::cout << "TEXTURE STORAGE:: " << storage.uploads << " images, " << total / (1024.0 * 1024.0) << " MB ("
+                  << (GLExtensions::HasTextureStorage() ? "immutable" : "mutable") << "): color "
+                  << storage.bytes[TEXTURE_COLOR] / (1024.0 * 1024.0) << " MB, normal "
+                  << storage.bytes[TEXTURE_NORMAL] / (1024.0 * 1024.0) << " MB, data "
+                  << storage.bytes[TEXTURE_DATA] / (1024.0 * 1024.0) << " MB" << std::endl;
+    }
+
+private:
+    double bytes[3] = {};
+    int uploads = 0;
+
+    void account(TextureKind kind, size_t size)
+    {
+        bytes[kind] += size;
+        uploads++;
+    }
+
+    // storage for the levels of a cooked image: immutable for all of bindTarget (unless a cubemap face
+    // before allocated it), or level by level for imageTarget
+    static void allocateCooked(GLenum bindTarget, GLenum imageTarget, const KtxFile &texture)
+    {
+        const std::vector<KtxLevel> &levels = texture.Levels();
+        if (GLExtensions::HasTextureStorage())
+        {
+            GLint width = 0;
+            glGetTexLevelParameteriv(imageTarget, 0, GL_TEXTURE_WIDTH, &width);
+            if (width == 0)
+                GLExtensions::TexStorage2D(bindTarget, (GLsizei)levels.size(), texture.InternalFormat(), texture.Width(), texture.Height());
+            return;
+        }
+        glTexParameteri(bindTarget, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+        for (size_t level = 0; level < levels.size(); level++)
+            glCompressedTexImage2D(imageTarget, (GLint)level, texture.InternalFormat(), levels[level].width, levels[level].height, 0,
+                                   levels[level].size, nullptr);
+    }
+
+    // every level of a cooked image, in rows of 4x4 blocks
+    static void streamCooked(unsigned int texture, GLenum bindTarget, GLenum imageTarget, const DecodedImage &image)
+    {
+        const std::vector<KtxLevel> &levels = image.cooked->Levels();
+        for (size_t level = 0; level < levels.size(); level++)
+        {
+            const KtxLevel &mip = levels[level];
+            TextureUpload upload;
+            upload.texture = texture;
+            upload.bindTarget = bindTarget;
+            upload.imageTarget = imageTarget;
+            upload.level = (GLint)level;
+            upload.width = mip.width;
+            upload.height = mip.height;
+            upload.format = image.cooked->InternalFormat();
+            upload.compressed = true;
+            upload.rowBytes = mip.size / upload.Rows();
+            upload.data = (const unsigned char *)mip.data;
+            upload.owner = image.cooked;
+            TextureStreamer::Upload(upload);
+        }
+    }
+
+    // level 0 from the decoded pixels. The GL converts them to the storage format, dropping the channels
+    // it doesn't have (blue of a normal map, green and blue of a gray map stored as rgb).
+    static void streamPixels(unsigned int texture, GLenum bindTarget, GLenum imageTarget, const DecodedImage &image, bool generateMipmap)
+    {
+        const GLenum layouts[] = {GL_RED, GL_RED, GL_RG, GL_RGB, GL_RGBA};
+        int channels = std::min(std::max(image.channels, 1), 4);
+        TextureUpload upload;
+        upload.texture = texture;
+        upload.bindTarget = bindTarget;
+        upload.imageTarget = imageTarget;
+        upload.width = image.width;
+        upload.height = image.height;
+        upload.format = layouts[channels];
+        upload.rowBytes = (size_t)image.width * channels;
+        upload.data = image.data.get();
+        upload.owner = image.data;
+        upload.generateMipmap = generateMipmap;
+        TextureStreamer::Upload(upload);
+    }
+
+    // single channel data shows its value in rgb, and so does gray color (gray and alpha for two channels)
+    static void setSwizzle(GLenum target, TextureKind kind, const DecodedImage &image)
+    {
+        bool grayColor = kind == TEXTURE_COLOR && !image.cooked && image.channels < 3;
+        if (kind != TEXTURE_DATA && !grayColor)
+            return;
+        const GLint swizzle[] = {GL_RED, GL_RED, GL_RED, grayColor && image.channels == 2 ? GL_GREEN : GL_ONE};
+        glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    static TextureStorage &instance()
+    {
+        static TextureStorage storage;
+        return storage;
+    }
+};
+#endif
@@ -0,0 +1,474 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <memory>
+
+// Ring of pixel unpack buffer memory that texture data is staged in on its way into the GL. Where the GL
+// has buffer storage (4.4 or ARB_buffer_storage) the buffer stays mapped, persistently and coherently, so
+// worker threads can write into it, and a fence per allocation tells when the GL is done reading it.
+// Otherwise the buffer is orphaned every time it wraps (the driver hands out fresh memory while the old
+// one is still being read) and an allocation is mapped on the GL thread only while it is written.
+class UploadRing
+{
+public:
+    bool Create(size_t bytes)
+    {
+        Destroy();
+        capacity = bytes;
+        persistent = GLExtensions::HasBufferStorage();
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        if (persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            GLExtensions::BufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)capacity, nullptr, flags);
+            mapping = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)capacity, flags);
+        }
+        else
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)capacity, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (persistent && !mapping)
+        {
+            Destroy();
+            return false;
+        }
+        return true;
+    }
+
+    void Destroy()
+    {
+        for (Region &region : regions)
+        {
+            if (region.fence)
+                glDeleteSync(region.fence);
+        }
+        regions.clear();
+        if (mapping)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            mapping = nullptr;
+        }
+        if (buffer)
+            glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        head = 0;
+    }
+
+    bool Persistent() const { return persistent; }
+    unsigned int Buffer() const { return buffer; }
+    size_t Capacity() const { return capacity; }
+
+    // reserves bytes of the ring. Fails while the GL still reads the space (only with a persistent ring,
+    // the other kind is orphaned instead) or if more is asked for than the ring holds.
+    bool Allocate(size_t bytes, size_t &offset)
+    {
+        if (bytes == 0 || bytes > capacity)
+            return false;
+        if (!persistent)
+        {
+            if (head + bytes > capacity)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)capacity, nullptr, GL_STREAM_DRAW);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                head = 0;
+            }
+            offset = head;
+            head += bytes;
+            return true;
+        }
+
+        if (regions.empty())
+            head = 0;
+        // the space in use runs from the oldest region to head, possibly around the end of the ring
+        size_t tail = regions.empty() ? 0 : regions.front().begin;
+        bool wrapped = !regions.empty() && head <= tail;
+        if (!wrapped && capacity - head >= bytes)
+            offset = head;
+        else if (!wrapped && tail >= bytes)
+            offset = 0;
+        else if (wrapped && tail - head >= bytes)
+            offset = head;
+        else
+            return false;
+        head = offset + bytes;
+        Region region;
+        region.begin = offset;
+        regions.push_back(region);
+        return true;
+    }
+
+    // where to write an allocation. A persistent ring can be written from any thread; otherwise call on
+    // the GL thread and Unmap() before the GL uses the buffer.
+    unsigned char *Map(size_t offset, size_t bytes)
+    {
+        if (persistent)
+            return mapping + offset;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        // nothing issued so far reads this range of the current buffer, no need to synchronize
+        void *range = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, (GLintptr)offset, (GLsizeiptr)bytes,
+                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return (unsigned char *)range;
+    }
+
+    void Unmap()
+    {
+        if (persistent)
+            return;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // the allocation at offset is read by the GL commands issued so far; it is freed once they completed
+    void Fence(size_t offset)
+    {
+        for (auto region = regions.rbegin(); region != regions.rend(); ++region)
+        {
+            if (region->begin == offset && !region->fence)
+            {
+                region->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                return;
+            }
+        }
+    }
+
+    // frees the allocations the GL finished reading, oldest first; with wait, blocks for the oldest one
+    void Retire(bool wait)
+    {
+        while (!regions.empty() && regions.front().fence)
+        {
+            GLenum status = glClientWaitSync(regions.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000 : 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                return;
+            glDeleteSync(regions.front().fence);
+            regions.pop_front();
+            wait = false;
+        }
+    }
+
+private:
+    struct Region {
+        size_t begin = 0;
+        GLsync fence = 0; // set once the commands reading the region are issued
+    };
+    unsigned int buffer = 0;
+    unsigned char *mapping = nullptr;
+    size_t capacity = 0;
+    size_t head = 0;
+    bool persistent = false;
+    std::deque<Region> regions;
+};
+
+// rows of one level of a texture image; a row is a row of pixels, or of 4x4 blocks for compressed data
+struct TextureUpload {
+    unsigned int texture = 0;
+    GLenum bindTarget = GL_TEXTURE_2D;  // GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+    GLenum imageTarget = GL_TEXTURE_2D; // GL_TEXTURE_2D or a cubemap face
+    GLint level = 0;
+    int width = 0;
+    int height = 0;
+    GLenum format = 0;                  // pixel layout (GL_RED ... GL_RGBA), or the internal format of compressed data
+    bool compressed = false;
+    size_t rowBytes = 0;
+    const unsigned char *data = nullptr;
+    std::shared_ptr<const void> owner;  // keeps data alive until it is in the GL
+    bool generateMipmap = false;        // once all rows are in
+
+    int Rows() const { return compressed ? (height + 3) / 4 : height; }
+};
+
+// Moves texture data into the GL through an UploadRing, spread over frames by a byte budget so that
+// textures streaming in never make a frame spike. Uploads are cut into slices of rows. Every frame
+// Update() first submits the slices copied into the ring since the last frame (glTexSubImage2D from the
+// buffer, then a fence), then starts copying the next slices, as many as the budget allows: on worker
+// threads into a persistent ring, on the GL thread (and submitted right away) into an orphaned one.
+// Until Enable() is called every upload goes straight from client memory, all at once.
+class TextureStreamer
+{
+public:
+    static bool Enable(size_t ringBytes)
+    {
+        TextureStreamer &streamer = instance();
+        streamer.enabled = streamer.ring.Create(ringBytes);
+        return streamer.enabled;
+    }
+
+    // finishes what is queued and deletes the ring; call while the GL context is still current
+    static void Disable()
+    {
+        TextureStreamer &streamer = instance();
+        if (!streamer.enabled)
+            return;
+        Flush();
+        streamer.ring.Destroy();
+        streamer.enabled = false;
+    }
+
+    static bool Enabled() { return instance().enabled; }
+    static bool Idle() { return instance().queue.empty() && instance().inFlight.empty(); }
+
+    // bytes queued and not staged in the ring yet
+    static size_t QueuedBytes()
+    {
+        size_t bytes = 0;
+        for (const std::shared_ptr<Job> &job : instance().queue)
+        {
+            if (!job->cancelled)
+                bytes += (size_t)(job->upload.Rows() - job->nextRow) * job->upload.rowBytes;
+        }
+        return bytes;
+    }
+
+    // queues the upload, or does it right away if streaming isn't enabled
+    static void Upload(const TextureUpload &upload)
+    {
+        TextureStreamer &streamer = instance();
+        if (upload.Rows() == 0)
+            return;
+        // a row that doesn't fit the ring can't be staged in it
+        if (!streamer.enabled || upload.rowBytes > streamer.ring.Capacity())
+        {
+            streamer.uploadRows(upload, 0, upload.Rows(), upload.data);
+            if (upload.generateMipmap)
+                glGenerateMipmap(upload.bindTarget);
+            return;
+        }
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        job->upload = upload;
+        streamer.queue.push_back(job);
+    }
+
+    // drops what is left to upload into texture, before it is deleted
+    static void Cancel(unsigned int texture)
+    {
+        TextureStreamer &streamer = instance();
+        for (const std::shared_ptr<Job> &job : streamer.queue)
+            job->cancelled = job->cancelled || job->upload.texture == texture;
+        for (const Slice &slice : streamer.inFlight)
+            slice.job->cancelled = slice.job->cancelled || slice.job->upload.texture == texture;
+    }
+
+    // once per frame on the GL thread: at most budget bytes are submitted per frame
+    static void Update(size_t budget)
+    {
+        TextureStreamer &streamer = instance();
+        if (!streamer.enabled || Idle())
+            return;
+        auto start = std::chrono::steady_clock::now();
+        streamer.ring.Retire(false);
+        size_t submitted = streamer.submitCopied(false);
+        streamer.startCopies(budget);
+        submitted += streamer.frameSubmitted;
+        streamer.frameSubmitted = 0;
+        double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        streamer.frames++;
+        streamer.maxFrameBytes = std::max(streamer.maxFrameBytes, submitted);
+        streamer.maxFrameMillis = std::max(streamer.maxFrameMillis, millis);
+        streamer.totalMillis += millis;
+    }
+
+    // uploads everything queued now, ignoring the budget
+    static void Flush()
+    {
+        TextureStreamer &streamer = instance();
+        while (streamer.enabled && !Idle())
+        {
+            streamer.ring.Retire(false);
+            streamer.submitCopied(true);
+            streamer.startCopies(SIZE_MAX);
+            // the ring is full of slices the GL is still reading
+            if (!streamer.queue.empty() && streamer.inFlight.empty())
+                streamer.ring.Retire(true);
+        }
+        streamer.frameSubmitted = 0;
+    }
+
+    static void PrintReport()
+    {
+        TextureStreamer &streamer = instance();
+        if (!streamer.frames)
+            return;
+        std::cout << "TEXTURE STREAMING:: " << streamer.totalBytes / (1024.0 * 1024.0) << " MB in " << streamer.slices
+                  << " slices over " << streamer.frames << " frames through a " << streamer.ring.Capacity() / (1024.0 * 1024.0)
+                  << " MB " << (streamer.ring.Persistent() ? "persistent" : "orphaned") << " ring: at most "
+                  << streamer.maxFrameBytes / (1024.0 * 1024.0) << " MB and " << streamer.maxFrameMillis
+                  << " ms per frame, " << streamer.totalMillis << " ms in total" << std::endl;
+    }
+
+private:
+    struct Job {
+        TextureUpload upload;
+        int nextRow = 0; // first row not copied into the ring yet
+        bool cancelled = false;
+    };
+    // rows of a job staged in the ring
+    struct Slice {
+        std::shared_ptr<Job> job;
+        int firstRow;
+        int rowCount;
+        size_t offset;
+        size_t bytes;
+        std::future<void> copy; // the worker's copy into a persistent ring
+    };
+
+    UploadRing ring;
+    bool enabled = false;
+    std::deque<std::shared_ptr<Job>> queue;
+    std::deque<Slice> inFlight;
+    size_t inFlightBytes = 0;
+    size_t frameSubmitted = 0;
+    // totals over the run
+    double totalBytes = 0.0;
+    size_t maxFrameBytes = 0;
+    double maxFrameMillis = 0.0;
+    double totalMillis = 0.0;
+    int frames = 0;
+    int slices = 0;
+
+    // submits the slices whose copy finished, in order; with wait, waits for every copy
+    size_t submitCopied(bool wait)
+    {
+        size_t submitted = 0;
+        while (!inFlight.empty())
+        {
+            Slice &slice = inFlight.front();
+            if (!wait && slice.copy.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                break;
+            slice.copy.get();
+            submitted += submit(slice);
+            inFlightBytes -= slice.bytes;
+            inFlight.pop_front();
+        }
+        return submitted;
+    }
+
+    // stages the next slices until what is in flight this frame reaches the budget or the ring is full
+    void startCopies(size_t budget)
+    {
+        while (!queue.empty())
+        {
+            Job &job = *queue.front();
+            const TextureUpload &upload = job.upload;
+            if (job.cancelled || job.nextRow == upload.Rows())
+            {
+                queue.pop_front();
+                continue;
+            }
+            // in flight: copying into a persistent ring, or already submitted this frame from an orphaned one
+            size_t used = inFlightBytes + frameSubmitted;
+            size_t room = budget > used ? budget - used : 0;
+            size_t maxBytes = std::min(room, ring.Capacity() / 2);
+            int rows = (int)std::min<size_t>(upload.Rows() - job.nextRow, maxBytes / upload.rowBytes);
+            // a row larger than the budget still goes through alone, or the texture would never arrive
+            if (rows == 0 && used == 0)
+                rows = 1;
+            size_t offset;
+            if (rows == 0 || !ring.Allocate(rows * upload.rowBytes, offset))
+                return;
+
+            Slice slice;
+            slice.job = queue.front();
+            slice.firstRow = job.nextRow;
+            slice.rowCount = rows;
+            slice.offset = offset;
+            slice.bytes = rows * upload.rowBytes;
+            const unsigned char *source = upload.data + (size_t)job.nextRow * upload.rowBytes;
+            job.nextRow += rows;
+            if (ring.Persistent())
+            {
+                unsigned char *destination = ring.Map(offset, slice.bytes);
+                size_t bytes = slice.bytes;
+                std::shared_ptr<const void> owner = upload.owner;
+                slice.copy = ThreadPool::Shared().Submit([destination, source, bytes, owner] {
+                    memcpy(destination, source, bytes);
+                });
+                inFlightBytes += slice.bytes;
+                inFlight.push_back(std::move(slice));
+            }
+            else
+            {
+                unsigned char *destination = ring.Map(offset, slice.bytes);
+                if (destination)
+                {
+                    memcpy(destination, source, slice.bytes);
+                    ring.Unmap();
+                    // submitted right away: the next orphaning would take the data with it
+                    frameSubmitted += submit(slice);
+                }
+                else
+                {
+                    // the rows are already taken off the job, so they go from client memory instead of getting lost
+                    std::cout << "ERROR::TEXTURE_STREAMING:: could not map the upload ring, uploading " << rows
+                              << " rows from client memory" << std::endl;
+                    frameSubmitted += submit(slice, source);
+                }
+            }
+        }
+    }
+
+    // issues the upload of a staged slice from the ring, or from clientData when the ring couldn't take
+    // it, and fences its space
+    size_t submit(const Slice &slice, const unsigned char *clientData = nullptr)
+    {
+        Job &job = *slice.job;
+        if (!job.cancelled)
+        {
+            if (clientData)
+                uploadRows(job.upload, slice.firstRow, slice.rowCount, clientData);
+            else
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.Buffer());
+                uploadRows(job.upload, slice.firstRow, slice.rowCount, (const unsigned char *)(uintptr_t)slice.offset);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+            if (job.upload.generateMipmap && slice.firstRow + slice.rowCount == job.upload.Rows())
+                glGenerateMipmap(job.upload.bindTarget);
+            totalBytes += slice.bytes;
+            slices++;
+        }
+        if (ring.Persistent())
+            ring.Fence(slice.offset);
+        return job.cancelled ? 0 : slice.bytes;
+    }
+
+    // glTexSubImage2D of rows [first, first + count) from data: client memory, or an offset into the bound unpack buffer
+    void uploadRows(const TextureUpload &upload, int first, int count, const unsigned char *data)
+    {
+        glBindTexture(upload.bindTarget, upload.texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows of 1 and 3 channel images aren't 4 byte aligned
+        if (upload.compressed)
+        {
+            int y = first * 4;
+            int height = std::min(count * 4, upload.height - y);
+            glCompressedTexSubImage2D(upload.imageTarget, upload.level, 0, y, upload.width, height, upload.format,
+                                      (GLsizei)(count * upload.rowBytes), data);
+        }
+        else
+            glTexSubImage2D(upload.imageTarget, upload.level, 0, first, upload.width, count, upload.format, GL_UNSIGNED_BYTE, data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    static TextureStreamer &instance()
+    {
+        static TextureStreamer streamer;
+        return streamer;
+    }
+};
+#endif
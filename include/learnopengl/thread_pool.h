@@ -0,0 +1,156 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own job deque. Used for CPU-only work (image decoding,
+// mesh processing); nothing submitted here may touch OpenGL.
+//
+// A job submitted by a worker goes to the back of that worker's deque and the worker takes its newest
+// job first, so work a job spawns (the decodes of the textures an import found) runs next on the thread
+// whose caches still hold its input. Jobs from other threads are dealt round robin. A worker whose deque
+// is empty steals the oldest job of another one before going to sleep.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount)
+    {
+        threadCount = std::max(1u, threadCount);
+        for (unsigned int i = 0; i < threadCount; i++)
+            queues.emplace_back(new WorkerQueue());
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    // process-wide pool with one worker per hardware thread
+    static ThreadPool &Shared()
+    {
+        static ThreadPool pool(std::thread::hardware_concurrency());
+        return pool;
+    }
+
+    unsigned int ThreadCount() const { return (unsigned int)workers.size(); }
+
+    // index of the calling thread among this pool's workers, -1 for any other thread
+    int WorkerIndex() const
+    {
+        const CurrentWorker &current = currentWorker();
+        return current.pool == this ? current.index : -1;
+    }
+
+    // jobs taken from another worker's deque so far
+    unsigned long long Steals() const { return steals; }
+
+    template <typename F>
+    auto Submit(F job) -> std::future<decltype(job())>
+    {
+        typedef decltype(job()) Result;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+        std::future<Result> result = task->get_future();
+        int worker = WorkerIndex();
+        WorkerQueue &queue = *queues[worker >= 0 ? (unsigned int)worker : nextQueue++ % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back([task] { (*task)(); });
+        }
+        {
+            // counted under the sleep mutex so a worker deciding to sleep can't miss it
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued++;
+        }
+        wakeUp.notify_one();
+        return result;
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+    struct CurrentWorker {
+        const ThreadPool *pool = nullptr;
+        int index = -1;
+    };
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    // jobs in the deques. Signed: a worker can take a job (and count it off) before Submit has counted
+    // it, and the transient -1 must not read as pending work
+    std::atomic<int> queued{0};
+    std::atomic<unsigned int> nextQueue{0};
+    std::atomic<unsigned long long> steals{0};
+    bool stopping = false;
+
+    static CurrentWorker &currentWorker()
+    {
+        static thread_local CurrentWorker current;
+        return current;
+    }
+
+    void workerLoop(unsigned int index)
+    {
+        currentWorker().pool = this;
+        currentWorker().index = (int)index;
+        for (;;)
+        {
+            std::function<void()> job;
+            if (take(index, job))
+            {
+                job();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued <= 0)
+                return;
+        }
+    }
+
+    // the newest job of the worker's own deque, else the oldest of the next deque that has one
+    bool take(unsigned int index, std::function<void()> &job)
+    {
+        for (unsigned int i = 0; i < queues.size(); i++)
+        {
+            WorkerQueue &queue = *queues[(index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty())
+                continue;
+            if (i == 0)
+            {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+            }
+            else
+            {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+                steals++;
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+};
+#endif
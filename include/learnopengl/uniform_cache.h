@@ -0,0 +1,126 @@
+#ifndef UNIFORM_CACHE_H
+#define UNIFORM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// counters for the driver calls the uniform cache saves, reset by the application once per frame
+struct UniformStats {
+    unsigned long long cacheHits = 0;      // names resolved from the cache instead of glGetUniformLocation
+    unsigned long long cacheMisses = 0;    // names that are not an active uniform of the program
+    unsigned long long uploads = 0;        // glUniform* calls actually issued
+    unsigned long long skippedUploads = 0; // values that were already set on the program
+
+    static UniformStats &Get()
+    {
+        static UniformStats stats;
+        return stats;
+    }
+};
+
+// Locations of a program's active uniforms, reflected once after linking, plus a shadow copy
+// of the last value uploaded to each of them so that unchanged values are never re-uploaded.
+class UniformCache
+{
+public:
+    void Reflect(GLuint program)
+    {
+        slots.clear();
+        names.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> buffer(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(program, i, (GLsizei)buffer.size(), nullptr, &size, &type, buffer.data());
+            std::string name(buffer.data());
+            GLint location = glGetUniformLocation(program, name.c_str());
+            if (location == -1)
+                continue; // member of a uniform block
+            addSlot(name, location);
+            // arrays of basic types are reported once as "name[0]", register every element and the bare name
+            size_t bracket = name.rfind("[0]");
+            if (size > 1 && bracket != std::string::npos && bracket + 3 == name.size())
+            {
+                std::string base = name.substr(0, bracket);
+                addSlot(base, location);
+                for (GLint element = 1; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    addSlot(elementName, glGetUniformLocation(program, elementName.c_str()));
+                }
+            }
+        }
+    }
+
+    // index of the named uniform, -1 if the program has no such active uniform
+    int Find(const std::string &name) const
+    {
+        auto it = names.find(name);
+        if (it == names.end())
+        {
+            UniformStats::Get().cacheMisses++;
+            return -1;
+        }
+        UniformStats::Get().cacheHits++;
+        return it->second;
+    }
+
+    // returns the location to upload the value to, or -1 when the uniform doesn't exist
+    // or already holds exactly this value
+    GLint Update(int slot, const void *value, size_t size)
+    {
+        if (slot < 0)
+            return -1;
+        Slot &s = slots[slot];
+        if (s.valid && memcmp(s.value, value, size) == 0)
+        {
+            UniformStats::Get().skippedUploads++;
+            return -1;
+        }
+        memcpy(s.value, value, size);
+        s.valid = true;
+        UniformStats::Get().uploads++;
+        return s.location;
+    }
+
+    GLint Update(const std::string &name, const void *value, size_t size)
+    {
+        return Update(Find(name), value, size);
+    }
+
+private:
+    struct Slot {
+        GLint location;
+        bool valid;
+        unsigned char value[sizeof(float) * 16]; // large enough for a mat4
+    };
+    std::vector<Slot> slots;
+    std::unordered_map<std::string, int> names;
+
+    void addSlot(const std::string &name, GLint location)
+    {
+        // aliases ("name" and "name[0]") share the slot of the same location
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            if (slots[i].location == location)
+            {
+                names[name] = (int)i;
+                return;
+            }
+        }
+        Slot slot;
+        slot.location = location;
+        slot.valid = false;
+        names[name] = (int)slots.size();
+        slots.push_back(slot);
+    }
+};
+#endif
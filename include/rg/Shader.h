@@ -13,8 +13,11 @@
 #include <rg/Error.h>
 #include <common.h>
 #include <glm/glm.hpp>
+#include <learnopengl/uniform_cache.h>
 class Shader {
     unsigned int m_Id;
+    // active uniform locations and the values last uploaded to them
+    mutable UniformCache m_Uniforms;
 public:
     Shader(std::string vertexShaderPath, std::string fragmentShaderPath) {
         appendShaderFolderIfNotPresent(vertexShaderPath);
@@ -65,6 +68,7 @@ public:
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
         m_Id = shaderProgram;
+        m_Uniforms.Reflect(m_Id);
     }
 
     // activate the shader
@@ -77,63 +81,92 @@ public:
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(m_Id, name.c_str()), (int)value);
+        int intValue = (int)value;
+        GLint location = m_Uniforms.Update(name, &intValue, sizeof(intValue));
+        if (location != -1)
+            glUniform1i(location, intValue);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(m_Id, name.c_str()), value);
+        GLint location = m_Uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform1i(location, value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(m_Id, name.c_str()), value);
+        GLint location = m_Uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform1f(location, value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(m_Id, name.c_str()), 1, &value[0]);
+        GLint location = m_Uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform2fv(location, 1, &value[0]);
     }
     void setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(m_Id, name.c_str()), x, y);
+        glm::vec2 value(x, y);
+        GLint location = m_Uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform2fv(location, 1, &value[0]);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(m_Id, name.c_str()), 1, &value[0]);
+        GLint location = m_Uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform3fv(location, 1, &value[0]);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(m_Id, name.c_str()), x, y, z);
+        glm::vec3 value(x, y, z);
+        GLint location = m_Uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform3fv(location, 1, &value[0]);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(m_Id, name.c_str()), 1, &value[0]);
+        GLint location = m_Uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform4fv(location, 1, &value[0]);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(m_Id, name.c_str()), x, y, z, w);
+        glm::vec4 value(x, y, z, w);
+        GLint location = m_Uniforms.Update(name, &value, sizeof(value));
+        if (location != -1)
+            glUniform4fv(location, 1, &value[0]);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(m_Id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLint location = m_Uniforms.Update(name, &mat, sizeof(mat));
+        if (location != -1)
+            glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(m_Id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLint location = m_Uniforms.Update(name, &mat, sizeof(mat));
+        if (location != -1)
+            glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(m_Id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLint location = m_Uniforms.Update(name, &mat, sizeof(mat));
+        if (location != -1)
+            glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
     }
     void deleteProgram() {
         glDeleteProgram(m_Id);
         m_Id = 0;
+        m_Uniforms = UniformCache();
     }
 
 
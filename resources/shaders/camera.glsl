@@ -0,0 +1,6 @@
+// The camera shared by all programs, filled once per frame (see FrameUniforms)
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
@@ -0,0 +1,55 @@
+#version 330 core
+
+// lit per pixel from the G-buffer (gbuffer.glsl) with the lights its surface takes; the point lights
+// light the room from the side its normals face away from
+float pointLightDiffuseSide;
+#define POINT_LIGHT_DIFFUSE_SIDE pointLightDiffuseSide
+#include "camera.glsl"
+#include "lighting.glsl"
+#include "gbuffer.glsl" // FragColor and which lights a surface takes
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormalLights;
+uniform sampler2D gDepth;
+// every material has the same shininess
+uniform float shininess;
+
+// the world position of the pixel, from its depth and the camera: view space through the inverse of
+// the projection's terms, world space through the transposed rotation of the view
+vec3 WorldPosition(ivec2 pixel, float depth)
+{
+    vec2 ndc = (vec2(pixel) + 0.5) / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0;
+    float viewDepth = projection[3][2] / (depth * 2.0 - 1.0 + projection[2][2]);
+    vec3 viewPosition = vec3((ndc.x + projection[2][0]) * viewDepth / projection[0][0],
+                             (ndc.y + projection[2][1]) * viewDepth / projection[1][1], -viewDepth);
+    return transpose(mat3(view)) * (viewPosition - view[3].xyz);
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    vec4 normalLights = texelFetch(gNormalLights, pixel, 0);
+    vec3 fragPos = WorldPosition(pixel, texelFetch(gDepth, pixel, 0).r);
+    vec3 norm = normalize(normalLights.xyz * 2.0 - 1.0);
+    int lights = int(normalLights.w * 3.0 + 0.5);
+
+    Surface surface;
+    surface.diffuse = pow(albedoSpecular.xyz, vec3(2.2));
+    surface.specular = vec3(albedoSpecular.w);
+    surface.shininess = shininess;
+    pointLightDiffuseSide = lights == LIGHTS_ROOM ? -1.0 : 1.0;
+
+    vec3 viewDir = normalize(viewPos - fragPos);
+    vec3 result = vec3(0.0);
+    if (lights != LIGHTS_MODEL)
+        result += CalcDirLight(dirLight, surface, norm, viewDir);
+#if SPOT_LIGHT
+    result += CalcSpotLight(spotLight, surface, norm, fragPos, viewDir);
+#endif
+#if POINT_LIGHTS
+    if (lights != LIGHTS_GRASS)
+        result += CalcPointLights(surface, norm, fragPos, viewDir);
+#endif
+    FragColor = vec4(pow(result, vec3(1.0 / 2.2)), 1.0);
+}
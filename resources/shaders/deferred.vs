@@ -0,0 +1,9 @@
+#version 330 core
+// a triangle covering the screen, on the far plane: it passes the GL_GREATER depth test (see
+// GBuffer::LightingPass) wherever the geometry pass drew something
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+    gl_Position = vec4(corner, 1.0, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) in vec4 aPos;     // the mesh's position stream (Mesh::depthVAO)
+layout (location = 5) in mat4 aInstanceModel; // locations 5-8, one matrix per instance
+
+#include "camera.glsl"
+
+// the depth pre-pass: the lit programs then shade with GL_EQUAL against this depth, so their vertex
+// shaders (model.vs, room.vs) compute gl_Position with the same operations on the same values
+invariant gl_Position;
+
+// set per mesh, see VertexFormat in mesh.h (only the position is needed here)
+struct VertexFormat {
+    bool compressed;
+    vec3 positionOffset;
+    vec3 positionScale;
+};
+
+uniform VertexFormat vertexFormat;
+
+void main()
+{
+    vec3 position = vertexFormat.positionOffset + aPos.xyz * vertexFormat.positionScale;
+    vec3 fragPos = vec3(aInstanceModel * vec4(position, 1.0));
+    gl_Position = projection * view * vec4(fragPos, 1.0);
+}
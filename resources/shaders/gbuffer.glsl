@@ -0,0 +1,27 @@
+// What a lit fragment shader outputs. Programs are compiled per variant (see ShaderVariants) with
+//   DEFERRED  1 for the geometry pass of the deferred renderer (gbuffer.h): the surface is written to
+//             the G-buffer and lit later by deferred.fs, 0 to light it here into FragColor
+// Include lighting.glsl first.
+#ifndef DEFERRED
+#define DEFERRED 0
+#endif
+
+// which lights a surface takes, stored with its normal for the lighting pass
+#define LIGHTS_MODEL 0  // point lights and the flashlight
+#define LIGHTS_ROOM 1   // the sun, the flashlight and the point lights, diffuse from the flipped normal
+#define LIGHTS_GRASS 2  // the sun and the flashlight
+
+#if DEFERRED
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec4 gNormalLights;
+
+// the diffuse color is display encoded like the color textures it came from, so 8 bits keep the dark
+// tones; the specular maps are grey, one channel keeps them
+void WriteGBuffer(Surface surface, vec3 normal, int lights)
+{
+    gAlbedoSpecular = vec4(pow(surface.diffuse, vec3(1.0 / 2.2)), dot(surface.specular, vec3(0.2126, 0.7152, 0.0722)));
+    gNormalLights = vec4(normal * 0.5 + 0.5, float(lights) / 3.0);
+}
+#else
+out vec4 FragColor;
+#endif
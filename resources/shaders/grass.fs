@@ -1,36 +1,18 @@
 #version 330 core
-out vec4 FragColor;
 
-in vec2 TexCoords;
-in vec3 TdirLdirection;
-in vec3 TspotLposition;
-in vec3 TspotLdirection;
-in vec3 TViewPos;
-in vec3 TFragPos;
-
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
+// PARALLAX: 1 to cut the grass along its depth map (parallax.glsl), 0 to keep the plain quad
+#ifndef PARALLAX
+#define PARALLAX 1
+#endif
 
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
+#include "camera.glsl"
+#include "lighting.glsl"
+#include "gbuffer.glsl"
+#include "parallax.glsl"
 
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    bool lamp;
-};
+in vec2 TexCoords;
+in vec3 FragPos;
+in mat3 TBN;
 
 struct Material {
     sampler2D diffuse;
@@ -41,114 +23,34 @@ struct Material {
 };
 
 uniform float heightScale;
-uniform DirLight dirLight;
-uniform SpotLight spotLight;
 uniform Material material;
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 TdirLdirection);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 TspotLposition, vec3 TspotLdirection);
-vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir);
-
 void main()
 {
-    vec3 viewDir = normalize(TViewPos - TFragPos);
-    vec2 texCoords = TexCoords;
-
-    texCoords = ParallaxMapping(TexCoords,  viewDir);
+    vec3 viewDir = normalize(viewPos - FragPos);
+#if PARALLAX
+    // the depth map is marched in tangent space
+    vec2 texCoords = ParallaxMapping(material.depth, TexCoords, normalize(viewDir * TBN), heightScale);
 
     if(texCoords.x > 40.0 || texCoords.y > 40.0 || texCoords.x < 0.0 || texCoords.y < 0.0)
         discard;
-
-    vec3 norm = texture(material.normal, TexCoords).rgb;
-    norm = normalize(norm * 2.0 - 1.0);
-
-    vec3 result = CalcDirLight(dirLight, norm, viewDir, TdirLdirection);
-    if(spotLight.lamp){
-        result += CalcSpotLight(spotLight, norm ,TFragPos, viewDir, TspotLposition, TspotLdirection);
-    }
-    FragColor = vec4(result, 1.0);
+#endif
+
+    vec3 norm = WorldNormal(material.normal, TexCoords, TBN);
+
+    Surface surface;
+    surface.diffuse = vec3(texture(material.diffuse, TexCoords));
+    surface.specular = vec3(texture(material.specular, TexCoords));
+    surface.shininess = material.shininess;
+
+#if DEFERRED
+    WriteGBuffer(surface, norm, LIGHTS_GRASS);
+#else
+    vec3 result = CalcDirLight(dirLight, surface, norm, viewDir);
+#if SPOT_LIGHT
+    result += CalcSpotLight(spotLight, surface, norm, FragPos, viewDir);
+#endif
+    // the color textures are sRGB, so lighting happened in linear space; encode it for the display
+    FragColor = vec4(pow(result, vec3(1.0 / 2.2)), 1.0);
+#endif
 }
-
-// calculates the color when using a directional light.
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 TdirLdirection)
-{
-    vec3 lightDir = normalize(TdirLdirection);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    return (ambient + diffuse + specular);
-}
-
-// calculates the color when using a spot light.
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 TspotLposition, vec3 TspotLdirection)
-{
-    vec3 lightDir = normalize(TspotLposition - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(TspotLposition- fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    // spotlight intensity
-    float theta = dot(lightDir, normalize(-TspotLdirection));
-    float epsilon = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
-    return (ambient + diffuse + specular);
-}
-
-vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir)
-{
-    // number of depth layers
-    const float minLayers = 8;
-    const float maxLayers = 32;
-    float numLayers = mix(maxLayers, minLayers, abs(dot(vec3(0.0, 0.0, 1.0), viewDir)));
-    // calculate the size of each layer
-    float layerDepth = 1.0 / numLayers;
-    // depth of current layer
-    float currentLayerDepth = 0.0;
-    // the amount to shift the texture coordinates per layer (from vector P)
-    vec2 P = viewDir.xy / viewDir.z * heightScale;
-    vec2 deltaTexCoords = P / numLayers;
-
-    // get initial values
-    vec2  currentTexCoords     = texCoords;
-    float currentDepthMapValue = texture(material.depth, currentTexCoords).r;
-
-    while(currentLayerDepth < currentDepthMapValue)
-    {
-        // shift texture coordinates along direction of P
-        currentTexCoords -= deltaTexCoords;
-        // get depthmap value at current texture coordinates
-        currentDepthMapValue = texture(material.depth, currentTexCoords).r;
-        // get depth of next layer
-        currentLayerDepth += layerDepth;
-    }
-
-    // get texture coordinates before collision (reverse operations)
-    vec2 prevTexCoords = currentTexCoords + deltaTexCoords;
-
-    // get depth after and before collision for linear interpolation
-    float afterDepth  = currentDepthMapValue - currentLayerDepth;
-    float beforeDepth = texture(material.depth, prevTexCoords).r - currentLayerDepth + layerDepth;
-
-    // interpolation of texture coordinates
-    float weight = afterDepth / (afterDepth - beforeDepth);
-    vec2 finalTexCoords = prevTexCoords * weight + currentTexCoords * (1.0 - weight);
-
-    return finalTexCoords;
-}
\ No newline at end of file
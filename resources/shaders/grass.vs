@@ -5,39 +5,26 @@ layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
 
+#include "camera.glsl"
+
+// lighting happens in world space (lighting.glsl), all it needs is where the fragment is and its basis
 out vec2 TexCoords;
-out vec3 TdirLdirection;
-out vec3 TspotLposition;
-out vec3 TspotLdirection;
-out vec3 TViewPos;
-out vec3 TFragPos;
+out vec3 FragPos;
+out mat3 TBN;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-uniform vec3 viewPos;
-uniform vec3 dirLdirection;
-uniform vec3 spotLposition;
-uniform vec3 spotLdirection;
+// inverse transpose of model's upper 3x3, computed once on the CPU
+uniform mat3 normalMatrix;
 
 void main()
 {
-    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+    FragPos = vec3(model * vec4(aPos, 1.0));
     TexCoords = aTexCoords;
 
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
     vec3 T = normalize(normalMatrix * aTangent);
     vec3 N = normalize(normalMatrix * aNormal);
     T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(N, T);
-
-    mat3 TBN = transpose(mat3(T, B, N));
-    TdirLdirection = TBN * dirLdirection;
-    TspotLposition = TBN * spotLposition;
-    TspotLdirection = TBN * spotLdirection;
-    TViewPos = TBN * viewPos;
-    TFragPos = TBN * FragPos;
+    TBN = mat3(T, cross(N, T), N);
 
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
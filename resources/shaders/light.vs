@@ -1,11 +1,24 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
+layout (location = 5) in mat4 aInstanceModel; // locations 5-8, one matrix per instance
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+// set per mesh, see VertexFormat in mesh.h (only the position is needed here)
+struct VertexFormat {
+    bool compressed;
+    vec3 positionOffset;
+    vec3 positionScale;
+};
+
+uniform VertexFormat vertexFormat;
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	vec3 position = vertexFormat.positionOffset + aPos.xyz * vertexFormat.positionScale;
+	gl_Position = projection * view * aInstanceModel * vec4(position, 1.0);
 }
\ No newline at end of file
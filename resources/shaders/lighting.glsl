@@ -0,0 +1,111 @@
+// Blinn-Phong lighting in world space, straight from the Lights block and the light clusters: the
+// vertex shader only passes the fragment's position and tangent basis, however many lights there are.
+// Include camera.glsl first. Define
+// POINT_LIGHT_DIFFUSE_SIDE as -1.0 before including this for surfaces lit by the point lights from the
+// side their normals face away from.
+#include "lights.glsl"
+
+#ifndef POINT_LIGHT_DIFFUSE_SIDE
+#define POINT_LIGHT_DIFFUSE_SIDE 1.0
+#endif
+
+// what the material gives the lighting at a fragment
+struct Surface {
+    vec3 diffuse;   // also the color of the ambient term
+    vec3 specular;
+    float shininess;
+};
+
+// the world space normal of a normal map texel. Only x and y come from the map, z is rebuilt so two
+// channel (BC5) cooked normal maps work too
+vec3 WorldNormal(sampler2D normalMap, vec2 texCoords, mat3 TBN)
+{
+    vec3 norm;
+    norm.xy = texture(normalMap, texCoords).rg * 2.0 - 1.0;
+    norm.z = sqrt(max(1.0 - dot(norm.xy, norm.xy), 0.0));
+    return normalize(TBN * norm);
+}
+
+// calculates the color when using a directional light.
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 normal, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.direction);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), surface.shininess);
+    // combine results
+    vec3 ambient = light.ambient * surface.diffuse;
+    vec3 diffuse = light.diffuse * diff * surface.diffuse;
+    vec3 specular = light.specular * spec * surface.specular;
+    return (ambient + diffuse + specular);
+}
+
+// calculates the color when using a spot light.
+vec3 CalcSpotLight(SpotLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), surface.shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // spotlight intensity
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    // combine results
+    vec3 ambient = light.ambient * surface.diffuse;
+    vec3 diffuse = light.diffuse * diff * surface.diffuse;
+    vec3 specular = light.specular * spec * surface.specular;
+    ambient *= attenuation * intensity;
+    diffuse *= attenuation * intensity;
+    specular *= attenuation * intensity;
+    return (ambient + diffuse + specular);
+}
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal * POINT_LIGHT_DIFFUSE_SIDE, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), surface.shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // faded out towards the range, beyond which the clusters don't list the light
+    float fade = clamp(1.0 - pow(distance / light.range, 4.0), 0.0, 1.0);
+    attenuation *= fade * fade;
+    // combine results
+    vec3 ambient = light.ambient * surface.diffuse;
+    vec3 diffuse = light.diffuse * diff * surface.diffuse;
+    vec3 specular = light.specular * spec * surface.specular;
+    ambient *= attenuation;
+    diffuse *= attenuation;
+    specular *= attenuation;
+    return (ambient + diffuse + specular);
+}
+
+// the point lights listed in the fragment's cluster
+vec3 CalcPointLights(Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    ivec2 tile = min(ivec2(gl_FragCoord.xy * clusterGrid.tileScale), clusterGrid.size.xy - 1);
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int slice = clamp(int(log(depth) * clusterGrid.sliceScale + clusterGrid.sliceBias), 0, clusterGrid.size.z - 1);
+    uvec2 lights = texelFetch(clusterRanges, (slice * clusterGrid.size.y + tile.y) * clusterGrid.size.x + tile.x).rg;
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < lights.y; i++)
+    {
+        int index = int(texelFetch(clusterLightIndices, int(lights.x + i)).r);
+        result += CalcPointLight(FetchPointLight(index), surface, normal, fragPos, viewDir);
+    }
+    return result;
+}
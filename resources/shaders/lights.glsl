@@ -0,0 +1,86 @@
+// The lights shared by all programs, filled once per frame (see FrameUniforms). Programs are compiled
+// per variant (see ShaderVariants) with these defines, which decide which lights get evaluated:
+//   POINT_LIGHTS  1 while any point light is on; those reaching the fragment's cluster are evaluated
+//   SPOT_LIGHT    1 while the flashlight (spotLight) is on
+#ifndef POINT_LIGHTS
+#define POINT_LIGHTS 1
+#endif
+#ifndef SPOT_LIGHT
+#define SPOT_LIGHT 1
+#endif
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    bool lamp;
+};
+
+struct PointLight {
+    vec3 position;
+    float range;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// where a fragment finds the point lights of its cluster (light_clusters.h)
+struct ClusterGrid {
+    vec2 tileScale;     // clusters per pixel along x and y
+    float sliceScale;   // depth slice = log(view depth) * sliceScale + sliceBias
+    float sliceBias;
+    ivec3 size;         // clusters along x, y and depth
+    int pointLights;
+};
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    SpotLight spotLight;
+    ClusterGrid clusterGrid;
+};
+
+// POINT_LIGHT_TEXELS texels per light, per cluster the first entry and the number of entries of its
+// run in clusterLightIndices, and the runs of light indices
+uniform samplerBuffer pointLightData;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterLightIndices;
+
+PointLight FetchPointLight(int index)
+{
+    vec4 texel0 = texelFetch(pointLightData, index * 4);
+    vec4 texel1 = texelFetch(pointLightData, index * 4 + 1);
+    vec4 texel2 = texelFetch(pointLightData, index * 4 + 2);
+    vec4 texel3 = texelFetch(pointLightData, index * 4 + 3);
+    PointLight light;
+    light.position = texel0.xyz;
+    light.range = texel0.w;
+    light.ambient = texel1.rgb;
+    light.constant = texel1.w;
+    light.diffuse = texel2.rgb;
+    light.linear = texel2.w;
+    light.specular = texel3.rgb;
+    light.quadratic = texel3.w;
+    return light;
+}
@@ -1,51 +1,12 @@
 #version 330 core
-out vec4 FragColor;
 
-in vec2 TexCoords;
-in vec3 TdirLdirection;
-in vec3 TspotLposition;
-in vec3 TspotLdirection;
-in vec3 TpointLposition1;
-in vec3 TpointLposition2;
-in vec3 TViewPos;
-in vec3 TFragPos;
-
-
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
+#include "camera.glsl"
+#include "lighting.glsl"
+#include "gbuffer.glsl"
 
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    bool lamp;
-};
-
-struct PointLight {
-    vec3 position;
-
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
+in vec2 TexCoords;
+in vec3 FragPos;
+in mat3 TBN;
 
 struct Material {
     sampler2D texture_diffuse1;
@@ -55,89 +16,29 @@ struct Material {
 };
 
 
-uniform DirLight dirLight;
-uniform SpotLight spotLight;
-uniform PointLight pointLights[2];
 uniform Material material;
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 TdirLdirection);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 TspotLposition, vec3 TspotLdirection);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 TpointLposition);
-
 void main()
 {
-    vec3 norm = texture(material.texture_normal1, TexCoords).rgb;
-    norm = normalize(norm * 2.0 - 1.0);
-
-    vec3 viewDir = normalize(TViewPos - TFragPos);
-//     vec3 result = CalcDirLight(dirLight, norm, viewDir, TdirLdirection);
-    vec3 result = CalcPointLight(pointLights[0], norm, TFragPos, viewDir, TpointLposition1);
-    result += CalcPointLight(pointLights[1], norm, TFragPos, viewDir, TpointLposition2);
-    if(spotLight.lamp){
-        result += CalcSpotLight(spotLight, norm ,TFragPos, viewDir, TspotLposition, TspotLdirection);
-    }
-//     result += CalcPointLight(pointLights[0], norm, TFragPos, viewDir, TpointLposition1);
-    FragColor = vec4(result, 1.0);
-}
-
-// calculates the color when using a directional light.
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 TdirLdirection)
-{
-    vec3 lightDir = normalize(TdirLdirection);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
-    return (ambient + diffuse + specular);
+    vec3 norm = WorldNormal(material.texture_normal1, TexCoords, TBN);
+
+    Surface surface;
+    surface.diffuse = vec3(texture(material.texture_diffuse1, TexCoords));
+    surface.specular = vec3(texture(material.texture_specular1, TexCoords));
+    surface.shininess = material.shininess;
+
+#if DEFERRED
+    WriteGBuffer(surface, norm, LIGHTS_MODEL);
+#else
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 result = vec3(0.0);
+#if POINT_LIGHTS
+    result += CalcPointLights(surface, norm, FragPos, viewDir);
+#endif
+#if SPOT_LIGHT
+    result += CalcSpotLight(spotLight, surface, norm, FragPos, viewDir);
+#endif
+    // the color textures are sRGB, so lighting happened in linear space; encode it for the display
+    FragColor = vec4(pow(result, vec3(1.0 / 2.2)), 1.0);
+#endif
 }
-
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 TspotLposition, vec3 TspotLdirection)
-{
-    vec3 lightDir = normalize(TspotLposition - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(TspotLposition - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    // spotlight intensity
-    float theta = dot(lightDir, normalize(-TspotLdirection));
-    float epsilon = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
-    return (ambient + diffuse + specular);
-}
-
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 TpointLposition)
-{
-    vec3 lightDir = normalize(TpointLposition - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(TpointLposition - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
-    return (ambient + diffuse + specular);
-}
\ No newline at end of file
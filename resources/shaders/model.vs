@@ -1,49 +1,51 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 0) in vec4 aPos;     // w: bitangent sign of compressed vertices, 1 otherwise
+layout (location = 1) in vec3 aNormal;  // xy: octahedral normal of compressed vertices
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
+layout (location = 3) in vec3 aTangent; // xy: octahedral tangent of compressed vertices
 layout (location = 4) in vec3 aBitangent;
+layout (location = 5) in mat4 aInstanceModel; // locations 5-8, one matrix per instance
+layout (location = 9) in mat3 aInstanceNormalMatrix; // locations 9-11, inverse transpose of the model matrix's upper 3x3
 
+#include "camera.glsl"
+
+// lighting happens in world space (lighting.glsl), all it needs is where the fragment is and its basis
 out vec2 TexCoords;
-out vec3 TdirLdirection;
-out vec3 TspotLposition;
-out vec3 TspotLdirection;
-out vec3 TpointLposition1;
-out vec3 TpointLposition2;
-out vec3 TViewPos;
-out vec3 TFragPos;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-uniform vec3 viewPos;
-uniform vec3 dirLdirection;
-uniform vec3 spotLposition;
-uniform vec3 spotLdirection;
-uniform vec3 pointLposition1;
-uniform vec3 pointLposition2;
+out vec3 FragPos;
+out mat3 TBN;
+// computed exactly as depth.vs does, so the depth pre-pass and this pass agree to the bit (GL_EQUAL)
+invariant gl_Position;
+
+// set per mesh, see VertexFormat in mesh.h
+struct VertexFormat {
+    bool compressed;
+    vec3 positionOffset;
+    vec3 positionScale;
+};
+
+uniform VertexFormat vertexFormat;
+
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return v;
+}
 
 void main()
 {
-    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 position = vertexFormat.positionOffset + aPos.xyz * vertexFormat.positionScale;
+    vec3 normal = vertexFormat.compressed ? octahedralDecode(aNormal.xy) : aNormal;
+    vec3 tangent = vertexFormat.compressed ? octahedralDecode(aTangent.xy) : aTangent;
+
+    FragPos = vec3(aInstanceModel * vec4(position, 1.0));
     TexCoords = aTexCoords;
 
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
-    vec3 T = normalize(normalMatrix * aTangent);
-    vec3 N = normalize(normalMatrix * aNormal);
+    vec3 T = normalize(aInstanceNormalMatrix * tangent);
+    vec3 N = normalize(aInstanceNormalMatrix * normal);
     T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(N, T);
-
-    mat3 TBN = transpose(mat3(T, B, N));
-    TdirLdirection = TBN * dirLdirection;
-    TspotLposition = TBN * spotLposition;
-    TspotLdirection = TBN * spotLdirection;
-    TpointLposition1 = TBN * pointLposition1;
-    TpointLposition2 = TBN * pointLposition2;
-    TViewPos = TBN * viewPos;
-    TFragPos = TBN * FragPos;
-
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    TBN = mat3(T, cross(N, T), N);
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Normal;
+
+// the bounding box a model shows as while it is loading: flat gray, each face a little differently lit
+void main()
+{
+    float light = 0.35 + 0.25 * abs(dot(normalize(Normal), normalize(vec3(0.5, 0.8, 0.3))));
+    FragColor = vec4(vec3(light), 1.0);
+}
@@ -0,0 +1,28 @@
+#version 330 core
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 5) in mat4 aInstanceModel; // locations 5-8, one matrix per instance
+
+out vec3 Normal;
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+// set per mesh, see VertexFormat in mesh.h (proxy boxes are always in the full format)
+struct VertexFormat {
+    bool compressed;
+    vec3 positionOffset;
+    vec3 positionScale;
+};
+
+uniform VertexFormat vertexFormat;
+
+void main()
+{
+	vec3 position = vertexFormat.positionOffset + aPos.xyz * vertexFormat.positionScale;
+	Normal = mat3(aInstanceModel) * aNormal;
+	gl_Position = projection * view * aInstanceModel * vec4(position, 1.0);
+}
@@ -7,5 +7,6 @@ uniform samplerCube skybox;
 
 void main()
 {
-    FragColor = texture(skybox, TexCoords);
+    // sRGB texture, read as linear values
+    FragColor = vec4(pow(texture(skybox, TexCoords).rgb, vec3(1.0 / 2.2)), 1.0);
 }
\ No newline at end of file
@@ -11,5 +11,6 @@ void main()
     if(texColor.a < 0.7) {
         discard;
     }
-    FragColor = texColor;
+    // sRGB texture, read as linear values
+    FragColor = vec4(pow(texColor.rgb, vec3(1.0 / 2.2)), texColor.a);
 }
\ No newline at end of file
@@ -11,9 +11,35 @@
 
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_variants.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
-
+#include <learnopengl/model_loader.h>
+#include <learnopengl/task_graph.h>
+#include <learnopengl/frame_uniforms.h>
+#include <learnopengl/light_clusters.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/alloc_counter.h>
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/sampler_cache.h>
+#include <learnopengl/texture_kind.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/texture_storage.h>
+#include <learnopengl/texture_streamer.h>
+#include <learnopengl/camera_path.h>
+#include <learnopengl/benchmark.h>
+#include <learnopengl/gpu_query.h>
+#include <learnopengl/offscreen.h>
+#include <learnopengl/gbuffer.h>
+
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
@@ -21,11 +47,26 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
-unsigned int loadTexture(char const * path);
+unsigned int loadTexture(char const * path, TextureKind kind);
 unsigned int loadCubemap(vector<std::string> faces);
+void printLoadReport(Model *const *models, const char *const *names, unsigned int count, const std::string &timelinePath);
+void measureDrawCost(Model &model, const std::string &name, ShaderVariants &variants, ShaderDefines defines,
+                     FrameUniforms &frameUniforms, LightClusters &lightClusters, Benchmark &benchmark);
+void scatterPointLights(std::vector<PointLight> &lights, int first);
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// time per frame spent creating the GL objects of models that load while the viewer renders
+const double MODEL_BUILD_MILLIS_PER_FRAME = 4.0;
+// depth layers the parallax shaders march through at grazing angles
+const int PARALLAX_LAYERS = 32;
+// timed draws per measurement of --draw-cost
+const int DRAW_COST_REPEATS = 20;
+// the first point lights hang under the lamps on the ceiling, the others are scattered through the room
+const int CEILING_LAMPS = 2;
+// size of the image being rendered: the window, or the offscreen target in --benchmark mode
+unsigned int renderWidth = SCR_WIDTH;
+unsigned int renderHeight = SCR_HEIGHT;
 
 // camera
 
@@ -39,6 +80,124 @@ float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 float heightScale = 0.5;
 
+// uniform cache counters of the last completed frame, shown in the ImGui stats window
+UniformStats frameUniformStats;
+// culling counters of the last rendered frame, shown in the ImGui camera window
+CullStats frameCullStats;
+// render queue counters of the last frame
+RenderQueueStats frameQueueStats;
+// light cluster assignment of the last frame
+ClusterStats frameClusterStats;
+// fragments of the lit surfaces that passed the depth test (were shaded) in the last frame, and that
+// passed it in the depth pre-pass; shown while the stats window is open
+unsigned long long frameShadedFragments = 0;
+unsigned long long framePrepassFragments = 0;
+
+// the queries counting those fragments in one frame. The viewer keeps two sets and reads the previous
+// frame's once the GPU has them, so the stats never make it wait for the frame it just submitted
+struct OverdrawQueries {
+    GpuQuery prepass{GL_SAMPLES_PASSED};
+    GpuQuery shaded{GL_SAMPLES_PASSED};
+    bool prepassDrawn = false;
+    bool pending = false; // ended and not read yet
+
+    bool Available() const {
+        return shaded.Available() && (!prepassDrawn || prepass.Available());
+    }
+};
+// heap allocations made while rendering the last frame's scene (ImGui excluded), should stay 0
+unsigned long long frameDrawAllocations = 0;
+// vertex buffer memory of all models in the current format, and in the full format
+size_t vertexBufferBytes = 0;
+size_t fullVertexBufferBytes = 0;
+
+// --record: the camera is captured on every input event and saved as a camera path on exit
+CameraPath cameraRecording;
+bool recordingCamera = false;
+
+// command line options
+struct Options {
+    bool benchmark = false;
+    std::string cameraPath = "resources/camera_paths/flythrough.campath"; // played back by --benchmark
+    std::string output = "benchmark.json";
+    int frames = 600;
+    int warmupFrames = 60;
+    int width = 1280;
+    int height = 720;
+    VertexFormat vertexFormat = VERTEX_COMPRESSED;
+    float lodBias = 0.0f;
+    // MB of texture data uploaded per frame while textures stream in; negative picks the default:
+    // 8 in the viewer, 0 (everything uploaded before the first frame) for --benchmark
+    float uploadBudget = -1.0f;
+    std::string recordPath;
+    // trace of the loading tasks (chrome://tracing, Perfetto), written once everything is loaded
+    std::string timelinePath;
+    // model whose GPU cost per draw (vertex and fragment work) --benchmark measures after the frames
+    std::string drawCostModel;
+    // point lights that are on, negative keeps the viewer's setting (the ceiling lamps for --benchmark)
+    int pointLights = -1;
+    // forward, deferred, or compare: --benchmark plays the path forward, then again deferred
+    std::string shading = "forward";
+    // off, on, or compare: --benchmark plays the path without the depth pre-pass, then again with it
+    std::string depthPrepass = "off";
+
+    bool Parse(int argc, char **argv);
+};
+
+bool Options::Parse(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0;
+        if (arg == "--benchmark") {
+            benchmark = true;
+            if (hasValue)
+                cameraPath = argv[++i];
+        } else if (arg == "--frames" && hasValue) {
+            frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && hasValue) {
+            warmupFrames = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--size" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                std::cout << "ERROR::OPTIONS:: --size expects WIDTHxHEIGHT" << std::endl;
+                return false;
+            }
+        } else if (arg == "--vertex-format" && hasValue && (std::strcmp(argv[i + 1], "full") == 0 || std::strcmp(argv[i + 1], "compressed") == 0)) {
+            vertexFormat = std::strcmp(argv[++i], "full") == 0 ? VERTEX_FULL : VERTEX_COMPRESSED;
+        } else if (arg == "--lod-bias" && i + 1 < argc) {
+            lodBias = (float) std::atof(argv[++i]);
+        } else if (arg == "--upload-budget" && hasValue) {
+            uploadBudget = std::max(0.0f, (float) std::atof(argv[++i]));
+        } else if (arg == "--output" && hasValue) {
+            output = argv[++i];
+        } else if (arg == "--timeline" && hasValue) {
+            timelinePath = argv[++i];
+        } else if (arg == "--draw-cost" && hasValue) {
+            drawCostModel = argv[++i];
+        } else if (arg == "--point-lights" && hasValue) {
+            pointLights = std::min(MAX_POINT_LIGHTS, std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--shading" && hasValue && (std::strcmp(argv[i + 1], "forward") == 0 || std::strcmp(argv[i + 1], "deferred") == 0 ||
+                                                      std::strcmp(argv[i + 1], "compare") == 0)) {
+            shading = argv[++i];
+        } else if (arg == "--depth-prepass" && hasValue && (std::strcmp(argv[i + 1], "off") == 0 || std::strcmp(argv[i + 1], "on") == 0 ||
+                                                            std::strcmp(argv[i + 1], "compare") == 0)) {
+            depthPrepass = argv[++i];
+        } else if (arg == "--record" && hasValue) {
+            recordPath = argv[++i];
+        } else {
+            std::cout << "usage: " << argv[0] << " [--record <path.campath>]\n"
+                      << "       " << argv[0] << " --benchmark [<path.campath>] [--frames N] [--warmup N] [--size WxH] [--output <file.json>] [--draw-cost <model>]\n"
+                      << "       (both) [--vertex-format full|compressed] [--lod-bias B] [--upload-budget MB] [--timeline <file.json>] [--point-lights N]\n"
+                      << "       (both) [--shading forward|deferred|compare] [--depth-prepass off|on|compare]" << std::endl;
+            return false;
+        }
+    }
+    if (shading == "compare" && depthPrepass == "compare") {
+        std::cout << "ERROR::OPTIONS:: --shading compare and --depth-prepass compare can't be combined" << std::endl;
+        return false;
+    }
+    return true;
+}
+
 struct ProgramState {
     bool ImGuiEnabled = false;
     Camera camera;
@@ -47,6 +206,13 @@ struct ProgramState {
     float lin = 0.09;
     float quad = 0.032;
     float spotLightRadius = 0.0f;
+    bool CullingEnabled = true;
+    float CullMinPixelSize = 4.0f; // meshes smaller than this on screen are skipped
+    bool CompressedVertices = true; // 20 byte instead of 56 byte vertices, see CompressedVertex
+    float LodBias = 0.0f; // levels of detail may show an error of 2^LodBias pixels, higher switches to coarser ones sooner
+    int PointLights = CEILING_LAMPS; // how many of the point lights are on, the ceiling lamps first
+    bool Deferred = false; // lit surfaces go through the G-buffer and are lit once per pixel, see GBuffer
+    bool DepthPrepass = false; // lit surfaces are drawn depth only first and shaded once per visible pixel
     ProgramState()
             : camera(glm::vec3(0.0f, 0.0f, -3.0f)) {}
 
@@ -91,88 +257,291 @@ ProgramState *programState;
 
 void DrawImGui(ProgramState *programState);
 
-int main() {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+int main(int argc, char **argv) {
+    auto startupBegin = std::chrono::steady_clock::now();
+    Options options;
+    if (!options.Parse(argc, argv))
+        return -1;
+    recordingCamera = !options.recordPath.empty();
+
+    // --benchmark renders without a window: into an EGL surfaceless context where available,
+    // otherwise into a hidden GLFW window; either way into an offscreen target of the requested size
+    bool headless = false;
+#ifdef RG_HAVE_EGL
+    OffscreenContext offscreenContext;
+    headless = options.benchmark;
+#endif
+    GLFWwindow *window = NULL;
+    GLADloadproc glLoader = (GLADloadproc) glfwGetProcAddress;
+    if (headless) {
+#ifdef RG_HAVE_EGL
+        glLoader = (GLADloadproc) OffscreenContext::GetProcAddress;
+        if (!offscreenContext.Create() || !gladLoadGLLoader(glLoader)) {
+            std::cout << "Failed to create an offscreen OpenGL context" << std::endl;
+            return -1;
+        }
+#endif
+    } else {
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        if (options.benchmark)
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // glfw window creation
-    // --------------------
-    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-    if (window == NULL) {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        // glfw window creation
+        // --------------------
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+        if (window == NULL) {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+        // glad: load all OpenGL function pointers
+        // ---------------------------------------
+        if (!gladLoadGLLoader(glLoader)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        renderWidth = framebufferWidth;
+        renderHeight = framebufferHeight;
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-    glfwSetKeyCallback(window, key_callback);
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+
+    // entry points beyond 3.3 core (immutable texture storage) where the context has them
+    GLExtensions::Load(glLoader);
+    // programs linked on an earlier run are loaded as driver binaries instead of being compiled again
+    ProgramCache::Enable("shader_cache");
+    // a driver without parallel compile compiles when asked to; then the programs are compiled on a thread
+    // of their own, in a second context sharing the objects of the first
+    GLFWwindow *compileWindow = NULL;
+    if (!GLExtensions::HasParallelShaderCompile()) {
+        if (headless) {
+#ifdef RG_HAVE_EGL
+            if (offscreenContext.CreateShared())
+                ShaderCompiler::StartCompileThread([&offscreenContext] { return offscreenContext.MakeSharedCurrent(); },
+                                                   [&offscreenContext] { offscreenContext.ReleaseShared(); });
+#endif
+        } else {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            compileWindow = glfwCreateWindow(1, 1, "", NULL, window);
+            if (compileWindow != NULL)
+                ShaderCompiler::StartCompileThread([compileWindow] {
+                    glfwMakeContextCurrent(compileWindow);
+                    return glfwGetCurrentContext() == compileWindow;
+                }, [] { glfwMakeContextCurrent(NULL); });
+        }
+    }
+    // textures cooked by project_base_cook are uploaded as they are, without decoding or generating mips
+    TextureLoader::EnableCookedTextures();
+    // with an upload budget, textures arrive over the first frames, a budget's worth of slices per frame
+    // staged in a ring of pixel buffer memory
+    if (options.uploadBudget < 0.0f)
+        options.uploadBudget = options.benchmark ? 0.0f : 8.0f;
+    size_t uploadBudget = (size_t) (options.uploadBudget * 1024.0f * 1024.0f);
+    if (uploadBudget > 0)
+        TextureStreamer::Enable(4 * uploadBudget);
+
+    OffscreenTarget benchmarkTarget;
+    CameraPath benchmarkPath;
+    if (options.benchmark) {
+        if (!benchmarkPath.Load(options.cameraPath)) {
+            std::cout << "ERROR::BENCHMARK:: could not load camera path " << options.cameraPath << std::endl;
+            return -1;
+        }
+        if (!benchmarkTarget.Create(options.width, options.height))
+            return -1;
+        renderWidth = options.width;
+        renderHeight = options.height;
     }
 
     programState = new ProgramState;
-    programState->LoadFromFile("resources/program_state.txt");
+    // benchmark runs don't depend on (or change) the settings left behind by the last interactive session
+    if (!options.benchmark)
+        programState->LoadFromFile("resources/program_state.txt");
+    programState->CompressedVertices = options.vertexFormat == VERTEX_COMPRESSED;
+    programState->LodBias = options.lodBias;
+    if (options.pointLights >= 0)
+        programState->PointLights = options.pointLights;
+    programState->Deferred = options.shading == "deferred";
+    programState->DepthPrepass = options.depthPrepass == "on";
     if (programState->ImGuiEnabled) {
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
     programState->camera.Position = glm::vec3(-1.5f, 0.3f, 20.0f);
     programState->camera.Front = glm::vec3(0.0,0.0,0.0);
     // Init Imgui
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO &io = ImGui::GetIO();
-    (void) io;
-
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330 core");
+    if (!options.benchmark) {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO &io = ImGui::GetIO();
+        (void) io;
+
+        ImGui_ImplGlfw_InitForOpenGL(window, true);
+        ImGui_ImplOpenGL3_Init("#version 330 core");
+    }
 
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
 
-    // build and compile shaders
-    // -------------------------
-    Shader modelShader("resources/shaders/model.vs", "resources/shaders/model.fs");
-    Shader grassShader("resources/shaders/grass.vs", "resources/shaders/grass.fs");
+    // build and compile shaders: read on the thread pool and compiled while the assets load, each
+    // program waited for when it is first used
+    // ------------------------------------------------------------------------------------------------
     Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
     Shader windowShader("resources/shaders/window.vs", "resources/shaders/window.fs");
     Shader lightShader("resources/shaders/light.vs", "resources/shaders/light.fs");
-    Shader roomShader("resources/shaders/room.vs", "resources/shaders/room.fs");
-    // load models
-    // -----------
-    Model roomModel("resources/objects/room/room.obj");
-    Model tableModel("resources/objects/table/table.obj");
-    Model closetModel("resources/objects/closet/uploads_files_2750161_Wardrobes.obj");
-    Model appleModel("resources/objects/apple/apple.obj");
-    Model notebookModel("resources/objects/notebook/Lowpoly_Notebook_2.obj");
-    Model coffeeModel("resources/objects/coffee/coffee_cup_obj.obj");
-    Model chairModel("resources/objects/chair/uploads_files_2164682_Office_chair_type_03.obj");
-    Model lightModel("resources/objects/light/light.obj");
-
-    roomModel.SetShaderTextureNamePrefix("material.");
-    tableModel.SetShaderTextureNamePrefix("material.");
-    closetModel.SetShaderTextureNamePrefix("material.");
-    appleModel.SetShaderTextureNamePrefix("material.");
-    notebookModel.SetShaderTextureNamePrefix("material.");
-    coffeeModel.SetShaderTextureNamePrefix("material.");
-    chairModel.SetShaderTextureNamePrefix("material.");
-    lightModel.SetShaderTextureNamePrefix("material.");
+    Shader proxyShader("resources/shaders/proxy.vs", "resources/shaders/proxy.fs");
+    Shader depthShader("resources/shaders/depth.vs", "resources/shaders/depth.fs");
+
+    // camera and lights live in two uniform buffers shared by all programs, the point lights in buffer
+    // textures listing them per cluster of the view frustum
+    FrameUniforms frameUniforms;
+    LightClusters lightClusters;
+    frameUniforms.Attach(skyboxShader);
+    frameUniforms.Attach(windowShader);
+    frameUniforms.Attach(lightShader);
+    frameUniforms.Attach(proxyShader);
+    frameUniforms.Attach(depthShader);
+
+    // the lit programs are compiled per set of lights that are on (and per material for parallax), each
+    // variant the first time it is needed, and set up like this
+    auto litSetup = [&frameUniforms, &lightClusters](Shader &shader) {
+        frameUniforms.Attach(shader);
+        shader.use();
+        lightClusters.Attach(shader);
+        shader.setFloat("material.shininess", 64.0f);
+        shader.setFloat("heightScale", heightScale);
+    };
+    ShaderVariants modelVariants("resources/shaders/model.vs", "resources/shaders/model.fs", litSetup);
+    ShaderVariants roomVariants("resources/shaders/room.vs", "resources/shaders/room.fs", litSetup);
+    ShaderVariants grassVariants("resources/shaders/grass.vs", "resources/shaders/grass.fs", [&litSetup](Shader &shader) {
+        litSetup(shader);
+        shader.setInt("material.diffuse", 0);
+        shader.setInt("material.specular", 1);
+        shader.setInt("material.normal", 2);
+        shader.setInt("material.depth", 3);
+    });
+    // the deferred renderer's lighting pass, per set of lights that are on like the lit programs
+    ShaderVariants deferredVariants("resources/shaders/deferred.vs", "resources/shaders/deferred.fs", [&frameUniforms, &lightClusters](Shader &shader) {
+        frameUniforms.Attach(shader);
+        shader.use();
+        lightClusters.Attach(shader);
+        shader.setInt("gAlbedoSpecular", GBUFFER_ALBEDO_UNIT);
+        shader.setInt("gNormalLights", GBUFFER_NORMAL_UNIT);
+        shader.setInt("gDepth", GBUFFER_DEPTH_UNIT);
+        shader.setFloat("shininess", 64.0f);
+    });
+    // the defines evaluating the lights that are on
+    auto lightDefines = [](int pointLights, bool spotLight) {
+        return ShaderDefines().Set("POINT_LIGHTS", pointLights > 0).Set("SPOT_LIGHT", spotLight);
+    };
+    // the defines of the lit variants: forward, for the lights that are on, or deferred, writing the
+    // G-buffer whatever lights are on
+    auto litDefines = [&lightDefines](int pointLights, bool spotLight, bool deferred) {
+        ShaderDefines defines = deferred ? ShaderDefines().Set("DEFERRED", 1) : lightDefines(pointLights, spotLight);
+        return defines.Set("PARALLAX_LAYERS", PARALLAX_LAYERS);
+    };
+    // the variants of the first frame (and with --shading compare, of the deferred run) start compiling
+    // now, with and without parallax since which materials have height maps is only known once the
+    // models are loaded
+    for (int deferred = 0; deferred <= 1; deferred++) {
+        if (deferred ? options.shading == "forward" : programState->Deferred)
+            continue;
+        for (int parallax = 0; parallax <= 1; parallax++) {
+            modelVariants.Submit(litDefines(programState->PointLights, lamp, deferred).Set("PARALLAX", parallax));
+            roomVariants.Submit(litDefines(programState->PointLights, lamp, deferred).Set("PARALLAX", parallax));
+        }
+        grassVariants.Submit(litDefines(0, lamp, deferred).Set("PARALLAX", 1));
+        if (deferred)
+            deferredVariants.Submit(lightDefines(programState->PointLights, lamp));
+    }
+
+    // light values that never change
+    LightsBlock &lights = frameUniforms.lights;
+    lights.dirLight.direction = glm::vec3(0.91f, 0.33f, -0.23f);
+    lights.dirLight.ambient = glm::vec3(0.05f);
+    lights.dirLight.diffuse = glm::vec3(0.4f);
+    lights.dirLight.specular = glm::vec3(0.5f);
+
+    lights.spotLight.ambient = glm::vec3(0.05f);
+    lights.spotLight.diffuse = glm::vec3(1.0f);
+    lights.spotLight.specular = glm::vec3(1.0f);
+
+    std::vector<PointLight> pointLights(MAX_POINT_LIGHTS);
+    pointLights[0].position = glm::vec3(2.0f, 3.8f, 0.0f);
+    pointLights[1].position = glm::vec3(-2.0f, 3.8f, 4.0f);
+    for (int i = 0; i < CEILING_LAMPS; i++)
+    {
+        pointLights[i].ambient = glm::vec3(0.05f);
+        pointLights[i].diffuse = glm::vec3(0.8f);
+        pointLights[i].specular = glm::vec3(1.0f);
+    }
+    scatterPointLights(pointLights, CEILING_LAMPS);
+    // load textures; they decode on worker threads while the models below are imported
+    // -----------------------------------------------------------------------------------
+    unsigned int grassDiffuse = loadTexture(FileSystem::getPath("resources/textures/Green-Grass-Ground-Texture-DIFFUSE.jpg").c_str(), TEXTURE_COLOR);
+    unsigned int grassSpecular = loadTexture(FileSystem::getPath("resources/textures/Green-Grass-Ground-Texture-SPECULAR.jpg").c_str(), TEXTURE_DATA);
+    unsigned int grassNormal = loadTexture(FileSystem::getPath("resources/textures/Green-Grass-Ground-Texture-NORMAL.jpg").c_str(), TEXTURE_NORMAL);
+    unsigned int grassHeight = loadTexture(FileSystem::getPath("resources/textures/Green-Grass-Ground-Texture-DISP.jpg").c_str(), TEXTURE_DATA);
+
+    unsigned int windowTexture = loadTexture(FileSystem::getPath("resources/textures/window.png").c_str(), TEXTURE_COLOR);
+
+    vector<std::string> faces
+    {
+            FileSystem::getPath("resources/textures/skybox/px.png"),
+            FileSystem::getPath("resources/textures/skybox/nx.png"),
+            FileSystem::getPath("resources/textures/skybox/py.png"),
+            FileSystem::getPath("resources/textures/skybox/ny.png"),
+            FileSystem::getPath("resources/textures/skybox/pz.png"),
+            FileSystem::getPath("resources/textures/skybox/nz.png")
+    };
+
+    unsigned int cubemapTexture = loadCubemap(faces);
+
+    // load models; mesh caches are mapped (or meshes imported) on worker threads and the GL objects are
+    // built on this one, all of them before the first frame or, streaming, over the first frames
+    // --------------------------------------------------------------------------------------------------
+    VertexFormat vertexFormat = options.vertexFormat;
+    Model roomModel(vertexFormat);
+    Model tableModel(vertexFormat);
+    Model closetModel(vertexFormat);
+    Model appleModel(vertexFormat);
+    Model notebookModel(vertexFormat);
+    Model coffeeModel(vertexFormat);
+    Model chairModel(vertexFormat);
+    Model lightModel(vertexFormat);
+    Model *models[] = {&roomModel, &tableModel, &closetModel, &appleModel, &notebookModel, &coffeeModel, &chairModel, &lightModel};
+    const char *modelNames[] = {"room", "table", "closet", "apple", "notebook", "coffee", "chair", "light"};
+    const char *modelPaths[] = {
+            "resources/objects/room/room.obj",
+            "resources/objects/table/table.obj",
+            "resources/objects/closet/uploads_files_2750161_Wardrobes.obj",
+            "resources/objects/apple/apple.obj",
+            "resources/objects/notebook/Lowpoly_Notebook_2.obj",
+            "resources/objects/coffee/coffee_cup_obj.obj",
+            "resources/objects/chair/uploads_files_2164682_Office_chair_type_03.obj",
+            "resources/objects/light/light.obj"
+    };
+    for (unsigned int i = 0; i < sizeof(models) / sizeof(models[0]); i++) {
+        models[i]->SetShaderTextureNamePrefix("material.");
+        ModelLoader::Request(*models[i], modelPaths[i]);
+    }
 
     glm::vec3 pos1(-20.0f,  20.0f, 0.0f);
     glm::vec3 pos2(-20.0f, -20.0f, 0.0f);
@@ -327,30 +696,18 @@ int main() {
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 
-    unsigned int grassDiffuse = loadTexture(FileSystem::getPath("resources/textures/Green-Grass-Ground-Texture-DIFFUSE.jpg").c_str());
-    unsigned int grassSpecular = loadTexture(FileSystem::getPath("resources/textures/Green-Grass-Ground-Texture-SPECULAR.jpg").c_str());
-    unsigned int grassNormal = loadTexture(FileSystem::getPath("resources/textures/Green-Grass-Ground-Texture-NORMAL.jpg").c_str());
-    unsigned int grassHeight = loadTexture(FileSystem::getPath("resources/textures/Green-Grass-Ground-Texture-DISP.jpg").c_str());
-
-    unsigned int windowTexture = loadTexture(FileSystem::getPath("resources/textures/window.png").c_str());
 
-    vector<std::string> faces
-    {
-            FileSystem::getPath("resources/textures/skybox/px.png"),
-            FileSystem::getPath("resources/textures/skybox/nx.png"),
-            FileSystem::getPath("resources/textures/skybox/py.png"),
-            FileSystem::getPath("resources/textures/skybox/ny.png"),
-            FileSystem::getPath("resources/textures/skybox/pz.png"),
-            FileSystem::getPath("resources/textures/skybox/nz.png")
-    };
-
-    unsigned int cubemapTexture = loadCubemap(faces);
-
-    grassShader.use();
-    grassShader.setInt("material.diffuse", 0);
-    grassShader.setInt("material.specular", 1);
-    grassShader.setInt("material.normal", 2);
-    grassShader.setInt("material.depth", 3);
+    // every model and texture requested so far (models, grass maps, skybox faces) has been loading in the
+    // background. Streamed, they arrive over the first frames; otherwise all of them before the first one.
+    // The shaders read so far go to the driver in between, so it compiles them while the rest loads.
+    bool assetsLoading = TextureStreamer::Enabled();
+    ShaderCompiler::Update();
+    if (!assetsLoading) {
+        ModelLoader::FinishPending();
+        ShaderCompiler::Update();
+        TextureLoader::FinishPending();
+        printLoadReport(models, modelNames, sizeof(models) / sizeof(models[0]), options.timelinePath);
+    }
 
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
@@ -358,54 +715,228 @@ int main() {
     windowShader.use();
     windowShader.setInt("texture1", 0);
 
+    // placement of the room, furniture and lamps; every model is drawn instanced with one matrix per copy
+    // ----------------------------------------------------------------------------------------------------
+    glm::mat4 transform = glm::mat4(1.0f);
+    transform = glm::rotate(transform, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    roomModel.SetInstances({transform});
+
+    transform = glm::mat4(1.0f);
+    transform = glm::translate(transform, glm::vec3(3.0,0.33,0.0));
+    transform = glm::scale(transform, glm::vec3(1.5));
+    tableModel.SetInstances({transform});
+
+    transform = glm::mat4(1.0f);
+    transform = glm::translate(transform, glm::vec3(2.8,1.24,0.7));
+    transform = glm::scale(transform, glm::vec3(0.3));
+    appleModel.SetInstances({transform});
+
+    transform = glm::mat4(1.0f);
+    transform = glm::translate(transform, glm::vec3(3.0,1.27,0.0));
+    transform = glm::scale(transform, glm::vec3(0.3));
+    notebookModel.SetInstances({transform});
+
+    transform = glm::mat4(1.0f);
+    transform = glm::translate(transform, glm::vec3(-2.0,0.0,-1.2));
+    transform = glm::scale(transform, glm::vec3(1.6));
+    closetModel.SetInstances({transform});
+
+    transform = glm::mat4(1.0f);
+    transform = glm::translate(transform, glm::vec3(2.5,1.24,0.8));
+    transform = glm::rotate(transform, glm::radians(-120.0f), glm::vec3(0.0,1.0,0.0));
+    transform = glm::scale(transform, glm::vec3(0.4));
+    coffeeModel.SetInstances({transform});
+
+    transform = glm::mat4(1.0f);
+    transform = glm::translate(transform, glm::vec3(1.0,0.0,0.0));
+    transform = glm::rotate(transform, glm::radians(90.0f), glm::vec3(0.0,1.0,0.0));
+    transform = glm::scale(transform, glm::vec3(0.7));
+    chairModel.SetInstances({transform});
+
+    // one lamp above each ceiling light
+    vector<glm::mat4> lampTransforms;
+    for (int i = 0; i < CEILING_LAMPS; i++)
+    {
+        transform = glm::mat4(1.0f);
+        transform = glm::translate(transform, pointLights[i].position + glm::vec3(0.0f, 0.04f, 0.0f));
+        transform = glm::scale(transform, glm::vec3(0.3));
+        lampTransforms.push_back(transform);
+    }
+    lightModel.SetInstances(lampTransforms);
+
+    // the static scene, compiled once into a sorted draw list
+    RenderQueue renderQueue;
+    renderQueue.SetProxyShader(proxyShader);
+    // the renderer and lights the current shader variants were picked for, as deferred * 4 + (any point
+    // light on) * 2 + lamp
+    int variantLights = -1;
+    Shader *grassShader = nullptr;
+    Shader *deferredShader = nullptr;
+    GBuffer gBuffer;
+    // overdraw of the lit surfaces: fragments that got past the depth test in the pre-pass and in shading,
+    // counted by the queries of the frame's parity
+    OverdrawQueries overdrawQueries[2];
+    unsigned int overdrawFrame = 0;
+    renderQueue.Add(roomModel, roomVariants, PASS_OPAQUE);
+    renderQueue.Add(tableModel, modelVariants, PASS_OPAQUE);
+    renderQueue.Add(appleModel, modelVariants, PASS_OPAQUE);
+    renderQueue.Add(notebookModel, modelVariants, PASS_OPAQUE);
+    renderQueue.Add(closetModel, modelVariants, PASS_OPAQUE);
+    renderQueue.Add(coffeeModel, modelVariants, PASS_OPAQUE);
+    renderQueue.Add(chairModel, modelVariants, PASS_OPAQUE);
+    renderQueue.Add(lightModel, lightShader, PASS_OPAQUE_CULL_FRONT);
+
+    Benchmark benchmark(options.warmupFrames, options.frames);
+    double clusterAssignMillis = 0.0;
+    // over the timed frames
+    double shadedFragments = 0.0, prepassFragments = 0.0;
+    // with --shading compare or --depth-prepass compare, the path is played twice; results of a run are
+    // named after what it compares
+    bool comparing = options.shading == "compare" || options.depthPrepass == "compare";
+    bool secondRun = false;
+    auto runName = [&options]() -> std::string {
+        if (options.depthPrepass == "compare")
+            return programState->DepthPrepass ? "prepass" : "no_prepass";
+        return programState->Deferred ? "deferred" : "forward";
+    };
+    auto addRunResults = [&benchmark, &options, &shadedFragments, &prepassFragments](const std::string &name) {
+        double pixels = (double)options.width * options.height * options.frames;
+        benchmark.AddResult(name + "_frame_ms", benchmark.MeanFrameMillis());
+        benchmark.AddResult(name + "_frame_ms_p95", benchmark.FrameMillisPercentile(0.95));
+        benchmark.AddResult(name + "_shaded_fragments_per_pixel", shadedFragments / pixels);
+        if (programState->DepthPrepass)
+            benchmark.AddResult(name + "_depth_only_fragments_per_pixel", prepassFragments / pixels);
+    };
+    bool firstFrame = true;
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window)) {
-        // per-frame time logic
-        // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+    while (options.benchmark ? !benchmark.Done() : !glfwWindowShouldClose(window)) {
+        frameUniformStats = UniformStats::Get();
+        UniformStats::Get() = UniformStats();
+
+        // vertex format switched in the stats window: re-upload every model's vertices
+        if (programState->CompressedVertices != (vertexFormat == VERTEX_COMPRESSED)) {
+            vertexFormat = programState->CompressedVertices ? VERTEX_COMPRESSED : VERTEX_FULL;
+            vertexBufferBytes = 0;
+            for (Model *m : models) {
+                m->SetVertexFormat(vertexFormat);
+                vertexBufferBytes += m->VertexBytes();
+            }
+        }
 
-        // input
-        // -----
-        processInput(window);
+        if (options.benchmark) {
+            // the camera follows the path at a fixed step per frame, so every run renders the same images
+            benchmark.BeginFrame();
+            benchmarkPath.Apply(benchmark.Progress() * benchmarkPath.Duration(), programState->camera);
+        } else {
+            // per-frame time logic
+            // --------------------
+            float currentFrame = glfwGetTime();
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
+
+            // input
+            // -----
+            processInput(window);
+        }
 
         // render
         // ------
+        unsigned long long allocationsBefore = AllocationCounter::Count();
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        grassShader.use();
-        grassShader.setVec3("viewPos", programState->camera.Position);
-        grassShader.setFloat("material.shininess", 64.0f);
-
-        grassShader.setVec3("dirLdirection", 0.91f, 0.33f, -0.23f);
-        grassShader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-        grassShader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-        grassShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-
-        grassShader.setVec3("spotLposition", programState->camera.Position);
-        grassShader.setVec3("spotLdirection", programState->camera.Front);
-        grassShader.setVec3("spotLight.ambient", 0.05f, 0.05f, 0.05f);
-        grassShader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-        grassShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-        grassShader.setFloat("spotLight.constant", programState->cons);
-        grassShader.setFloat("spotLight.linear", programState->lin);
-        grassShader.setFloat("spotLight.quadratic", programState->quad);
-        grassShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(programState->spotLightRadius)));
-        grassShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(programState->spotLightRadius + 2.5f)));
-        grassShader.setBool("spotLight.lamp", lamp);
-
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        // camera and lights for this frame, uploaded once and read by every program
+        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom), (float)renderWidth / (float)renderHeight, 0.1f, 100.0f);
         glm::mat4 view = programState->camera.GetViewMatrix();
+        frameUniforms.camera.projection = projection;
+        frameUniforms.camera.view = view;
+        frameUniforms.camera.viewPos = programState->camera.Position;
+
+        lights.spotLight.position = programState->camera.Position;
+        lights.spotLight.direction = programState->camera.Front;
+        lights.spotLight.constant = programState->cons;
+        lights.spotLight.linear = programState->lin;
+        lights.spotLight.quadratic = programState->quad;
+        lights.spotLight.cutOff = glm::cos(glm::radians(programState->spotLightRadius));
+        lights.spotLight.outerCutOff = glm::cos(glm::radians(programState->spotLightRadius + 2.5f));
+        lights.spotLight.lamp = lamp;
+        for (int i = 0; i < CEILING_LAMPS; i++)
+        {
+            pointLights[i].constant = programState->cons;
+            pointLights[i].linear = programState->lin;
+            pointLights[i].quadratic = programState->quad;
+        }
+        lightClusters.lights.assign(pointLights.begin(), pointLights.begin() + programState->PointLights);
+        lightClusters.Update(frameUniforms, renderWidth, renderHeight);
+        frameClusterStats = lightClusters.stats;
+        if (options.benchmark && benchmark.Timed())
+            clusterAssignMillis += lightClusters.stats.assignMillis;
+        frameUniforms.Upload();
+
+        // switching lights on or off switches to the variants that evaluate just the kinds of lights that
+        // are on; deferred, that is only the lighting pass
+        int lightsOn = programState->Deferred * 4 + (programState->PointLights > 0) * 2 + lamp;
+        if (lightsOn != variantLights) {
+            variantLights = lightsOn;
+            renderQueue.SetDefines(litDefines(programState->PointLights, lamp, programState->Deferred));
+            grassShader = &grassVariants.Get(litDefines(0, lamp, programState->Deferred).Set("PARALLAX", 1));
+            if (programState->Deferred)
+                deferredShader = &deferredVariants.Get(lightDefines(programState->PointLights, lamp));
+        }
+
+        // loaded models get their GL objects for a few milliseconds (showing as boxes until then), decoded
+        // textures get their storage and start uploading while less than a frame's budget is waiting, and
+        // the uploads under way move by one frame's budget
+        if (assetsLoading) {
+            ShaderCompiler::Update();
+            if (ModelLoader::Update(MODEL_BUILD_MILLIS_PER_FRAME))
+                renderQueue.MarkDirty();
+            while (TextureStreamer::QueuedBytes() < uploadBudget && TextureLoader::Poll(1))
+                ;
+            TextureStreamer::Update(uploadBudget);
+            if (ModelLoader::Idle() && TextureLoader::Idle() && TextureStreamer::Idle()) {
+                assetsLoading = false;
+                printLoadReport(models, modelNames, sizeof(models) / sizeof(models[0]), options.timelinePath);
+                TextureStreamer::PrintReport();
+            }
+        }
+        if (options.benchmark)
+            benchmark.EndPhase(PHASE_UPDATE);
+
+        // every model mesh instance is tested against this frame's view before it is drawn
+        ViewCuller culler(projection, view, (float)renderHeight);
+        culler.enabled = programState->CullingEnabled;
+        culler.minPixelSize = programState->CullMinPixelSize;
+        culler.lodPixelError = std::pow(2.0f, programState->LodBias);
+        renderQueue.Submit(culler);
+        if (options.benchmark)
+            benchmark.EndPhase(PHASE_CULL_SORT);
+
+        // deferred, the lit surfaces (grass and the lit packets) are drawn into the G-buffer and lit in
+        // one pass into the target, where everything else is drawn as it is forward
+        unsigned int targetFBO = options.benchmark ? benchmarkTarget.FBO : 0;
+        if (programState->Deferred) {
+            gBuffer.Resize(renderWidth, renderHeight);
+            gBuffer.BeginGeometryPass();
+        }
+        // the depth of the lit packets first; grass is left out, it discards where parallax cuts it
+        OverdrawQueries &overdraw = overdrawQueries[overdrawFrame++ & 1];
+        bool prepassDrawn = programState->DepthPrepass;
+        overdraw.prepassDrawn = prepassDrawn;
+        if (prepassDrawn) {
+            overdraw.prepass.Begin();
+            renderQueue.ExecuteDepthPrepass(depthShader);
+            overdraw.prepass.End();
+        }
+        overdraw.shaded.Begin();
+
+        grassShader->use();
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f,-0.0005f,0.0f));
         model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0,0.0,0.0));
-        grassShader.setMat4("projection", projection);
-        grassShader.setMat4("view", view);
-        grassShader.setMat4("model", model);
-        grassShader.setFloat("heightScale", heightScale);
+        grassShader->setMat4("model", model);
+        grassShader->setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
 
         glBindVertexArray(grassVAO);
         glActiveTexture(GL_TEXTURE0);
@@ -416,157 +947,27 @@ int main() {
         glBindTexture(GL_TEXTURE_2D, grassNormal);
         glActiveTexture(GL_TEXTURE3);
         glBindTexture(GL_TEXTURE_2D, grassHeight);
+        for (unsigned int unit = 0; unit < 4; unit++)
+            SamplerCache::Bind(unit, SAMPLER_REPEAT);
         glDrawArrays(GL_TRIANGLES, 0, 6);
         glBindVertexArray(0);
 
-        roomShader.use();
-        roomShader.setVec3("viewPos", programState->camera.Position);
-        roomShader.setFloat("material.shininess", 64.0f);
-
-        roomShader.setVec3("dirLdirection", 0.91f, 0.33f, -0.23f);
-        roomShader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-        roomShader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-        roomShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-
-        roomShader.setVec3("spotLposition", programState->camera.Position);
-        roomShader.setVec3("spotLdirection", programState->camera.Front);
-        roomShader.setVec3("spotLight.ambient", 0.05f, 0.05f, 0.05f);
-        roomShader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-        roomShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-        roomShader.setFloat("spotLight.constant", programState->cons);
-        roomShader.setFloat("spotLight.linear", programState->lin);
-        roomShader.setFloat("spotLight.quadratic", programState->quad);
-        roomShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(programState->spotLightRadius)));
-        roomShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(programState->spotLightRadius + 2.5f)));
-        roomShader.setBool("spotLight.lamp", lamp);
-
-        roomShader.setVec3("pointLposition1", 2.0f,3.8f,0.0f);
-        roomShader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-        roomShader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-        roomShader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-        roomShader.setFloat("pointLights[0].constant", programState->cons);
-        roomShader.setFloat("pointLights[0].linear", programState->lin);
-        roomShader.setFloat("pointLights[0].quadratic", programState->quad);
-
-        roomShader.setVec3("pointLposition2", -2.0f,3.8f,4.0f);
-        roomShader.setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-        roomShader.setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-        roomShader.setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-        roomShader.setFloat("pointLights[1].constant", programState->cons);
-        roomShader.setFloat("pointLights[1].linear", programState->lin);
-        roomShader.setFloat("pointLights[1].quadratic", programState->quad);
-
-        roomShader.setMat4("projection", projection);
-        roomShader.setMat4("view", view);
-        roomShader.setFloat("heightScale", heightScale);
-
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        roomShader.setMat4("model", model);
-        roomModel.Draw(roomShader);
-
-        modelShader.use();
-        modelShader.setVec3("viewPos", programState->camera.Position);
-        modelShader.setFloat("material.shininess", 64.0f);
-
-        modelShader.setVec3("dirLdirection", 0.91f, 0.33f, -0.23f);
-        modelShader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-        modelShader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-        modelShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-
-        modelShader.setVec3("spotLposition", programState->camera.Position);
-        modelShader.setVec3("spotLdirection", programState->camera.Front);
-        modelShader.setVec3("spotLight.ambient", 0.05f, 0.05f, 0.05f);
-        modelShader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-        modelShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-        modelShader.setFloat("spotLight.constant", programState->cons);
-        modelShader.setFloat("spotLight.linear", programState->lin);
-        modelShader.setFloat("spotLight.quadratic", programState->quad);
-        modelShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(programState->spotLightRadius)));
-        modelShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(programState->spotLightRadius + 2.5f)));
-        modelShader.setBool("spotLight.lamp", lamp);
-
-        modelShader.setVec3("pointLposition1", 2.0f,3.8f,0.0f);
-        modelShader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-        modelShader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-        modelShader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-        modelShader.setFloat("pointLights[0].constant", programState->cons);
-        modelShader.setFloat("pointLights[0].linear", programState->lin);
-        modelShader.setFloat("pointLights[0].quadratic", programState->quad);
-
-        modelShader.setVec3("pointLposition2", -2.0f,3.8f,4.0f);
-        modelShader.setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-        modelShader.setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-        modelShader.setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-        modelShader.setFloat("pointLights[1].constant", programState->cons);
-        modelShader.setFloat("pointLights[1].linear", programState->lin);
-        modelShader.setFloat("pointLights[1].quadratic", programState->quad);
-
-        modelShader.setMat4("projection", projection);
-        modelShader.setMat4("view", view);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(3.0,0.33,0.0));
-        model = glm::scale(model, glm::vec3(1.5));
-        modelShader.setMat4("model", model);
-        tableModel.Draw(modelShader);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(2.8,1.24,0.7));
-        model = glm::scale(model, glm::vec3(0.3));
-        modelShader.setMat4("model", model);
-        appleModel.Draw(modelShader);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(3.0,1.27,0.0));
-        model = glm::scale(model, glm::vec3(0.3));
-        modelShader.setMat4("model", model);
-        notebookModel.Draw(modelShader);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(3.0,1.27,0.0));
-        model = glm::scale(model, glm::vec3(0.3));
-        modelShader.setMat4("model", model);
-        notebookModel.Draw(modelShader);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(-2.0,0.0,-1.2));
-        model = glm::scale(model, glm::vec3(1.6));
-        modelShader.setMat4("model", model);
-        closetModel.Draw(modelShader);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(2.5,1.24,0.8));
-        model = glm::rotate(model, glm::radians(-120.0f), glm::vec3(0.0,1.0,0.0));
-        model = glm::scale(model, glm::vec3(0.4));
-        modelShader.setMat4("model", model);
-        coffeeModel.Draw(modelShader);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(1.0,0.0,0.0));
-        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0,1.0,0.0));
-        model = glm::scale(model, glm::vec3(0.7));
-        modelShader.setMat4("model", model);
-        chairModel.Draw(modelShader);
-
-
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_FRONT);
-        lightShader.use();
-        lightShader.setMat4("projection", projection);
-        lightShader.setMat4("view", view);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(2.0,3.84,0.0));
-        model = glm::scale(model, glm::vec3(0.3));
-        lightShader.setMat4("model", model);
-        lightModel.Draw(lightShader);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(-2.0,3.84,4.0));
-        model = glm::scale(model, glm::vec3(0.3));
-        lightShader.setMat4("model", model);
-        lightModel.Draw(lightShader);
-        glDisable(GL_CULL_FACE);
+        if (prepassDrawn) {
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
+        renderQueue.Execute(PACKETS_LIT);
+        if (prepassDrawn) {
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LESS);
+        }
+        overdraw.shaded.End();
+        overdraw.pending = true;
+        if (programState->Deferred)
+            gBuffer.LightingPass(targetFBO, *deferredShader);
+        renderQueue.Execute(PACKETS_UNLIT);
+        frameCullStats = culler.stats;
+        frameQueueStats = renderQueue.stats;
 
 
 
@@ -574,53 +975,154 @@ int main() {
         glActiveTexture(GL_TEXTURE0);
         glBindVertexArray(windowVAO);
         glBindTexture(GL_TEXTURE_2D, windowTexture);
+        // clamped: interpolating with the opposite edge would give the window semi-transparent borders
+        SamplerCache::Bind(0, SAMPLER_CLAMP);
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(1.4,1.0,2.0));
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        windowShader.setMat4("projection", projection);
-        windowShader.setMat4("view", view);
         windowShader.setMat4("model", model);
         glDrawArrays(GL_TRIANGLES, 0, 6);
         glBindVertexArray(0);
 
         glDepthFunc(GL_LEQUAL);
         skyboxShader.use();
-        projection = glm::perspective(glm::radians(programState->camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
         model = glm::mat4(1.0f);
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0,1.0,0.0));
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0,0.0,1.0));
 
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
         skyboxShader.setMat4("model", model);
 
         glBindVertexArray(skyboxVAO);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+        SamplerCache::Bind(0, SAMPLER_CUBEMAP);
         glDrawArrays(GL_TRIANGLES, 0, 36);
         glBindVertexArray(0);
         glDepthFunc(GL_LESS);
+        frameDrawAllocations = AllocationCounter::Count() - allocationsBefore;
+
+        if (options.benchmark) {
+            benchmark.EndPhase(PHASE_DRAW);
+            glFinish();
+            benchmark.EndPhase(PHASE_GPU_WAIT);
+            // after glFinish the results are there, this frame's can be read without waiting
+            if (benchmark.Timed()) {
+                shadedFragments += overdraw.shaded.Result();
+                if (prepassDrawn)
+                    prepassFragments += overdraw.prepass.Result();
+            }
+            overdraw.pending = false;
+            benchmark.EndFrame();
+            // the first of two runs is done, the path is played again deferred or with the pre-pass
+            if (benchmark.Done() && comparing && !secondRun) {
+                addRunResults(runName());
+                benchmark.Restart();
+                clusterAssignMillis = shadedFragments = prepassFragments = 0.0;
+                if (options.shading == "compare")
+                    programState->Deferred = true;
+                else
+                    programState->DepthPrepass = true;
+                secondRun = true;
+            }
+        } else {
+            if (programState->ImGuiEnabled)
+                DrawImGui(programState);
+
+            // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+            // -------------------------------------------------------------------------------
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+            // for the stats window: the previous frame's counts, if the GPU is done with them. Otherwise they
+            // are dropped, and the queries are begun again next frame
+            OverdrawQueries &previous = overdrawQueries[overdrawFrame & 1];
+            if (programState->ImGuiEnabled && previous.pending && previous.Available()) {
+                frameShadedFragments = previous.shaded.Result();
+                framePrepassFragments = previous.prepassDrawn ? previous.prepass.Result() : 0;
+            }
+            previous.pending = false;
+        }
 
+        if (firstFrame) {
+            firstFrame = false;
+            std::cout << "STARTUP:: first frame after "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count()
+                      << " ms" << std::endl;
+            // every program of the first frame has been used
+            ShaderCompiler::PrintReport();
+            ProgramCache::PrintReport();
+        }
+    }
 
-        if (programState->ImGuiEnabled)
-            DrawImGui(programState);
-
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    gBuffer.Destroy();
+    for (OverdrawQueries &queries : overdrawQueries) {
+        queries.prepass.Destroy();
+        queries.shaded.Destroy();
     }
 
-    programState->SaveToFile("resources/program_state.txt");
+    if (options.benchmark && !options.drawCostModel.empty()) {
+        unsigned int count = sizeof(models) / sizeof(models[0]);
+        unsigned int i = 0;
+        while (i < count && options.drawCostModel != modelNames[i])
+            i++;
+        if (i == count || i == 0 || models[i] == &lightModel)
+            std::cout << "ERROR::BENCHMARK:: --draw-cost expects a furniture model, not " << options.drawCostModel << std::endl;
+        else
+            measureDrawCost(*models[i], modelNames[i], modelVariants, litDefines(programState->PointLights, lamp, false), frameUniforms,
+                            lightClusters, benchmark);
+    }
+    // after the draw cost measurement, which assigns the lights for its own view and may compile a variant
+    lightClusters.Destroy();
+    ShaderCompiler::StopCompileThread();
+    if (compileWindow != NULL)
+        glfwDestroyWindow(compileWindow);
+
+    if (options.benchmark) {
+        benchmark.AddResult("point_lights", programState->PointLights);
+        benchmark.AddResult("cluster_assign_ms", clusterAssignMillis / options.frames);
+        benchmark.AddResult("cluster_light_references", frameClusterStats.references);
+        // the frame times of the run below again under the run's name, next to the first run's when comparing
+        addRunResults(runName());
+        if (programState->Deferred)
+            benchmark.AddResult("gbuffer_mb", (double)options.width * options.height * GBUFFER_BYTES_PER_PIXEL / (1024.0 * 1024.0));
+        std::vector<std::pair<std::string, std::string>> info = {
+                {"camera_path", options.cameraPath},
+                {"resolution", std::to_string(options.width) + "x" + std::to_string(options.height)},
+                {"renderer", (const char *) glGetString(GL_RENDERER)},
+                {"context", headless ? "egl_surfaceless" : "hidden_window"},
+                {"vertex_format", vertexFormat == VERTEX_COMPRESSED ? "compressed" : "full"},
+                {"lod_bias", std::to_string(programState->LodBias)},
+                {"upload_budget_mb", std::to_string(options.uploadBudget)},
+                {"draw_cost_model", options.drawCostModel},
+                {"shading", options.shading},
+                {"depth_prepass", options.depthPrepass}
+        };
+        if (!benchmark.WriteJson(options.output, info)) {
+            std::cout << "ERROR::BENCHMARK:: could not write " << options.output << std::endl;
+            return -1;
+        }
+        std::cout << "BENCHMARK:: " << options.frames << " frames, results written to " << options.output << std::endl;
+        benchmarkTarget.Destroy();
+    } else {
+        programState->SaveToFile("resources/program_state.txt");
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
     delete programState;
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    // the models release their textures when they go out of scope, after the context is gone
+    TextureRegistry::Clear();
+    TextureStreamer::Disable();
+    SamplerCache::Clear();
+    if (recordingCamera) {
+        if (cameraRecording.Save(options.recordPath))
+            std::cout << "RECORD:: " << cameraRecording.keys.size() << " camera keys saved to " << options.recordPath << std::endl;
+        else
+            std::cout << "ERROR::RECORD:: could not write " << options.recordPath << std::endl;
+    }
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
-    glfwTerminate();
+    if (window != NULL)
+        glfwTerminate();
     return 0;
 }
 
@@ -638,6 +1140,9 @@ void processInput(GLFWwindow *window) {
         programState->camera.ProcessKeyboard(LEFT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         programState->camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    if (recordingCamera)
+        cameraRecording.Record(glfwGetTime(), programState->camera);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -646,6 +1151,11 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    // a minimized window keeps rendering at its last size
+    if (width > 0 && height > 0) {
+        renderWidth = width;
+        renderHeight = height;
+    }
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -665,12 +1175,18 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
 
     if (programState->CameraMouseMovementUpdateEnabled)
         programState->camera.ProcessMouseMovement(xoffset, yoffset);
+
+    if (recordingCamera)
+        cameraRecording.Record(glfwGetTime(), programState->camera);
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
     programState->camera.ProcessMouseScroll(yoffset);
+
+    if (recordingCamera)
+        cameraRecording.Record(glfwGetTime(), programState->camera);
 }
 
 void DrawImGui(ProgramState *programState) {
@@ -687,6 +1203,10 @@ void DrawImGui(ProgramState *programState) {
         ImGui::DragFloat("linear", &programState->lin, 0.05, 0.0, 1.0);
         ImGui::DragFloat("quadratic", &programState->quad, 0.05, 0.0, 1.0);
         ImGui::DragFloat("lamp radius", &programState->spotLightRadius, 0.05, 0.0, 30.0);
+        ImGui::SliderInt("point lights", &programState->PointLights, 0, MAX_POINT_LIGHTS);
+        const ClusterStats &clusters = frameClusterStats;
+        ImGui::Text("Light clusters: %u references, at most %u lights in one", clusters.references, clusters.maxPerCluster);
+        ImGui::Text("Assigned in %.3f ms with %u pool workers", clusters.assignMillis, clusters.helpers);
         ImGui::End();
     }
 
@@ -697,6 +1217,36 @@ void DrawImGui(ProgramState *programState) {
         ImGui::Text("(Yaw, Pitch): (%f, %f)", c.Yaw, c.Pitch);
         ImGui::Text("Camera front: (%f, %f, %f)", c.Front.x, c.Front.y, c.Front.z);
         ImGui::Checkbox("Camera mouse update", &programState->CameraMouseMovementUpdateEnabled);
+
+        ImGui::Checkbox("Culling", &programState->CullingEnabled);
+        ImGui::DragFloat("min pixel size", &programState->CullMinPixelSize, 0.1, 0.0, 50.0);
+        const CullStats &cull = frameCullStats;
+        ImGui::Text("Mesh instances: %u drawn, %u outside frustum, %u too small", cull.drawn, cull.frustumCulled, cull.smallCulled);
+        ImGui::DragFloat("LOD bias", &programState->LodBias, 0.05, -2.0, 4.0);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Render stats");
+        const UniformStats &u = frameUniformStats;
+        ImGui::Text("Uniform lookups: %llu cached, %llu inactive", u.cacheHits, u.cacheMisses);
+        ImGui::Text("Uniform uploads: %llu issued, %llu skipped (unchanged)", u.uploads, u.skippedUploads);
+        ImGui::Text("Heap allocations while drawing: %llu", frameDrawAllocations);
+        const RenderQueueStats &q = frameQueueStats;
+        ImGui::Text("Render queue: %u packets, %u program / %u material changes", q.packets, q.programChanges, q.materialChanges);
+        ImGui::Text("Binds: %u textures, %u VAOs; draw list compiled %u times", q.textureBinds, q.vaoBinds, q.rebuilds);
+        ImGui::Checkbox("Compressed vertices", &programState->CompressedVertices);
+        ImGui::Checkbox("Deferred shading", &programState->Deferred);
+        ImGui::Checkbox("Depth pre-pass", &programState->DepthPrepass);
+        double pixels = (double)renderWidth * renderHeight;
+        ImGui::Text("Lit fragments per pixel: %.2f shaded, %.2f in the pre-pass (%u packets)", frameShadedFragments / pixels,
+                    framePrepassFragments / pixels, q.prepassPackets);
+        ImGui::Text("G-buffer: %u x %u, %.1f MB", renderWidth, renderHeight,
+                    (double)renderWidth * renderHeight * GBUFFER_BYTES_PER_PIXEL / (1024.0 * 1024.0));
+        ImGui::Text("Vertex buffers: %.1f KB (%.1f KB uncompressed)", vertexBufferBytes / 1024.0, fullVertexBufferBytes / 1024.0);
+        ImGui::Text("Vertex fetch: %.1f KB per frame (%.1f KB uncompressed)", q.vertexBytes / 1024.0, q.fullVertexBytes / 1024.0);
+        for (unsigned int lod = 0; lod < MAX_MESH_LODS; lod++)
+            ImGui::Text("LOD %u: %u instances, %llu triangles", lod, q.lodInstances[lod], q.lodTriangles[lod]);
         ImGui::End();
     }
 
@@ -704,6 +1254,137 @@ void DrawImGui(ProgramState *programState) {
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+// GPU time of drawing the model (its instances, with the lit variant of these defines) framed in the view:
+// once with the rasterizer discarding every primitive, which leaves the vertex work, and once in full.
+// Before the timed draws one draw fills the depth buffer, and the timed ones test GL_LEQUAL against it,
+// so each of them shades the visible fragments once, as a frame with no overdraw would.
+void measureDrawCost(Model &model, const std::string &name, ShaderVariants &variants, ShaderDefines defines,
+                     FrameUniforms &frameUniforms, LightClusters &lightClusters, Benchmark &benchmark) {
+    if (model.IsProxy() || model.meshes.empty() || model.Instances().empty())
+        return;
+    glm::vec3 worldMin(FLT_MAX), worldMax(-FLT_MAX);
+    bool parallax = false;
+    for (const Mesh &mesh : model.meshes) {
+        parallax = parallax || mesh.HasTexture("texture_height");
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 local((corner & 1) ? mesh.aabbMax.x : mesh.aabbMin.x, (corner & 2) ? mesh.aabbMax.y : mesh.aabbMin.y,
+                            (corner & 4) ? mesh.aabbMax.z : mesh.aabbMin.z);
+            glm::vec3 world = glm::vec3(model.Instances()[0] * glm::vec4(local, 1.0f));
+            worldMin = glm::min(worldMin, world);
+            worldMax = glm::max(worldMax, world);
+        }
+    }
+    glm::vec3 center = (worldMin + worldMax) * 0.5f;
+    float radius = glm::length(worldMax - worldMin) * 0.5f;
+    float distance = radius / std::sin(glm::radians(45.0f) * 0.5f);
+    glm::vec3 eye = center + glm::normalize(glm::vec3(0.6f, 0.4f, 1.0f)) * distance;
+    frameUniforms.camera.projection = glm::perspective(glm::radians(45.0f), (float)renderWidth / (float)renderHeight, 0.1f, 100.0f);
+    frameUniforms.camera.view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    frameUniforms.camera.viewPos = eye;
+    lightClusters.Update(frameUniforms, renderWidth, renderHeight);
+    frameUniforms.Upload();
+
+    Shader &shader = variants.Get(defines.Set("PARALLAX", parallax));
+    shader.use();
+    // wall time between two glFinish: a GPU timer query misses the vertex work of drivers that run it
+    // on the CPU inside the draw call (llvmpipe)
+    auto timeDraws = [&model, &shader]() {
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < DRAW_COST_REPEATS; i++)
+            model.DrawInstanced(shader);
+        glFinish();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / DRAW_COST_REPEATS;
+    };
+    GpuQuery samples(GL_SAMPLES_PASSED);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    model.DrawInstanced(shader);
+    glDepthFunc(GL_LEQUAL);
+    glEnable(GL_RASTERIZER_DISCARD);
+    double vertexMillis = timeDraws();
+    glDisable(GL_RASTERIZER_DISCARD);
+    samples.Begin();
+    double totalMillis = timeDraws();
+    samples.End();
+    double fragments = (double)samples.Result() / DRAW_COST_REPEATS;
+    glDepthFunc(GL_LESS);
+
+    double fragmentMillis = std::max(0.0, totalMillis - vertexMillis);
+    std::cout << "DRAW COST:: " << name << ": " << vertexMillis << " ms of vertex work and " << fragmentMillis << " ms of fragment work per draw ("
+              << fragments << " fragments, " << (fragments > 0.0 ? fragmentMillis * 1e6 / fragments : 0.0) << " ns each)" << std::endl;
+    benchmark.AddResult("draw_cost_vertex_ms", vertexMillis);
+    benchmark.AddResult("draw_cost_fragment_ms", fragmentMillis);
+    benchmark.AddResult("draw_cost_fragments", fragments);
+}
+
+// small colored lights from lights[first] on, spread through the room along a Halton sequence so any
+// number of them fills it evenly; their steep falloff keeps each one to a few clusters
+void scatterPointLights(std::vector<PointLight> &lights, int first) {
+    auto halton = [](int index, int base) {
+        float result = 0.0f, fraction = 1.0f;
+        for (; index > 0; index /= base) {
+            fraction /= base;
+            result += fraction * (index % base);
+        }
+        return result;
+    };
+    const glm::vec3 roomMin(-3.8f, 0.3f, -1.8f);
+    const glm::vec3 roomMax(3.8f, 3.5f, 5.8f);
+    for (int i = first; i < (int)lights.size(); i++) {
+        int n = i - first + 1;
+        PointLight &light = lights[i];
+        light.position = glm::mix(roomMin, roomMax, glm::vec3(halton(n, 2), halton(n, 3), halton(n, 5)));
+        // hues a golden angle apart
+        float hue = std::fmod(n * 0.618034f, 1.0f) * 6.0f;
+        glm::vec3 color = glm::clamp(glm::vec3(std::fabs(hue - 3.0f) - 1.0f, 2.0f - std::fabs(hue - 2.0f), 2.0f - std::fabs(hue - 4.0f)), 0.0f, 1.0f);
+        light.constant = 1.0f;
+        light.linear = 1.5f;
+        light.quadratic = 12.0f;
+        light.ambient = glm::vec3(0.0f);
+        light.diffuse = color * 0.6f;
+        light.specular = color * 0.3f;
+    }
+}
+
+// once the models and textures are loaded: what loading took, its critical path (and the whole timeline
+// if one was asked for), and what the vertex format saves
+void printLoadReport(Model *const *models, const char *const *names, unsigned int count, const std::string &timelinePath) {
+    // cold-vs-warm report: a model loaded from its mesh cache remembers how long the Assimp import took
+    double loadMillis = 0.0, coldMillis = 0.0;
+    int cached = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        loadMillis += models[i]->loadMillis;
+        coldMillis += models[i]->coldImportMillis;
+        cached += models[i]->loadedFromCache;
+    }
+    std::cout << "STARTUP:: models loaded in " << loadMillis << " ms, " << cached << "/" << count
+              << " from mesh cache (cold import: " << coldMillis << " ms)" << std::endl;
+    ModelLoader::PrintReport();
+    TextureLoader::PrintReport();
+    TextureRegistry::PrintReport();
+    TextureStorage::PrintReport();
+    TaskGraph::PrintReport();
+    if (!timelinePath.empty()) {
+        if (TaskGraph::WriteTimeline(timelinePath))
+            std::cout << "TASKS:: timeline written to " << timelinePath << std::endl;
+        else
+            std::cout << "ERROR::TASKS:: could not write " << timelinePath << std::endl;
+    }
+
+    // what the compressed vertex format saves: memory, and the same amount of vertex fetch every time an instance is drawn
+    vertexBufferBytes = fullVertexBufferBytes = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        size_t bytes = models[i]->VertexBytes();
+        size_t full = models[i]->FullVertexBytes();
+        std::cout << "VERTEX:: " << names[i] << ": " << bytes / 1024.0 << " KB of vertices (" << full / 1024.0 << " KB uncompressed)";
+        if (bytes < full)
+            std::cout << ", saves " << (full - bytes) / 1024.0 << " KB of memory and of vertex fetch per drawn instance";
+        std::cout << std::endl;
+        vertexBufferBytes += bytes;
+        fullVertexBufferBytes += full;
+    }
+}
+
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
     if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
         programState->ImGuiEnabled = !programState->ImGuiEnabled;
@@ -719,69 +1400,40 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     }
 }
 
-unsigned int loadTexture(char const * path)
+unsigned int loadTexture(char const * path, TextureKind kind)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    // decoded on the thread pool, uploaded by TextureLoader::FinishPending or Poll; shared with other requests for the same image
+    return TextureRegistry::Acquire(path, TextureKindName(kind), [kind](unsigned int textureID, const DecodedImage &image) {
+        if (image.data || image.cooked)
+        {
+            TextureStorage::Upload2D(textureID, image, kind);
+        }
+        else
+        {
+            std::cout << "Texture failed to load at path: " << image.path << std::endl;
+        }
+    });
 }
 
 unsigned int loadCubemap(vector<std::string> faces)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrChannels;
+    // all six faces are decoded concurrently; sampled through SamplerCache's SAMPLER_CUBEMAP
     for (unsigned int i = 0; i < faces.size(); i++)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
+        TextureLoader::Request(faces[i], [textureID, i](const DecodedImage &image) {
+            if (image.data || image.cooked)
+            {
+                TextureStorage::UploadCubemapFace(textureID, i, image, TEXTURE_COLOR);
+            }
+            else
+            {
+                std::cout << "Cubemap texture failed to load at path: " << image.path << std::endl;
+            }
+        });
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
     return textureID;
-}
\ No newline at end of file
+}
@@ -0,0 +1,447 @@
+// Offline asset cooker: turns the models and textures under resources/ into the files the viewer loads
+// fastest. Models get their mesh cache (optimized vertices, 16-bit indices, levels of detail), textures a
+// block compressed .ktx next to the image with a full mip chain filtered on the CPU. Cooking is
+// incremental: an output is only rebuilt when its source's content (or the cook settings) changed.
+//
+// usage: project_base_cook [resources directory] [--force] [--jobs N] [--color bc7|bc1]
+
+#include <stb_image.h>
+
+#include <learnopengl/block_compression.h>
+#include <learnopengl/hash.h>
+#include <learnopengl/ktx.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_import.h>
+#include <learnopengl/texture_kind.h>
+#include <learnopengl/thread_pool.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct CookOptions {
+    std::string root = "resources";
+    bool force = false;
+    unsigned int jobs = std::thread::hardware_concurrency();
+    bool colorBC1 = false; // BC1 (BC3 with alpha) instead of BC7 for color textures: half the size, lower quality
+};
+
+struct TextureJob {
+    std::string path;
+    TextureKind kind = TEXTURE_COLOR;
+    bool mips = true;
+};
+
+enum CookResult {
+    COOK_UP_TO_DATE,
+    COOK_DONE,
+    COOK_MISSING, // the source doesn't exist (a material naming a file that isn't there)
+    COOK_FAILED
+};
+
+static std::mutex logMutex;
+
+static void log(const std::string &line)
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    std::cout << line << std::endl;
+}
+
+static std::vector<std::string> listDirectory(const std::string &path, bool directories)
+{
+    std::vector<std::string> names;
+    DIR *dir = opendir(path.c_str());
+    if (!dir)
+        return names;
+    while (dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        struct stat st;
+        if (stat((path + "/" + name).c_str(), &st) == 0 && S_ISDIR(st.st_mode) == directories)
+            names.push_back(name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+static bool endsWith(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// ---- meshes ----------------------------------------------------------------------------------
+
+// writes the model's mesh cache unless a valid one exists; textures receives the (type, path) pairs of its materials
+static CookResult cookModel(const std::string &path, bool force, std::vector<std::pair<std::string, std::string>> &textures)
+{
+    auto start = std::chrono::steady_clock::now();
+    MeshCache cache;
+    if (!force && cache.Open(path, MODEL_IMPORT_FLAGS))
+    {
+        for (size_t i = 0; i < cache.MeshCount(); i++)
+        {
+            CachedMesh mesh = cache.GetMesh(i);
+            textures.insert(textures.end(), mesh.textures.begin(), mesh.textures.end());
+        }
+        log("COOK:: mesh " + path + ": up to date");
+        return COOK_UP_TO_DATE;
+    }
+
+    std::vector<ImportedMesh> meshes;
+    if (!MeshImporter::Import(path, meshes))
+    {
+        log("COOK:: mesh " + path + ": import failed");
+        return COOK_FAILED;
+    }
+    for (const ImportedMesh &mesh : meshes)
+        textures.insert(textures.end(), mesh.textures.begin(), mesh.textures.end());
+    double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!MeshCache::Write(path, MODEL_IMPORT_FLAGS, meshes, millis))
+    {
+        log("COOK:: mesh " + path + ": failed to write " + MeshCache::PathFor(path));
+        return COOK_FAILED;
+    }
+    std::ostringstream line;
+    line << "COOK:: mesh " << path << ": " << meshes.size() << " meshes cooked in " << millis << " ms";
+    log(line.str());
+    return COOK_DONE;
+}
+
+// ---- textures --------------------------------------------------------------------------------
+
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+static float srgbToLinear(uint8_t value)
+{
+    static const std::vector<float> table = [] {
+        std::vector<float> t(256);
+        for (int i = 0; i < 256; i++)
+        {
+            float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+    return table[value];
+}
+
+static uint8_t linearToSrgb(float value)
+{
+    float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return (uint8_t)std::lround(std::min(1.0f, std::max(0.0f, c)) * 255.0f);
+}
+
+static uint8_t toUnorm8(float value)
+{
+    return (uint8_t)std::lround(std::min(1.0f, std::max(0.0f, value)) * 255.0f);
+}
+
+// next mip level with a 2x2 box filter (odd sizes reuse the last row or column). Color is averaged as
+// linear light rather than as sRGB values, which would darken every level; normals are renormalized.
+static Image downsample(const Image &src, TextureKind kind)
+{
+    Image dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.rgba.resize((size_t)dst.width * dst.height * 4);
+    for (int y = 0; y < dst.height; y++)
+    {
+        for (int x = 0; x < dst.width; x++)
+        {
+            const uint8_t *texels[4];
+            for (int i = 0; i < 4; i++)
+            {
+                int sx = std::min(x * 2 + (i & 1), src.width - 1);
+                int sy = std::min(y * 2 + (i >> 1), src.height - 1);
+                texels[i] = &src.rgba[((size_t)sy * src.width + sx) * 4];
+            }
+            float sum[4] = {};
+            for (int i = 0; i < 4; i++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    if (c == 3)
+                        sum[c] += texels[i][c] / 255.0f;
+                    else if (kind == TEXTURE_COLOR)
+                        sum[c] += srgbToLinear(texels[i][c]);
+                    else if (kind == TEXTURE_NORMAL)
+                        sum[c] += texels[i][c] / 255.0f * 2.0f - 1.0f;
+                    else
+                        sum[c] += texels[i][c] / 255.0f;
+                }
+            }
+            uint8_t *out = &dst.rgba[((size_t)y * dst.width + x) * 4];
+            if (kind == TEXTURE_NORMAL)
+            {
+                float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                for (int c = 0; c < 3; c++)
+                    out[c] = toUnorm8(length > 0.0f ? sum[c] / length * 0.5f + 0.5f : (c == 2 ? 1.0f : 0.5f));
+            }
+            else
+            {
+                for (int c = 0; c < 3; c++)
+                    out[c] = kind == TEXTURE_COLOR ? linearToSrgb(sum[c] * 0.25f) : toUnorm8(sum[c] * 0.25f);
+            }
+            out[3] = toUnorm8(sum[3] * 0.25f);
+        }
+    }
+    return dst;
+}
+
+static BlockFormat formatFor(const TextureJob &job, const CookOptions &options, bool hasAlpha)
+{
+    if (job.kind == TEXTURE_NORMAL)
+        return BLOCK_BC5;
+    if (job.kind == TEXTURE_DATA)
+        return BLOCK_BC4;
+    if (options.colorBC1)
+        return hasAlpha ? BLOCK_BC3 : BLOCK_BC1;
+    return BLOCK_BC7;
+}
+
+static const char *formatName(BlockFormat format)
+{
+    switch (format)
+    {
+    case BLOCK_BC1: return "BC1";
+    case BLOCK_BC3: return "BC3";
+    case BLOCK_BC4: return "BC4";
+    case BLOCK_BC5: return "BC5";
+    default: return "BC7";
+    }
+}
+
+// what besides the source decides the output; a change re-cooks the texture
+static uint32_t settingsHash(const TextureJob &job, const CookOptions &options)
+{
+    std::ostringstream settings;
+    settings << job.kind << " " << job.mips;
+    if (job.kind == TEXTURE_COLOR)
+        settings << " " << (options.colorBC1 ? "bc1" : "bc7");
+    return (uint32_t)HashString(settings.str());
+}
+
+static CookResult cookTexture(const TextureJob &job, const CookOptions &options)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::string outPath = KtxFile::PathFor(job.path);
+    uint32_t settings = settingsHash(job, options);
+
+    FileStamp stamp;
+    if (!FileStamp::Get(job.path, stamp))
+    {
+        log("COOK:: texture " + job.path + ": missing");
+        return COOK_MISSING;
+    }
+    TextureCookInfo info;
+    {
+        KtxFile existing;
+        if (!options.force && existing.Open(outPath) && existing.GetCookInfo(info) && info.settings == settings && existing.IsFreshFor(job.path))
+        {
+            log("COOK:: texture " + job.path + ": up to date");
+            return COOK_UP_TO_DATE;
+        }
+    }
+
+    memset(&info, 0, sizeof(info));
+    info.version = TEXTURE_COOK_VERSION;
+    info.settings = settings;
+    if (!HashFile(job.path, info.sourceHash))
+    {
+        log("COOK:: texture " + job.path + ": can't read the source");
+        return COOK_FAILED;
+    }
+    info.sourceSize = stamp.size;
+    info.sourceMtime = stamp.mtime;
+
+    Image image;
+    int channels;
+    unsigned char *pixels = stbi_load(job.path.c_str(), &image.width, &image.height, &channels, 4);
+    if (!pixels)
+    {
+        log("COOK:: texture " + job.path + ": can't decode (" + stbi_failure_reason() + ")");
+        return COOK_FAILED;
+    }
+    image.rgba.assign(pixels, pixels + (size_t)image.width * image.height * 4);
+    stbi_image_free(pixels);
+    info.channels = (uint32_t)channels;
+
+    bool hasAlpha = false;
+    for (size_t i = 3; channels == 4 && !hasAlpha && i < image.rgba.size(); i += 4)
+        hasAlpha = image.rgba[i] != 255;
+    BlockFormat format = formatFor(job, options, hasAlpha);
+    int width = image.width, height = image.height;
+
+    std::vector<std::vector<unsigned char>> levels;
+    size_t bytes = 0;
+    for (;;)
+    {
+        levels.push_back(std::vector<unsigned char>(BlockCompressor::CompressedSize(format, image.width, image.height)));
+        BlockCompressor::Compress(format, image.rgba.data(), image.width, image.height, levels.back().data());
+        bytes += levels.back().size();
+        if (!job.mips || (image.width == 1 && image.height == 1))
+            break;
+        image = downsample(image, job.kind);
+    }
+
+    bool srgb = job.kind == TEXTURE_COLOR;
+    if (!KtxFile::Write(outPath, BlockCompressor::GLInternalFormat(format, srgb), BlockCompressor::GLBaseFormat(format),
+                        width, height, levels, info))
+    {
+        log("COOK:: texture " + job.path + ": failed to write " + outPath);
+        return COOK_FAILED;
+    }
+    std::ostringstream line;
+    line << "COOK:: texture " << job.path << ": " << formatName(format) << (srgb ? " sRGB " : " ") << width << "x" << height
+         << ", " << levels.size() << " levels, " << bytes / 1024.0 << " KB in "
+         << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms";
+    log(line.str());
+    return COOK_DONE;
+}
+
+// ---- driver ----------------------------------------------------------------------------------
+
+// loose textures are named after what they hold (..._NORMAL.jpg, ..._SPECULAR.jpg, ..._DISP.jpg)
+static TextureKind kindFromName(const std::string &name)
+{
+    if (name.find("NORMAL") != std::string::npos)
+        return TEXTURE_NORMAL;
+    if (name.find("SPECULAR") != std::string::npos || name.find("DISP") != std::string::npos)
+        return TEXTURE_DATA;
+    return TEXTURE_COLOR;
+}
+
+static bool isImage(const std::string &name)
+{
+    return endsWith(name, ".png") || endsWith(name, ".jpg") || endsWith(name, ".jpeg");
+}
+
+static bool parseOptions(int argc, char **argv, CookOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--force")
+            options.force = true;
+        else if (arg == "--jobs" && i + 1 < argc)
+            options.jobs = (unsigned int)std::max(1, atoi(argv[++i]));
+        else if (arg == "--color" && i + 1 < argc)
+        {
+            std::string format = argv[++i];
+            if (format != "bc7" && format != "bc1")
+                return false;
+            options.colorBC1 = format == "bc1";
+        }
+        else if (!arg.empty() && arg[0] != '-')
+            options.root = arg;
+        else
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    CookOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cout << "usage: " << argv[0] << " [resources directory] [--force] [--jobs N] [--color bc7|bc1]" << std::endl;
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool pool(options.jobs);
+
+    // 1. models, each imported on its own worker; their materials name the textures to cook
+    std::vector<std::string> models;
+    std::string objects = options.root + "/objects";
+    for (const std::string &dir : listDirectory(objects, true))
+    {
+        for (const std::string &name : listDirectory(objects + "/" + dir, false))
+        {
+            if (endsWith(name, ".obj"))
+                models.push_back(objects + "/" + dir + "/" + name);
+        }
+    }
+    typedef std::vector<std::pair<std::string, std::string>> TextureList;
+    std::vector<std::future<std::pair<CookResult, TextureList>>> modelResults;
+    for (const std::string &path : models)
+    {
+        bool force = options.force;
+        modelResults.push_back(pool.Submit([path, force] {
+            TextureList textures;
+            CookResult result = cookModel(path, force, textures);
+            return std::make_pair(result, textures);
+        }));
+    }
+
+    std::map<std::string, TextureJob> textures;
+    int counts[2][4] = {};
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        std::pair<CookResult, TextureList> result = modelResults[i].get();
+        counts[0][result.first]++;
+        std::string directory = models[i].substr(0, models[i].find_last_of('/'));
+        for (const std::pair<std::string, std::string> &texture : result.second)
+        {
+            TextureJob &job = textures[directory + "/" + texture.second];
+            job.path = directory + "/" + texture.second;
+            job.kind = MaterialTextureKind(texture.first);
+        }
+    }
+
+    // 2. loose textures, the skybox faces without mips since the skybox is never minified
+    std::string loose = options.root + "/textures";
+    for (const std::string &name : listDirectory(loose, false))
+    {
+        if (!isImage(name))
+            continue;
+        TextureJob &job = textures[loose + "/" + name];
+        job.path = loose + "/" + name;
+        job.kind = kindFromName(name);
+    }
+    for (const std::string &name : listDirectory(loose + "/skybox", false))
+    {
+        if (!isImage(name))
+            continue;
+        TextureJob &job = textures[loose + "/skybox/" + name];
+        job.path = loose + "/skybox/" + name;
+        job.mips = false;
+    }
+
+    std::vector<std::future<CookResult>> textureResults;
+    for (const std::pair<const std::string, TextureJob> &texture : textures)
+    {
+        TextureJob job = texture.second;
+        textureResults.push_back(pool.Submit([job, &options] { return cookTexture(job, options); }));
+    }
+    for (std::future<CookResult> &result : textureResults)
+        counts[1][result.get()]++;
+
+    std::cout << "COOK:: " << models.size() << " models (" << counts[0][COOK_DONE] << " cooked, " << counts[0][COOK_UP_TO_DATE]
+              << " up to date, " << counts[0][COOK_FAILED] << " failed), " << textures.size() << " textures ("
+              << counts[1][COOK_DONE] << " cooked, " << counts[1][COOK_UP_TO_DATE] << " up to date, " << counts[1][COOK_MISSING]
+              << " missing, " << counts[1][COOK_FAILED] << " failed) on " << pool.ThreadCount() << " threads in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+    return counts[0][COOK_FAILED] + counts[1][COOK_FAILED] == 0 ? 0 : 1;
+}